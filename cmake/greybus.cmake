@@ -22,6 +22,17 @@ function(devicetree_unfixed_h_to_mnfs
     )
 endfunction()
 
+function(devicetree_unfixed_h_to_cport_table
+    source_file    # The source file to be converted
+    generated_file # The generated header
+    )
+  devicetree_unfixed_h_to_mnfs(
+    ${source_file}
+    ${generated_file}
+    --cport-table
+    )
+endfunction()
+
 function(mnfs_to_mnfb
     source_file    # The source file to be converted
     generated_file # The generated file
@@ -54,4 +54,12 @@
 #define DESC_TYPE_BUNDLE 0x03
 #define DESC_TYPE_CPORT 0x04
 
+/* values of the greybus-transport cport property */
+#define GREYBUS_TRANSPORT_DEFAULT 0
+#define GREYBUS_TRANSPORT_TCPIP 1
+#define GREYBUS_TRANSPORT_UDP 2
+#define GREYBUS_TRANSPORT_UART 3
+#define GREYBUS_TRANSPORT_SHM 4
+#define GREYBUS_TRANSPORT_COUNT 5
+
 #endif /* ZEPHYR_INCLUDE_DT_BINDINGS_GREYBUS_GREYBUS_H_ */
@@ -0,0 +1,9 @@
+#ifndef ZEPHYR_INCLUDE_DT_BINDINGS_GREYBUS_I2C_H_
+#define ZEPHYR_INCLUDE_DT_BINDINGS_GREYBUS_I2C_H_
+
+/* I2C Register Cache Policies */
+#define GB_I2C_CACHE_VOLATILE       0x00    /* always read from the target */
+#define GB_I2C_CACHE_CACHEABLE      0x01    /* cached reads, writes invalidate */
+#define GB_I2C_CACHE_WRITE_THROUGH  0x02    /* cached reads, writes update */
+
+#endif /* ZEPHYR_INCLUDE_DT_BINDINGS_GREYBUS_I2C_H_ */
@@ -42,6 +42,7 @@ typedef void (*manifest_handler)(unsigned char *manifest_file,
                                  int device_id, int manifest_number);
 void foreach_manifest(manifest_handler handler);
 void enable_cports(void);
+int enable_cport(unsigned int cport);
 void *get_manifest_blob(void);
 void set_manifest_blob(void *blob);
 bool manifest_parse(void *data, size_t size);
@@ -60,6 +60,17 @@ enum {
 #define GB_TIMESYNC_MAX_STROBES 0x04
 
 #define GB_INVALID_TYPE         0x7f
+/* reserved for fragments of messages larger than GB_MTU */
+#define GB_TYPE_FRAGMENT        0x7e
+
+/* largest message that a single operation may carry */
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+#define GB_MAX_OPERATION_SIZE   CONFIG_GREYBUS_FRAGMENT_MAX_SIZE
+#else
+#define GB_MAX_OPERATION_SIZE   GB_MTU
+#endif
+#define GB_MAX_OPERATION_PAYLOAD_SIZE \
+    (GB_MAX_OPERATION_SIZE - sizeof(struct gb_operation_hdr))
 
 enum gb_event {
     GB_EVT_CONNECTED,
@@ -103,6 +114,8 @@ struct gb_transport_backend {
                       unipro_send_completion_t callback, void *priv);
     void *(*alloc_buf)(size_t size);
     void (*free_buf)(void *ptr);
+    /* releases buffers passed to greybus_rx_handler_owned() */
+    void (*rxbuf_free)(unsigned int cport, void *ptr);
 };
 
 struct gb_bundle {
@@ -114,6 +127,7 @@ struct gb_bundle {
 struct gb_operation {
     unsigned int cport;
     bool has_responded;
+    bool response_deferred;
     atomic_t ref_count;
     struct timespec time;
 
@@ -171,6 +185,23 @@ struct gb_operation_hdr {
     __u8 pad[2];
 };
 
+/*
+ * Messages larger than GB_MTU are sent as a series of GB_TYPE_FRAGMENT
+ * messages, each carrying the id and result of the original message,
+ * followed by this header and the next chunk of the original payload.
+ * Fragments of one message are sent in order and are never interleaved
+ * with fragments of another message on the same cport.
+ */
+struct gb_fragment_hdr {
+    __u8 type;      /* type of the original message */
+    __u8 flags;
+    __le16 size;    /* size of the original message, header included */
+    __le16 offset;  /* offset of this chunk in the original payload */
+    __u8 pad[2];
+};
+
+#define GB_FRAGMENT_FLAG_LAST   0x01
+
 enum gb_operation_type {
     GB_TYPE_RESPONSE_FLAG       = 0x80,
 };
@@ -239,6 +270,15 @@ int gb_notify(unsigned cport, enum gb_event event);
 void gb_operation_destroy(struct gb_operation *operation);
 void *gb_operation_alloc_response(struct gb_operation *operation, size_t size);
 int gb_operation_send_response(struct gb_operation *operation, uint8_t result);
+/*
+ * A handler that completes its request from another context calls
+ * gb_operation_defer_response() before returning, and the core then does
+ * not respond on its behalf. The operation stays valid until the handler
+ * calls gb_operation_send_deferred_response(), from any thread.
+ */
+void gb_operation_defer_response(struct gb_operation *operation);
+int gb_operation_send_deferred_response(struct gb_operation *operation,
+                                        uint8_t result);
 int gb_operation_send_request_nowait(struct gb_operation *operation,
                                      gb_operation_callback callback,
                                      bool need_response);
@@ -246,6 +286,8 @@ int gb_operation_send_request_sync(struct gb_operation *operation);
 int gb_operation_send_request(struct gb_operation *operation,
                               gb_operation_callback callback,
                               bool need_response);
+int gb_operation_send_unidirectional(unsigned int cport, uint8_t type,
+                                     void *msg, size_t payload_size);
 struct gb_operation *gb_operation_create(unsigned int cport, uint8_t type,
                                          uint32_t req_size);
 void gb_operation_ref(struct gb_operation *operation);
@@ -254,6 +296,7 @@ size_t gb_operation_get_request_payload_size(struct gb_operation *operation);
 uint8_t gb_operation_get_request_result(struct gb_operation *operation);
 struct gb_bundle *gb_operation_get_bundle(struct gb_operation *operation);
 int greybus_rx_handler(unsigned int, void*, size_t);
+int greybus_rx_handler_owned(unsigned int, void*, size_t);
 
 struct i2c_dev_s;
 int gb_i2c_set_dev(struct i2c_dev_s *dev);
@@ -73,6 +73,17 @@ struct gb_platform_spi_api {
  */
 const struct device *gb_spidev_from_zephyr_spidev(const struct device *dev);
 
+/**
+ * @brief Query how long Greybus took to initialize
+ *
+ * This is the time from the start of the Greybus service until the
+ * control cport was ready for the host to enumerate the device.
+ *
+ * @return the initialization time in microseconds, or 0 if Greybus
+ *         was not initialized
+ */
+uint32_t greybus_service_init_time_us(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZEPHYR_INCLUDE_GREYBUS_SHM_H_
+#define ZEPHYR_INCLUDE_GREYBUS_SHM_H_
+
+/*
+ * Shared-memory layout of the Greybus native_posix transport.
+ *
+ * This header is shared between the Zephyr side (transport-shm.c) and
+ * host-side clients (e.g. scripts/gb_shm_bench.c), so it only depends on
+ * the C library and Linux system headers.
+ *
+ * The region contains one single-producer / single-consumer ring per
+ * direction. Each record in a ring is a struct gb_shm_rec followed by a
+ * complete Greybus message, padded to a multiple of 4 bytes. The producer
+ * owns head, the consumer owns tail, and both are free-running counters
+ * (ring_size must be a power of two). After publishing, the producer
+ * bumps seq and issues a FUTEX_WAKE if the consumer announced that it is
+ * sleeping on seq.
+ *
+ * Only host-side consumers sleep on seq. The Zephyr side polls, since a
+ * futex wait from a native_posix thread would stall the whole process.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GB_SHM_MAGIC 0x48534247 /* "GBSH" */
+#define GB_SHM_VERSION 1
+
+struct gb_shm_rec {
+	uint16_t cport;
+	uint16_t len;
+};
+
+struct gb_shm_ring {
+	/* written by the producer only */
+	uint32_t head __attribute__((aligned(64)));
+	uint32_t seq;
+	/* written by the consumer only */
+	uint32_t tail __attribute__((aligned(64)));
+	uint32_t waiting;
+	uint8_t data[] __attribute__((aligned(64)));
+};
+
+struct gb_shm_region {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ring_size;
+	uint32_t num_cports;
+	/* device -> host ring, then host -> device ring */
+	uint8_t rings[] __attribute__((aligned(64)));
+};
+
+enum gb_shm_dir {
+	GB_SHM_D2H,
+	GB_SHM_H2D,
+};
+
+static inline size_t gb_shm_ring_bytes(uint32_t ring_size)
+{
+	return sizeof(struct gb_shm_ring) + ring_size;
+}
+
+static inline size_t gb_shm_region_bytes(uint32_t ring_size)
+{
+	return sizeof(struct gb_shm_region) + 2 * gb_shm_ring_bytes(ring_size);
+}
+
+static inline struct gb_shm_ring *gb_shm_ring(struct gb_shm_region *region,
+	enum gb_shm_dir dir)
+{
+	return (struct gb_shm_ring *)&region->rings[dir *
+		gb_shm_ring_bytes(region->ring_size)];
+}
+
+static inline uint32_t gb_shm_rec_bytes(uint16_t len)
+{
+	return (sizeof(struct gb_shm_rec) + len + 3) & ~3U;
+}
+
+static inline int gb_shm_futex(uint32_t *addr, int op, uint32_t val,
+	const struct timespec *timeout)
+{
+	return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+static inline void gb_shm_copy_in(struct gb_shm_ring *ring, uint32_t size,
+	uint32_t pos, const void *src, size_t len)
+{
+	uint32_t off = pos & (size - 1);
+	size_t first = (len < size - off) ? len : size - off;
+
+	memcpy(&ring->data[off], src, first);
+	memcpy(&ring->data[0], (const uint8_t *)src + first, len - first);
+}
+
+static inline void gb_shm_copy_out(struct gb_shm_ring *ring, uint32_t size,
+	uint32_t pos, void *dst, size_t len)
+{
+	uint32_t off = pos & (size - 1);
+	size_t first = (len < size - off) ? len : size - off;
+
+	memcpy(dst, &ring->data[off], first);
+	memcpy((uint8_t *)dst + first, &ring->data[0], len - first);
+}
+
+/**
+ * @brief Publish one message on @p ring
+ *
+ * @return 0 on success
+ * @return -EAGAIN if the ring does not currently have room for the message
+ * @return -EMSGSIZE if the message can never fit
+ */
+static inline int gb_shm_push(struct gb_shm_ring *ring, uint32_t size,
+	uint16_t cport, const void *msg, uint16_t len)
+{
+	struct gb_shm_rec rec = { .cport = cport, .len = len };
+	uint32_t need = gb_shm_rec_bytes(len);
+	uint32_t head = ring->head;
+	uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+	if (need > size) {
+		return -EMSGSIZE;
+	}
+
+	if (size - (head - tail) < need) {
+		return -EAGAIN;
+	}
+
+	gb_shm_copy_in(ring, size, head, &rec, sizeof(rec));
+	gb_shm_copy_in(ring, size, head + sizeof(rec), msg, len);
+	__atomic_store_n(&ring->head, head + need, __ATOMIC_RELEASE);
+
+	__atomic_add_fetch(&ring->seq, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) {
+		gb_shm_futex(&ring->seq, FUTEX_WAKE, INT_MAX, NULL);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Consume one message from @p ring into @p buf
+ *
+ * @return the message length on success
+ * @return -EAGAIN if the ring is empty
+ * @return -EMSGSIZE if the message does not fit into @p buf (it is dropped)
+ */
+static inline int gb_shm_pop(struct gb_shm_ring *ring, uint32_t size,
+	uint16_t *cport, void *buf, size_t buf_size)
+{
+	struct gb_shm_rec rec;
+	uint32_t tail = ring->tail;
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	int r;
+
+	if (head == tail) {
+		return -EAGAIN;
+	}
+
+	gb_shm_copy_out(ring, size, tail, &rec, sizeof(rec));
+	if (rec.len > buf_size) {
+		r = -EMSGSIZE;
+	} else {
+		gb_shm_copy_out(ring, size, tail + sizeof(rec), buf, rec.len);
+		*cport = rec.cport;
+		r = rec.len;
+	}
+
+	__atomic_store_n(&ring->tail, tail + gb_shm_rec_bytes(rec.len),
+		__ATOMIC_RELEASE);
+
+	return r;
+}
+
+/**
+ * @brief Sleep until @p ring is non-empty or @p timeout expires
+ *
+ * For host-side clients only, see above.
+ */
+static inline void gb_shm_wait(struct gb_shm_ring *ring,
+	const struct timespec *timeout)
+{
+	uint32_t seq = __atomic_load_n(&ring->seq, __ATOMIC_SEQ_CST);
+
+	__atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == ring->tail) {
+		gb_shm_futex(&ring->seq, FUTEX_WAIT, seq, timeout);
+	}
+	__atomic_store_n(&ring->waiting, 0, __ATOMIC_SEQ_CST);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZEPHYR_INCLUDE_GREYBUS_SHM_H_ */
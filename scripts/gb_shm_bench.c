@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host-side client for the Greybus shared memory transport
+ * (CONFIG_GREYBUS_XPORT_SHM) on native_posix.
+ *
+ * Benchmark mode keeps a configurable number of ping operations in flight
+ * across the given CPorts and reports the completed operation rate.
+ * Fuzz mode sends random messages (random type, size and payload) and
+ * simply drains whatever the device sends back.
+ *
+ * Build:
+ *   cc -O2 -I../include -o gb_shm_bench gb_shm_bench.c -lrt
+ *
+ * Run (after starting zephyr.exe):
+ *   ./gb_shm_bench -c 0 -c 1 -d 16 -t 10
+ *   ./gb_shm_bench -f -c 1 -t 60 -s 1234
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <greybus/shm.h>
+
+#define GB_MTU 2048
+#define GB_TYPE_PING 0x00
+#define GB_TYPE_RESPONSE 0x80
+#define MAX_CPORTS 64
+
+struct gb_hdr {
+	uint16_t size;
+	uint16_t id;
+	uint8_t type;
+	uint8_t result;
+	uint8_t pad[2];
+} __attribute__((packed));
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr,
+		"usage: %s [-n name] [-c cport]... [-d depth] [-t seconds] [-f] [-s seed]\n",
+		progname);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name = "/greybus";
+	unsigned int cports[MAX_CPORTS];
+	unsigned int num_cports = 0;
+	unsigned int depth = 8;
+	double duration = 5;
+	bool fuzz = false;
+	unsigned int seed = 0;
+	struct gb_shm_region *region;
+	struct gb_shm_ring *tx;
+	struct gb_shm_ring *rx;
+	uint8_t buf[GB_MTU];
+	struct gb_hdr *hdr = (struct gb_hdr *)buf;
+	struct stat st;
+	const struct timespec wait = { .tv_nsec = 1000000 };
+	unsigned long sent = 0;
+	unsigned long received = 0;
+	unsigned long errors = 0;
+	unsigned int inflight = 0;
+	uint16_t id = 0;
+	uint16_t cport;
+	double start;
+	double end;
+	int opt;
+	int fd;
+	int r;
+
+	while ((opt = getopt(argc, argv, "n:c:d:t:fs:")) != -1) {
+		switch (opt) {
+		case 'n':
+			name = optarg;
+			break;
+		case 'c':
+			if (num_cports < MAX_CPORTS) {
+				cports[num_cports++] = strtoul(optarg, NULL, 0);
+			}
+			break;
+		case 'd':
+			depth = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			duration = strtod(optarg, NULL);
+			break;
+		case 'f':
+			fuzz = true;
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (num_cports == 0) {
+		cports[num_cports++] = 0;
+	}
+
+	if (depth == 0) {
+		depth = 1;
+	}
+
+	fd = shm_open(name, O_RDWR, 0);
+	if (fd == -1 || fstat(fd, &st) == -1) {
+		perror(name);
+		return EXIT_FAILURE;
+	}
+
+	region = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		fd, 0);
+	close(fd);
+	if (region == MAP_FAILED) {
+		perror("mmap");
+		return EXIT_FAILURE;
+	}
+
+	if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != GB_SHM_MAGIC
+		|| region->version != GB_SHM_VERSION
+		|| (size_t)st.st_size < gb_shm_region_bytes(region->ring_size)) {
+		fprintf(stderr, "%s: not a Greybus shared memory region\n", name);
+		return EXIT_FAILURE;
+	}
+
+	for (unsigned int i = 0; i < num_cports; ++i) {
+		if (cports[i] >= region->num_cports) {
+			fprintf(stderr, "cport %u out of range (%u cports)\n",
+				cports[i], region->num_cports);
+			return EXIT_FAILURE;
+		}
+	}
+
+	tx = gb_shm_ring(region, GB_SHM_H2D);
+	rx = gb_shm_ring(region, GB_SHM_D2H);
+	srand(seed);
+
+	start = now();
+	end = start + duration;
+	while (now() < end) {
+		while (inflight < depth) {
+			uint16_t len = sizeof(*hdr);
+
+			cport = cports[sent % num_cports];
+			if (++id == 0) {
+				id = 1;
+			}
+
+			memset(hdr, 0, sizeof(*hdr));
+			hdr->id = id;
+			hdr->type = GB_TYPE_PING;
+			if (fuzz) {
+				len += rand() % (GB_MTU - sizeof(*hdr) + 1);
+				hdr->type = rand() & 0x7f;
+				for (uint16_t i = sizeof(*hdr); i < len; ++i) {
+					buf[i] = rand();
+				}
+			}
+			hdr->size = len;
+
+			if (gb_shm_push(tx, region->ring_size, cport, buf, len) < 0) {
+				break;
+			}
+
+			++sent;
+			++inflight;
+		}
+
+		r = gb_shm_pop(rx, region->ring_size, &cport, buf, sizeof(buf));
+		if (r == -EAGAIN) {
+			if (fuzz) {
+				/* not every fuzzed request gets a response */
+				inflight = 0;
+			}
+			gb_shm_wait(rx, &wait);
+			continue;
+		}
+
+		if (!fuzz && (r < (int)sizeof(*hdr) || hdr->result != 0
+			|| hdr->type != (GB_TYPE_PING | GB_TYPE_RESPONSE))) {
+			++errors;
+		}
+
+		++received;
+		if (inflight > 0) {
+			--inflight;
+		}
+	}
+	end = now();
+
+	printf("%s: sent %lu, received %lu, errors %lu in %.2f s (%.0f ops/s)\n",
+		fuzz ? "fuzz" : "ping", sent, received, errors, end - start,
+		received / (end - start));
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+#
+# SPDX-License-Identifier: BSD-3-Clause
+
+"""
+Measure aggregate Greybus operation throughput over the TCP/IP transport.
+
+One client thread is started per CPort. Each thread connects to
+base_port + cport and issues back-to-back ping operations (type 0x00)
+for the requested duration. The per-CPort and aggregate operation rates
+are printed at the end, which makes it easy to compare firmware built
+with different values of CONFIG_GREYBUS_XPORT_TCPIP_RX_THREADS.
+
+With --scale, the CPorts are instead exercised 1, 2, 4, ... at a time,
+and a table of aggregate rates is printed. Run it against firmware built
+with each thread count, and compare the tables: with sharding, the rate
+should keep growing with the number of CPorts up to the number of RX
+threads, rather than flatten out after the first one.
+
+Example:
+    gbbench.py -a 192.0.2.1 -c 1 2 3 4 -t 10
+    gbbench.py -a 192.0.2.1 -c 1 2 3 4 5 6 7 8 -t 5 --scale
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+GB_HDR = struct.Struct('<HHBBxx')
+GB_TYPE_PING = 0x00
+GB_TYPE_RESPONSE = 0x80
+
+
+def recv_exact(sock, n):
+    buf = b''
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError('connection closed')
+        buf += chunk
+    return buf
+
+
+def bench_cport(addr, port, deadline, results, cport):
+    ops = 0
+    errors = 0
+    sock = socket.create_connection((addr, port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    try:
+        op_id = 1
+        while time.monotonic() < deadline:
+            sock.sendall(GB_HDR.pack(GB_HDR.size, op_id, GB_TYPE_PING, 0))
+            size, rid, rtype, status = GB_HDR.unpack(recv_exact(sock, GB_HDR.size))
+            if size > GB_HDR.size:
+                recv_exact(sock, size - GB_HDR.size)
+            if rid != op_id or rtype != (GB_TYPE_PING | GB_TYPE_RESPONSE) or status != 0:
+                errors += 1
+            ops += 1
+            op_id = op_id + 1 if op_id < 0xffff else 1
+    finally:
+        sock.close()
+    results[cport] = (ops, errors)
+
+
+def run(address, base_port, cports, duration):
+    results = {}
+    deadline = time.monotonic() + duration
+    threads = [threading.Thread(target=bench_cport,
+                                args=(address, base_port + c, deadline, results, c))
+               for c in cports]
+
+    start = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - start
+
+    return results, elapsed
+
+
+def scale(args):
+    counts = []
+    n = 1
+    while n < len(args.cports):
+        counts.append(n)
+        n *= 2
+    counts.append(len(args.cports))
+
+    print('%6s %10s %10s %8s' % ('cports', 'ops/s', 'per cport', 'speedup'))
+    base = None
+    for n in counts:
+        results, elapsed = run(args.address, args.port, args.cports[:n], args.time)
+        if len(results) != n:
+            return 1
+        rate = sum(ops for ops, _ in results.values()) / elapsed
+        if base is None:
+            base = rate
+        print('%6u %10.0f %10.0f %7.2fx' % (n, rate, rate / n, rate / base))
+
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Greybus TCP/IP throughput benchmark')
+    parser.add_argument('-a', '--address', default='localhost',
+                        help='address of the Greybus device')
+    parser.add_argument('-p', '--port', type=int, default=4242,
+                        help='TCP port of CPort 0')
+    parser.add_argument('-c', '--cports', type=int, nargs='+', default=[0],
+                        help='CPorts to exercise concurrently')
+    parser.add_argument('-t', '--time', type=float, default=5.0,
+                        help='duration of the test in seconds')
+    parser.add_argument('-s', '--scale', action='store_true',
+                        help='report how the aggregate rate scales with the number of CPorts')
+    args = parser.parse_args()
+
+    if args.scale:
+        return scale(args)
+
+    results, elapsed = run(args.address, args.port, args.cports, args.time)
+
+    total = 0
+    for c in sorted(results):
+        ops, errors = results[c]
+        total += ops
+        print('cport %u: %u ops (%.0f ops/s), %u errors' % (c, ops, ops / elapsed, errors))
+    print('total: %u ops in %.2f s (%.0f ops/s)' % (total, elapsed, total / elapsed))
+
+    return 0 if len(results) == len(args.cports) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
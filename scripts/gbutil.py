@@ -46,11 +46,11 @@ def get_bundle_descriptors(defines):
     return bd
 
 
-def get_cport_descriptors(defines):
+def get_cports(defines):
     # add keys as necessary
     cport_keys = ['"zephyr,greybus-control"', '"zephyr,greybus-gpio-controller"',
                   '"zephyr,greybus-i2c-controller"', '"zephyr,greybus-spi-controller"']
-    cd = {}
+    cports = {}
     for key in defines:
         val = defines[key]
         if key.endswith('_P_compatible_IDX_0') and val in cport_keys:
@@ -58,13 +58,20 @@ def get_cport_descriptors(defines):
             id_ = int(defines[node + '_P_id'])
             bid = int(defines[defines[node + '_PARENT'] + '_P_id'])
             proto = int(defines[node + '_P_cport_protocol'])
-            cd[id_] = CPortDescriptor(id_, bid, proto, None)
-    return cd
+            cports[id_] = (bid, proto)
+    return cports
 
 
-def dt2mnfs(fn):
+def get_cport_descriptors(defines):
+    cd = {}
+    cports = get_cports(defines)
+    for id_ in cports:
+        bid, proto = cports[id_]
+        cd[id_] = CPortDescriptor(id_, bid, proto, None)
+    return cd
 
-    # extract defines
+
+def read_defines(fn):
     defines = {}
     with open(fn) as f:
         for line in f:
@@ -76,7 +83,12 @@ def dt2mnfs(fn):
                 val = line[len(key + ' '):]
                 val = val.strip()
                 defines[key] = val
+    return defines
+
 
+def dt2mnfs(fn):
+
+    defines = read_defines(fn)
     interface_desc = get_interface_descriptor(defines)
     string_descs = get_string_descriptors(defines, interface_desc)
     bundle_descs = get_bundle_descriptors(defines)
@@ -96,11 +108,42 @@ def dt2mnfs(fn):
     return m
 
 
+def dt2cport_table(fn):
+
+    defines = read_defines(fn)
+    bundle_descs = get_bundle_descriptors(defines)
+    cports = get_cports(defines)
+
+    # the core assumes that cport ids are dense, as they are in the manifest
+    if sorted(cports) != list(range(len(cports))):
+        raise ValueError('cport ids are not contiguous: {}'.format(
+            sorted(cports)))
+
+    s = '/* Generated by gbutil.py from devicetree, do not edit */\n\n'
+    s += '#define GB_CPORT_TABLE_MAX_BUNDLE_ID {}\n\n'.format(
+        max(bundle_descs, default=0))
+    s += '#define GB_CPORT_TABLE_ENTRIES'
+    for id_ in sorted(cports):
+        bid, proto = cports[id_]
+        s += ' \\\n\tGB_CPORT_TABLE_ENTRY({}, {}, {})'.format(
+            id_, bid, proto)
+    s += '\n'
+
+    return s
+
+
 if __name__ == '__main__':
-    if len(sys.argv) != 3:
-        print('usage: {} <input> <output>'.format(sys.argv[0]))
+    args = sys.argv[1:]
+    cport_table = '--cport-table' in args
+    if cport_table:
+        args.remove('--cport-table')
+    if len(args) != 2:
+        print('usage: {} [--cport-table] <input> <output>'.format(sys.argv[0]))
         sys.exit(1)
-    mnfs = dt2mnfs(sys.argv[1])
-    with open(sys.argv[2], 'w') as f:
-        f.write(str(mnfs))
+    if cport_table:
+        out = dt2cport_table(args[0])
+    else:
+        out = str(dt2mnfs(args[0]))
+    with open(args[1], 'w') as f:
+        f.write(out)
     sys.exit(0)
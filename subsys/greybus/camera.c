@@ -130,7 +130,7 @@ static uint8_t gb_camera_capabilities(struct gb_operation *operation)
         return gb_errno_to_op_result(ret);
     }
 
-    if (size > GB_MAX_PAYLOAD_SIZE) {
+    if (size > GB_MAX_OPERATION_PAYLOAD_SIZE) {
         return GB_OP_NO_MEMORY;
     }
 
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <sys/util.h>
+
+#include "fragment.h"
+
+size_t gb_fragment_build(const struct gb_operation_hdr *msg, size_t offset,
+                         struct gb_operation_hdr *frag_hdr)
+{
+    const uint8_t *payload = (const uint8_t *)(msg + 1);
+    struct gb_fragment_hdr *frag = (struct gb_fragment_hdr *)(frag_hdr + 1);
+    size_t payload_size = sys_le16_to_cpu(msg->size) - sizeof(*msg);
+    size_t chunk = MIN(payload_size - offset, GB_FRAGMENT_CHUNK_SIZE);
+
+    memset(frag_hdr, 0, sizeof(*frag_hdr) + sizeof(*frag));
+    frag_hdr->size = sys_cpu_to_le16(sizeof(*frag_hdr) + sizeof(*frag) +
+                                     chunk);
+    frag_hdr->id = msg->id;
+    frag_hdr->type = GB_TYPE_FRAGMENT;
+    frag_hdr->result = msg->result;
+    frag->type = msg->type;
+    frag->size = msg->size;
+    frag->offset = sys_cpu_to_le16(offset);
+    frag->flags = offset + chunk == payload_size ? GB_FRAGMENT_FLAG_LAST : 0;
+    memcpy(frag + 1, &payload[offset], chunk);
+
+    return chunk;
+}
+
+void gb_reassembly_abort(struct gb_reassembly *ra)
+{
+    if (ra->buf) {
+        k_mem_slab_free(ra->slab, (void **)&ra->buf);
+        ra->buf = NULL;
+    }
+}
+
+int gb_reassembly_add(struct gb_reassembly *ra,
+                      const struct gb_operation_hdr *hdr, size_t size,
+                      struct gb_operation_hdr **msg)
+{
+    const struct gb_fragment_hdr *frag =
+        (const struct gb_fragment_hdr *)(hdr + 1);
+    struct gb_operation_hdr *m;
+    size_t msg_size;
+    size_t offset;
+    size_t len;
+
+    if (size < sizeof(*hdr) + sizeof(*frag)) {
+        gb_reassembly_abort(ra);
+        return -EBADMSG;
+    }
+
+    msg_size = sys_le16_to_cpu(frag->size);
+    offset = sys_le16_to_cpu(frag->offset);
+    len = size - sizeof(*hdr) - sizeof(*frag);
+
+    if (offset == 0) {
+        /* a new message replaces one that was never completed */
+        gb_reassembly_abort(ra);
+
+        if (!gb_fragment_needed(msg_size) || msg_size > ra->max_size ||
+            (frag->type & ~GB_TYPE_RESPONSE_FLAG) == GB_TYPE_FRAGMENT) {
+            return -EMSGSIZE;
+        }
+
+        if (k_mem_slab_alloc(ra->slab, (void **)&ra->buf, K_NO_WAIT)) {
+            ra->buf = NULL;
+            return -ENOMEM;
+        }
+
+        m = (struct gb_operation_hdr *)ra->buf;
+        memset(m, 0, sizeof(*m));
+        m->size = frag->size;
+        m->id = hdr->id;
+        m->type = frag->type;
+        m->result = hdr->result;
+        ra->received = 0;
+    } else if (!ra->buf) {
+        return -ENOENT;
+    }
+
+    m = (struct gb_operation_hdr *)ra->buf;
+    if (hdr->id != m->id || frag->type != m->type ||
+        frag->size != m->size || offset != ra->received ||
+        sizeof(*m) + offset + len > msg_size) {
+        gb_reassembly_abort(ra);
+        return -EBADMSG;
+    }
+
+    memcpy(ra->buf + sizeof(*m) + offset, frag + 1, len);
+    ra->received += len;
+
+    if (!(frag->flags & GB_FRAGMENT_FLAG_LAST))
+        return -EAGAIN;
+
+    if (sizeof(*m) + ra->received != msg_size) {
+        gb_reassembly_abort(ra);
+        return -EBADMSG;
+    }
+
+    ra->buf = NULL;
+    *msg = m;
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef GREYBUS_FRAGMENT_H_
+#define GREYBUS_FRAGMENT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr.h>
+#include <greybus/greybus.h>
+
+/* payload bytes carried by each fragment */
+#define GB_FRAGMENT_CHUNK_SIZE \
+    (GB_MAX_PAYLOAD_SIZE - sizeof(struct gb_fragment_hdr))
+
+/* one message may be reassembled per cport at any time */
+struct gb_reassembly {
+    /* where messages are reassembled, in blocks of at least max_size */
+    struct k_mem_slab *slab;
+    size_t max_size;
+    uint8_t *buf;
+    size_t received;
+};
+
+/* only messages that do not fit in GB_MTU are fragmented */
+static inline bool gb_fragment_needed(size_t len)
+{
+    return len > GB_MTU;
+}
+
+/**
+ * @brief Build the fragment of @p msg that starts at payload @p offset
+ *
+ * @param msg a message for which gb_fragment_needed() is true
+ * @param offset where the fragment starts in the payload of @p msg
+ * @param frag_hdr room for GB_MTU bytes, sent as is
+ * @return the number of payload bytes in the fragment
+ */
+size_t gb_fragment_build(const struct gb_operation_hdr *msg, size_t offset,
+                         struct gb_operation_hdr *frag_hdr);
+
+/**
+ * @brief Add a received fragment to @p ra
+ *
+ * Fragments must arrive in order. Anything unexpected drops the message
+ * being reassembled, and its remaining fragments are ignored.
+ *
+ * @param hdr the GB_TYPE_FRAGMENT message
+ * @param size size of @p hdr
+ * @param msg set to the complete message, which then belongs to the caller
+ *        and is freed to the slab of @p ra
+ * @return 0 if the message is complete
+ * @return -EAGAIN if more fragments are expected
+ * @return -ENOENT for the rest of a message that was dropped
+ * @return -EMSGSIZE if the message may not be reassembled
+ * @return -ENOMEM if there was no buffer to reassemble the message
+ * @return -EBADMSG if the fragment was unexpected, or the message truncated
+ */
+int gb_reassembly_add(struct gb_reassembly *ra,
+                      const struct gb_operation_hdr *hdr, size_t size,
+                      struct gb_operation_hdr **msg);
+
+/**
+ * @brief Drop the message being reassembled, if any
+ */
+void gb_reassembly_abort(struct gb_reassembly *ra);
+
+#endif /* GREYBUS_FRAGMENT_H_ */
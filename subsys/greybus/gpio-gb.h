@@ -47,6 +47,25 @@
 #define GB_GPIO_TYPE_IRQ_EVENT          0x0e
 #define GB_GPIO_TYPE_RESPONSE           0x80    /* OR'd with rest */
 
+/* vendor extensions, see GB_GPIO_TYPE_GET_CAPABILITIES */
+#define GB_GPIO_TYPE_GET_CAPABILITIES   0x40
+#define GB_GPIO_TYPE_BULK_GET           0x41
+#define GB_GPIO_TYPE_BULK_SET           0x42
+#define GB_GPIO_TYPE_BULK_CONFIGURE     0x43
+#define GB_GPIO_TYPE_IRQ_COALESCE       0x44
+#define GB_GPIO_TYPE_IRQ_EVENTS         0x45
+#define GB_GPIO_TYPE_SEQUENCE_START     0x46
+#define GB_GPIO_TYPE_SEQUENCE_STOP      0x47
+#define GB_GPIO_TYPE_SEQUENCE_DONE      0x48
+#define GB_GPIO_TYPE_CAPTURE_START      0x49
+#define GB_GPIO_TYPE_CAPTURE_STOP       0x4a
+#define GB_GPIO_TYPE_CAPTURE_DATA       0x4b
+
+#define GB_GPIO_CAP_BULK                0x00000001
+#define GB_GPIO_CAP_IRQ_COALESCE        0x00000002
+#define GB_GPIO_CAP_SEQUENCE            0x00000004
+#define GB_GPIO_CAP_CAPTURE             0x00000008
+
 
 #define GB_GPIO_IRQ_TYPE_NONE           0x00000000
 #define GB_GPIO_IRQ_TYPE_EDGE_RISING    0x00000001
@@ -139,5 +158,118 @@ struct gb_gpio_irq_event_request {
 } __packed;
 /* irq event has no response */
 
+/* get capabilities request has no payload */
+struct gb_gpio_get_capabilities_response {
+	__le32	flags;
+	__le32	valid_mask;	/* lines that may be set in bulk masks */
+} __packed;
+
+/*
+ * Bulk operations act on every line in @mask at once, line n being bit n.
+ * Values are raw, i.e. they are not inverted for active-low lines.
+ */
+struct gb_gpio_bulk_get_request {
+	__le32	mask;
+} __packed;
+struct gb_gpio_bulk_get_response {
+	__le32	values;		/* only bits in mask are valid */
+} __packed;
+
+struct gb_gpio_bulk_set_request {
+	__le32	mask;
+	__le32	values;
+} __packed;
+/* bulk set response has no payload */
+
+struct gb_gpio_bulk_configure_request {
+	__le32	mask;
+	__le32	output_mask;	/* lines in mask to make outputs, others inputs */
+	__le32	values;		/* initial values of outputs */
+} __packed;
+/* bulk configure response has no payload */
+
+/*
+ * Once enabled, interrupts are reported with GB_GPIO_TYPE_IRQ_EVENTS
+ * rather than with one GB_GPIO_TYPE_IRQ_EVENT per line.
+ */
+struct gb_gpio_irq_coalesce_request {
+	__u8	enable;
+} __packed;
+/* irq coalesce response has no payload */
+
+struct gb_gpio_irq_event_entry {
+	__u8	which;
+	__u8	count;		/* edges since the last report, saturating */
+	__le32	timestamp_us;	/* time of the last edge, wrapping */
+} __packed;
+
+/* irq events requests are unidirectional, like irq event requests */
+struct gb_gpio_irq_events_request {
+	__le32	pins;
+	struct gb_gpio_irq_event_entry events[0];	/* one per bit in pins */
+} __packed;
+/* irq events has no response */
+
+/*
+ * A sequence applies each step in turn, as with a bulk set, and then waits
+ * delay_us before the next one. It is played @repeat times, or until it
+ * is stopped if @repeat is 0, and then reported with a sequence done
+ * request. Lines in step masks must already be configured as outputs.
+ */
+struct gb_gpio_sequence_step {
+	__le32	mask;
+	__le32	values;
+	__le32	delay_us;
+} __packed;
+
+struct gb_gpio_sequence_start_request {
+	__le16	repeat;
+	__le16	count;
+	struct gb_gpio_sequence_step steps[0];	/* count steps */
+} __packed;
+/* sequence start response has no payload */
+
+/* sequence stop request has no payload */
+/* sequence stop response has no payload */
+
+/* sequence done requests are unidirectional */
+struct gb_gpio_sequence_done_request {
+	__u8	result;		/* GB_OP_SUCCESS or GB_OP_INTERRUPTED */
+	__u8	pad;
+	__le16	runs;		/* complete passes through the sequence */
+} __packed;
+/* sequence done has no response */
+
+/*
+ * Lines in capture mode keep their interrupts enabled and do not generate
+ * irq event requests. Instead, their edges are reported with capture data
+ * requests every @period_ms, or sooner when a batch is full.
+ */
+struct gb_gpio_capture_start_request {
+	__le32	pins;
+	__u8	type;		/* GB_GPIO_IRQ_TYPE_EDGE_* */
+	__u8	pad;
+	__le16	period_ms;
+} __packed;
+struct gb_gpio_capture_start_response {
+	__le32	cycles_per_sec;	/* timestamp frequency */
+} __packed;
+
+/* capture stop request has no payload */
+/* capture stop response has no payload */
+
+struct gb_gpio_capture_event {
+	__le32	timestamp;	/* in cycles, wrapping */
+	__u8	which;
+} __packed;
+
+/* capture data requests are unidirectional */
+struct gb_gpio_capture_data_request {
+	__le32	dropped;	/* edges lost since the previous request */
+	__le16	count;
+	struct gb_gpio_capture_event events[0];	/* count events, oldest first */
+} __packed;
+/* capture data has no response */
+
 #endif /* __GPIO_GB_H__ */
 
@@ -32,7 +32,10 @@
 #include <drivers/gpio.h>
 #include <greybus/greybus.h>
 #include <greybus/platform.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/byteorder.h>
+#include <zephyr.h>
 
 #if defined(CONFIG_BOARD_NATIVE_POSIX_64BIT) \
 	|| defined(CONFIG_BOARD_NATIVE_POSIX_32BIT) \
@@ -49,6 +52,102 @@ LOG_MODULE_REGISTER(greybus_gpio, CONFIG_GREYBUS_LOG_LEVEL);
 #define GB_GPIO_VERSION_MAJOR 0
 #define GB_GPIO_VERSION_MINOR 1
 
+#ifdef CONFIG_GREYBUS_GPIO_SEQUENCE
+BUILD_ASSERT(sizeof(struct gb_gpio_sequence_start_request)
+	+ CONFIG_GREYBUS_GPIO_SEQUENCE_MAX_STEPS * sizeof(struct gb_gpio_sequence_step)
+	<= GB_MAX_PAYLOAD_SIZE, "GPIO sequences do not fit into a message");
+
+/*
+ * Played back on gb_gpio_seq_queue rather than from a timer handler, since
+ * updating a port may sleep, e.g. for a GPIO expander on I2C or SPI.
+ */
+struct gb_gpio_sequence {
+	struct k_delayed_work work;
+	struct k_work done_work;
+	atomic_t running;
+	uint8_t result;
+	uint16_t repeat;
+	uint16_t count;
+	uint16_t index;
+	uint16_t runs;
+	struct {
+		gpio_port_pins_t mask;
+		gpio_port_value_t values;
+		uint32_t delay_us;
+	} steps[CONFIG_GREYBUS_GPIO_SEQUENCE_MAX_STEPS];
+};
+#endif
+
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_GREYBUS_GPIO_CAPTURE_RING_SIZE),
+	"GPIO capture ring size must be a power of two");
+
+/* events per capture data request, sized for the system workqueue stack */
+#define GB_GPIO_CAPTURE_BATCH 48
+
+/*
+ * Edges are written by the interrupt callback and read by the capture work
+ * only, so head and tail each have a single writer and no lock is needed.
+ */
+struct gb_gpio_capture {
+	struct k_delayed_work work;
+	atomic_t pins;
+	k_timeout_t period;
+	atomic_t head;
+	atomic_t tail;
+	atomic_t dropped;
+	struct {
+		uint32_t cycles;
+		uint8_t which;
+	} ring[CONFIG_GREYBUS_GPIO_CAPTURE_RING_SIZE];
+};
+#endif
+
+/* resolved once in gb_gpio_init() rather than on every request */
+struct gb_gpio_bundle {
+	const struct device *dev;
+	unsigned int cport;
+	uint8_t line_count;
+	gpio_port_pins_t valid_mask;
+	/* line index to pin number, and back */
+	uint8_t line_pin[GPIO_MAX_PINS_PER_PORT];
+	uint8_t pin_line[GPIO_MAX_PINS_PER_PORT];
+
+	/* interrupts recorded by the callback, reported by irq_work */
+	struct gpio_callback callback;
+	struct k_delayed_work irq_work;
+	struct k_spinlock irq_lock;
+	gpio_port_pins_t irq_pending;
+	uint8_t irq_count[GPIO_MAX_PINS_PER_PORT];
+	int64_t irq_ticks[GPIO_MAX_PINS_PER_PORT];
+	bool irq_coalesce;
+
+#ifdef CONFIG_GREYBUS_GPIO_SEQUENCE
+	struct gb_gpio_sequence seq;
+#endif
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+	struct gb_gpio_capture capture;
+#endif
+};
+
+static inline struct gb_gpio_bundle *gb_gpio_bundle_get(struct gb_operation *operation)
+{
+	struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+
+	return (bundle == NULL) ? NULL : bundle->priv;
+}
+
+/* Greybus lines 0 .. line_count - 1 are the set bits of valid_mask, in order */
+static inline bool gb_gpio_line_valid(const struct gb_gpio_bundle *gpio, uint8_t which)
+{
+	return which < gpio->line_count;
+}
+
+static inline gpio_pin_t gb_gpio_line_pin(const struct gb_gpio_bundle *gpio, uint8_t which)
+{
+	return gpio->line_pin[which];
+}
+
 static uint8_t gb_gpio_protocol_version(struct gb_operation *operation)
 {
 	struct gb_gpio_proto_version_response *response;
@@ -65,52 +164,42 @@ static uint8_t gb_gpio_protocol_version(struct gb_operation *operation)
 static uint8_t gb_gpio_line_count(struct gb_operation *operation)
 {
 	struct gb_gpio_line_count_response *response;
-	const struct device *dev;
-	const struct gpio_driver_config *cfg;
-	uint8_t count;
+	struct gb_gpio_bundle *gpio;
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
-
 	response = gb_operation_alloc_response(operation, sizeof(*response));
 	if (!response)
 		return GB_OP_NO_MEMORY;
 
-	count = popcount(cfg->port_pin_mask);
-	if (!count)
+	if (!gpio->line_count)
 		return GB_OP_UNKNOWN_ERROR;
 
-	response->count = count - 1;
+	response->count = gpio->line_count - 1;
 
 	return GB_OP_SUCCESS;
 }
 
 static uint8_t gb_gpio_activate(struct gb_operation *operation)
 {
-	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_activate_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
-
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
 	/* No "activation" in Zephyr. Maybe power mgmt in the future */
@@ -120,25 +209,21 @@ static uint8_t gb_gpio_activate(struct gb_operation *operation)
 
 static uint8_t gb_gpio_deactivate(struct gb_operation *operation)
 {
-	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_activate_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
-
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
 	/* No "deactivation" in Zephyr. Maybe power mgmt in the future */
@@ -149,32 +234,31 @@ static uint8_t gb_gpio_deactivate(struct gb_operation *operation)
 static uint8_t gb_gpio_get_direction(struct gb_operation *operation)
 {
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_get_direction_response *response;
 	struct gb_gpio_get_direction_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
 	response = gb_operation_alloc_response(operation, sizeof(*response));
 	if (!response)
 		return GB_OP_NO_MEMORY;
 
-	bool dir = gpio_pin_get_direction(dev, request->which);
+	bool dir = gpio_pin_get_direction(dev, gb_gpio_line_pin(gpio, request->which));
 	/* In Greybus 0 := output, 1 := input. Zephyr is the opposite */
 	response->direction = !dir;
 	return GB_OP_SUCCESS;
@@ -183,59 +267,57 @@ static uint8_t gb_gpio_get_direction(struct gb_operation *operation)
 static uint8_t gb_gpio_direction_in(struct gb_operation *operation)
 {
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_direction_in_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
-	return gb_errno_to_op_result(gpio_pin_configure(dev, (gpio_pin_t)request->which, GPIO_INPUT));
+	return gb_errno_to_op_result(gpio_pin_configure(dev, gb_gpio_line_pin(gpio, request->which), GPIO_INPUT));
 }
 
 static uint8_t gb_gpio_direction_out(struct gb_operation *operation)
 {
 	int ret;
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_direction_out_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
-	ret = gpio_pin_configure(dev, request->which, GPIO_OUTPUT);
+	ret = gpio_pin_configure(dev, gb_gpio_line_pin(gpio, request->which), GPIO_OUTPUT);
 	if (ret != 0) {
 		return gb_errno_to_op_result(-ret);
 	}
 
-	ret = gpio_pin_set(dev, request->which, request->value);
+	ret = gpio_pin_set(dev, gb_gpio_line_pin(gpio, request->which), request->value);
 	if (ret != 0) {
 		return gb_errno_to_op_result(-ret);
 	}
@@ -246,86 +328,83 @@ static uint8_t gb_gpio_direction_out(struct gb_operation *operation)
 static uint8_t gb_gpio_get_value(struct gb_operation *operation)
 {
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_get_value_response *response;
 	struct gb_gpio_get_value_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
 	response = gb_operation_alloc_response(operation, sizeof(*response));
 	if (!response)
 		return GB_OP_NO_MEMORY;
 
-	response->value = gpio_pin_get(dev, (gpio_pin_t)request->which);
+	response->value = gpio_pin_get(dev, gb_gpio_line_pin(gpio, request->which));
 	return GB_OP_SUCCESS;
 }
 
 static uint8_t gb_gpio_set_value(struct gb_operation *operation)
 {
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_set_value_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
-	return gb_errno_to_op_result(gpio_pin_set(dev, request->which, request->value));
+	return gb_errno_to_op_result(gpio_pin_set(dev, gb_gpio_line_pin(gpio, request->which), request->value));
 }
 
 static uint8_t gb_gpio_set_debounce(struct gb_operation *operation)
 {
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_set_debounce_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
 	if (sys_le16_to_cpu(request->usec) > 0) {
-		return gb_errno_to_op_result(gpio_pin_configure(dev, (gpio_pin_t)request->which, GPIO_INT_DEBOUNCE));
+		return gb_errno_to_op_result(gpio_pin_configure(dev, gb_gpio_line_pin(gpio, request->which), GPIO_INT_DEBOUNCE));
 	}
 
 	return GB_OP_SUCCESS;
@@ -334,111 +413,210 @@ static uint8_t gb_gpio_set_debounce(struct gb_operation *operation)
 static uint8_t gb_gpio_irq_mask(struct gb_operation *operation)
 {
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_irq_mask_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
-	return gb_errno_to_op_result(gpio_pin_interrupt_configure(dev, request->which, GPIO_INT_DISABLE));
+	return gb_errno_to_op_result(gpio_pin_interrupt_configure(dev, gb_gpio_line_pin(gpio, request->which), GPIO_INT_DISABLE));
 }
 
 static uint8_t gb_gpio_irq_unmask(struct gb_operation *operation)
 {
 	const struct device *dev;
-	const struct gpio_driver_config *cfg;
+	struct gb_gpio_bundle *gpio;
 	struct gb_gpio_irq_unmask_request *request =
 		gb_operation_get_request_payload(operation);
 
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	dev = gpio->dev;
 
 	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
 		LOG_ERR("dropping short message");
 		return GB_OP_INVALID;
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
+	if (!gb_gpio_line_valid(gpio, request->which))
 		return GB_OP_INVALID;
 
-	return gb_errno_to_op_result(gpio_pin_interrupt_configure(dev, request->which, GPIO_INT_ENABLE | GPIO_INT_EDGE_RISING));
+	return gb_errno_to_op_result(gpio_pin_interrupt_configure(dev, gb_gpio_line_pin(gpio, request->which), GPIO_INT_ENABLE | GPIO_INT_EDGE_RISING));
 }
 
-int gb_gpio_irq_event(int irq, void *context, void *priv)
+/* events are reported without allocating, see gb_operation_send_unidirectional() */
+static void gb_gpio_send_event(struct gb_gpio_bundle *gpio, uint8_t type,
+	void *msg, size_t payload_size)
 {
-	struct gb_gpio_irq_event_request *request;
-	struct gb_operation *operation;
-	const struct device *dev = (const struct device *)context;
-	int cport = gb_device_to_cport(dev);
+	int r;
 
-	if (cport < 0) {
-		return -EINVAL;
+	r = gb_operation_send_unidirectional(gpio->cport, type, msg,
+		payload_size);
+	if (r != 0) {
+		LOG_ERR("failed to send event: %d", r);
 	}
+}
 
-	operation = gb_operation_create(cport, GB_GPIO_TYPE_IRQ_EVENT,
-									sizeof(*request));
-	if (!operation)
-		return OK;
-
-	request = gb_operation_get_request_payload(operation);
-	request->which = irq;
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+static void gb_gpio_capture_record(struct gb_gpio_bundle *gpio,
+	gpio_port_pins_t pins, uint32_t now)
+{
+	struct gb_gpio_capture *cap = &gpio->capture;
+	atomic_val_t head = atomic_get(&cap->head);
+	atomic_val_t tail = atomic_get(&cap->tail);
+	size_t i;
+
+	for (i = 0; pins != 0; ++i, pins >>= 1) {
+		if (!(pins & 1)) {
+			continue;
+		}
+		if ((atomic_val_t)(head - tail) >= CONFIG_GREYBUS_GPIO_CAPTURE_RING_SIZE) {
+			atomic_inc(&cap->dropped);
+			continue;
+		}
+		cap->ring[head & (CONFIG_GREYBUS_GPIO_CAPTURE_RING_SIZE - 1)].cycles = now;
+		cap->ring[head & (CONFIG_GREYBUS_GPIO_CAPTURE_RING_SIZE - 1)].which = i;
+		head++;
+	}
 
-	/* Host is responsible for unmasking. */
-	gpio_pin_interrupt_configure(dev, request->which, GPIO_INT_MODE_DISABLED);
+	/* publish the new entries */
+	atomic_set(&cap->head, head);
+
+	/*
+	 * Flush early rather than waiting for the period to expire. The
+	 * callback may run again before the work does, so only submit when
+	 * the work is not already queued to run.
+	 */
+	if ((atomic_val_t)(head - tail) >= GB_GPIO_CAPTURE_BATCH &&
+		!k_work_pending(&cap->work.work)) {
+		k_delayed_work_submit(&cap->work, K_NO_WAIT);
+	}
+}
+#endif
 
-	/* Send unidirectional operation. */
-	gb_operation_send_request_nowait(operation, NULL, false);
+static void gb_gpio_irq_callback(const struct device *port,
+	struct gpio_callback *cb, gpio_port_pins_t pins)
+{
+	struct gb_gpio_bundle *gpio = CONTAINER_OF(cb, struct gb_gpio_bundle, callback);
+	int64_t ticks = k_uptime_ticks();
+	k_spinlock_key_t key;
+	bool first;
+	size_t i;
+
+	ARG_UNUSED(port);
+
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+	gpio_port_pins_t captured = pins & (gpio_port_pins_t)atomic_get(&gpio->capture.pins);
+
+	if (captured != 0) {
+		gb_gpio_capture_record(gpio, captured, k_cycle_get_32());
+		pins &= ~captured;
+		if (pins == 0) {
+			return;
+		}
+	}
+#endif
 
-	gb_operation_destroy(operation);
+	key = k_spin_lock(&gpio->irq_lock);
+	first = gpio->irq_pending == 0 && pins != 0;
+	gpio->irq_pending |= pins;
+	for (i = 0; pins != 0; ++i, pins >>= 1) {
+		if (!(pins & 1)) {
+			continue;
+		}
+		if (gpio->irq_count[i] < UINT8_MAX) {
+			gpio->irq_count[i]++;
+		}
+		gpio->irq_ticks[i] = ticks;
+	}
+	k_spin_unlock(&gpio->irq_lock, key);
 
-	return OK;
+	/* only the first edge of a batch schedules a report */
+	if (first) {
+		k_delayed_work_submit(&gpio->irq_work,
+			K_USEC(CONFIG_GREYBUS_GPIO_IRQ_HOLDOFF_US));
+	}
 }
 
-static uint8_t gb_gpio_irq_type(struct gb_operation *operation)
+static void gb_gpio_irq_work(struct k_work *work)
 {
-	const struct device *dev;
-	const struct gpio_driver_config *cfg;
-	struct gb_gpio_irq_type_request *request =
-		gb_operation_get_request_payload(operation);
-	enum gpio_int_mode mode;
-	enum gpio_int_trig trigger;
-
-	dev = gb_cport_to_device(operation->cport);
-	if (dev == NULL) {
-		return GB_OP_INVALID;
+	struct gb_gpio_bundle *gpio =
+		CONTAINER_OF(work, struct gb_gpio_bundle, irq_work);
+	uint8_t msg[sizeof(struct gb_operation_hdr)
+		+ sizeof(struct gb_gpio_irq_events_request)
+		+ GPIO_MAX_PINS_PER_PORT * sizeof(struct gb_gpio_irq_event_entry)];
+	struct gb_gpio_irq_events_request *events =
+		(struct gb_gpio_irq_events_request *)(msg + sizeof(struct gb_operation_hdr));
+	struct gb_gpio_irq_event_request *event =
+		(struct gb_gpio_irq_event_request *)(msg + sizeof(struct gb_operation_hdr));
+	uint8_t count[GPIO_MAX_PINS_PER_PORT];
+	int64_t ticks[GPIO_MAX_PINS_PER_PORT];
+	gpio_port_pins_t pending;
+	k_spinlock_key_t key;
+	size_t n = 0;
+	size_t i;
+
+	key = k_spin_lock(&gpio->irq_lock);
+	pending = gpio->irq_pending;
+	memcpy(count, gpio->irq_count, sizeof(count));
+	memcpy(ticks, gpio->irq_ticks, sizeof(ticks));
+	gpio->irq_pending = 0;
+	memset(gpio->irq_count, 0, sizeof(gpio->irq_count));
+	k_spin_unlock(&gpio->irq_lock, key);
+
+	if (pending == 0) {
+		return;
 	}
 
-	cfg = (const struct gpio_driver_config *)dev->config;
-	__ASSERT_NO_MSG(cfg != NULL);
+	if (!gpio->irq_coalesce) {
+		for (i = 0; pending != 0; ++i, pending >>= 1) {
+			if (pending & 1) {
+				event->which = gpio->pin_line[i];
+				gb_gpio_send_event(gpio, GB_GPIO_TYPE_IRQ_EVENT, msg,
+					sizeof(*event));
+			}
+		}
+		return;
+	}
 
-	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
-		LOG_ERR("dropping short message");
-		return GB_OP_INVALID;
+	events->pins = sys_cpu_to_le32(pending);
+	for (i = 0; pending != 0; ++i, pending >>= 1) {
+		if (pending & 1) {
+			events->events[n].which = gpio->pin_line[i];
+			events->events[n].count = count[i];
+			/* truncated from 64 bits, so it wraps at 2^32 us */
+			events->events[n].timestamp_us = sys_cpu_to_le32(
+				(uint32_t)k_ticks_to_us_floor64(ticks[i]));
+			n++;
+		}
 	}
 
-	if (request->which >= popcount(cfg->port_pin_mask))
-		return GB_OP_INVALID;
+	gb_gpio_send_event(gpio, GB_GPIO_TYPE_IRQ_EVENTS, msg,
+		sizeof(*events) + n * sizeof(events->events[0]));
+}
 
-	switch(request->type) {
+static int gb_gpio_irq_flags(uint8_t type, gpio_flags_t *flags)
+{
+	enum gpio_int_mode mode;
+	enum gpio_int_trig trigger;
+
+	switch(type) {
 	case GB_GPIO_IRQ_TYPE_NONE:
 		mode = GPIO_INT_MODE_DISABLED;
 		trigger = 0;
@@ -461,15 +639,541 @@ static uint8_t gb_gpio_irq_type(struct gb_operation *operation)
 		break;
 	case GB_GPIO_IRQ_TYPE_LEVEL_LOW:
 		mode = GPIO_INT_MODE_LEVEL;
-		trigger = GPIO_INT_TRIG_HIGH;
+		trigger = GPIO_INT_TRIG_LOW;
 		break;
 	default:
+		return -EINVAL;
+	}
+
+	*flags = mode | trigger;
+
+	return 0;
+}
+
+static uint8_t gb_gpio_irq_type(struct gb_operation *operation)
+{
+	const struct device *dev;
+	struct gb_gpio_bundle *gpio;
+	struct gb_gpio_irq_type_request *request =
+		gb_operation_get_request_payload(operation);
+	gpio_flags_t flags;
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
 		return GB_OP_INVALID;
 	}
 
-	return gb_errno_to_op_result(gpio_pin_interrupt_configure(dev, request->which, mode | trigger));
+	dev = gpio->dev;
+
+	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	if (!gb_gpio_line_valid(gpio, request->which))
+		return GB_OP_INVALID;
+
+	if (gb_gpio_irq_flags(request->type, &flags) < 0)
+		return GB_OP_INVALID;
+
+	return gb_errno_to_op_result(gpio_pin_interrupt_configure(dev, gb_gpio_line_pin(gpio, request->which), flags));
 }
 
+static uint8_t gb_gpio_get_capabilities(struct gb_operation *operation)
+{
+	uint32_t flags;
+	struct gb_gpio_get_capabilities_response *response;
+	struct gb_gpio_bundle *gpio;
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	response = gb_operation_alloc_response(operation, sizeof(*response));
+	if (!response)
+		return GB_OP_NO_MEMORY;
+
+	flags = GB_GPIO_CAP_BULK | GB_GPIO_CAP_IRQ_COALESCE;
+	if (IS_ENABLED(CONFIG_GREYBUS_GPIO_SEQUENCE)) {
+		flags |= GB_GPIO_CAP_SEQUENCE;
+	}
+	if (IS_ENABLED(CONFIG_GREYBUS_GPIO_CAPTURE)) {
+		flags |= GB_GPIO_CAP_CAPTURE;
+	}
+
+	response->flags = sys_cpu_to_le32(flags);
+	response->valid_mask = sys_cpu_to_le32(gpio->valid_mask);
+
+	return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_gpio_bulk_get(struct gb_operation *operation)
+{
+	int ret;
+	uint32_t mask;
+	gpio_port_value_t values;
+	struct gb_gpio_bundle *gpio;
+	struct gb_gpio_bulk_get_response *response;
+	struct gb_gpio_bulk_get_request *request =
+		gb_operation_get_request_payload(operation);
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	mask = sys_le32_to_cpu(request->mask);
+	if (mask & ~gpio->valid_mask)
+		return GB_OP_INVALID;
+
+	response = gb_operation_alloc_response(operation, sizeof(*response));
+	if (!response)
+		return GB_OP_NO_MEMORY;
+
+	ret = gpio_port_get_raw(gpio->dev, &values);
+	if (ret < 0) {
+		return gb_errno_to_op_result(ret);
+	}
+
+	response->values = sys_cpu_to_le32(values & mask);
+
+	return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_gpio_bulk_set(struct gb_operation *operation)
+{
+	uint32_t mask;
+	struct gb_gpio_bundle *gpio;
+	struct gb_gpio_bulk_set_request *request =
+		gb_operation_get_request_payload(operation);
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	mask = sys_le32_to_cpu(request->mask);
+	if (mask & ~gpio->valid_mask)
+		return GB_OP_INVALID;
+
+	return gb_errno_to_op_result(gpio_port_set_masked_raw(gpio->dev, mask,
+		sys_le32_to_cpu(request->values)));
+}
+
+static uint8_t gb_gpio_bulk_configure(struct gb_operation *operation)
+{
+	int ret;
+	gpio_pin_t pin;
+	gpio_flags_t flags;
+	uint32_t mask;
+	uint32_t output_mask;
+	uint32_t values;
+	struct gb_gpio_bundle *gpio;
+	struct gb_gpio_bulk_configure_request *request =
+		gb_operation_get_request_payload(operation);
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	mask = sys_le32_to_cpu(request->mask);
+	output_mask = sys_le32_to_cpu(request->output_mask);
+	values = sys_le32_to_cpu(request->values);
+
+	if (mask & ~gpio->valid_mask)
+		return GB_OP_INVALID;
+
+	/* Zephyr has no port-wide configure, so this is per line */
+	for (pin = 0; mask != 0; ++pin, mask >>= 1) {
+		if (!(mask & 1)) {
+			continue;
+		}
+
+		if (output_mask & BIT(pin)) {
+			flags = (values & BIT(pin)) ? GPIO_OUTPUT_HIGH : GPIO_OUTPUT_LOW;
+		} else {
+			flags = GPIO_INPUT;
+		}
+
+		ret = gpio_pin_configure(gpio->dev, pin, flags);
+		if (ret < 0) {
+			return gb_errno_to_op_result(ret);
+		}
+	}
+
+	return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_gpio_irq_coalesce(struct gb_operation *operation)
+{
+	struct gb_gpio_bundle *gpio;
+	struct gb_gpio_irq_coalesce_request *request =
+		gb_operation_get_request_payload(operation);
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	gpio->irq_coalesce = !!request->enable;
+
+	return GB_OP_SUCCESS;
+}
+
+struct gb_gpio_flush {
+	struct k_work work;
+	struct k_sem done;
+};
+
+static void gb_gpio_flush_work(struct k_work *work)
+{
+	struct gb_gpio_flush *flush =
+		CONTAINER_OF(work, struct gb_gpio_flush, work);
+
+	k_sem_give(&flush->done);
+}
+
+/* wait until every item submitted to @queue so far has run */
+static void gb_gpio_flush_queue(struct k_work_q *queue)
+{
+	struct gb_gpio_flush flush;
+
+	__ASSERT(k_current_get() != &queue->thread,
+		"cannot flush a work queue from itself");
+
+	k_work_init(&flush.work, gb_gpio_flush_work);
+	k_sem_init(&flush.done, 0, 1);
+	k_work_submit_to_queue(queue, &flush.work);
+	k_sem_take(&flush.done, K_FOREVER);
+}
+
+#ifdef CONFIG_GREYBUS_GPIO_SEQUENCE
+static void gb_gpio_sequence_finish(struct gb_gpio_bundle *gpio, uint8_t result)
+{
+	if (atomic_cas(&gpio->seq.running, 1, 0)) {
+		gpio->seq.result = result;
+		k_work_submit(&gpio->seq.done_work);
+	}
+}
+
+static struct k_work_q gb_gpio_seq_queue;
+K_THREAD_STACK_DEFINE(gb_gpio_seq_stack, CONFIG_GREYBUS_GPIO_SEQUENCE_STACK_SIZE);
+
+static void gb_gpio_sequence_work(struct k_work *work)
+{
+	struct gb_gpio_bundle *gpio =
+		CONTAINER_OF(work, struct gb_gpio_bundle, seq.work);
+	struct gb_gpio_sequence *seq = &gpio->seq;
+	uint32_t delay;
+
+	for (;;) {
+		if (!atomic_get(&seq->running)) {
+			return;
+		}
+
+		if (seq->index == 0 && seq->repeat != 0 && seq->runs == seq->repeat) {
+			gb_gpio_sequence_finish(gpio, GB_OP_SUCCESS);
+			return;
+		}
+
+		gpio_port_set_masked_raw(gpio->dev, seq->steps[seq->index].mask,
+			seq->steps[seq->index].values);
+		delay = seq->steps[seq->index].delay_us;
+
+		/*
+		 * Go back to the queue at least once per pass, so that a
+		 * sequence of short delays cannot hog the CPU forever.
+		 */
+		if (++seq->index == seq->count) {
+			seq->index = 0;
+			seq->runs++;
+			k_delayed_work_submit_to_queue(&gb_gpio_seq_queue, &seq->work,
+				K_USEC(delay));
+			return;
+		}
+
+		if (delay > CONFIG_GREYBUS_GPIO_SEQUENCE_BUSY_WAIT_US) {
+			k_delayed_work_submit_to_queue(&gb_gpio_seq_queue, &seq->work,
+				K_USEC(delay));
+			return;
+		}
+
+		k_busy_wait(delay);
+	}
+}
+
+/* stop the sequence of @gpio, and wait until no step of it is running */
+static void gb_gpio_sequence_cancel(struct gb_gpio_bundle *gpio)
+{
+	atomic_clear(&gpio->seq.running);
+	k_delayed_work_cancel(&gpio->seq.work);
+
+	gb_gpio_flush_queue(&gb_gpio_seq_queue);
+
+	/* in case a step was running, and scheduled the next one */
+	k_delayed_work_cancel(&gpio->seq.work);
+}
+
+static void gb_gpio_sequence_done_work(struct k_work *work)
+{
+	struct gb_gpio_bundle *gpio =
+		CONTAINER_OF(work, struct gb_gpio_bundle, seq.done_work);
+	uint8_t msg[sizeof(struct gb_operation_hdr)
+		+ sizeof(struct gb_gpio_sequence_done_request)];
+	struct gb_gpio_sequence_done_request *done =
+		(struct gb_gpio_sequence_done_request *)(msg + sizeof(struct gb_operation_hdr));
+
+	done->result = gpio->seq.result;
+	done->pad = 0;
+	done->runs = sys_cpu_to_le16(gpio->seq.runs);
+
+	gb_gpio_send_event(gpio, GB_GPIO_TYPE_SEQUENCE_DONE, msg, sizeof(*done));
+}
+
+static uint8_t gb_gpio_sequence_start(struct gb_operation *operation)
+{
+	size_t i;
+	size_t count;
+	uint32_t mask;
+	struct gb_gpio_bundle *gpio;
+	struct gb_gpio_sequence *seq;
+	struct gb_gpio_sequence_start_request *request =
+		gb_operation_get_request_payload(operation);
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	seq = &gpio->seq;
+
+	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	count = sys_le16_to_cpu(request->count);
+	if (count == 0 || count > ARRAY_SIZE(seq->steps)) {
+		return GB_OP_INVALID;
+	}
+
+	if (gb_operation_get_request_payload_size(operation) <
+		sizeof(*request) + count * sizeof(request->steps[0])) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	for (i = 0; i < count; ++i) {
+		mask = sys_le32_to_cpu(request->steps[i].mask);
+		if (mask & ~gpio->valid_mask) {
+			return GB_OP_INVALID;
+		}
+	}
+
+	if (atomic_get(&seq->running)) {
+		return GB_OP_RETRY;
+	}
+
+	for (i = 0; i < count; ++i) {
+		seq->steps[i].mask = sys_le32_to_cpu(request->steps[i].mask);
+		seq->steps[i].values = sys_le32_to_cpu(request->steps[i].values);
+		seq->steps[i].delay_us = sys_le32_to_cpu(request->steps[i].delay_us);
+	}
+
+	seq->count = count;
+	seq->repeat = sys_le16_to_cpu(request->repeat);
+	seq->index = 0;
+	seq->runs = 0;
+
+	atomic_set(&seq->running, 1);
+	k_delayed_work_submit_to_queue(&gb_gpio_seq_queue, &seq->work, K_NO_WAIT);
+
+	return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_gpio_sequence_stop(struct gb_operation *operation)
+{
+	struct gb_gpio_bundle *gpio;
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	gb_gpio_sequence_finish(gpio, GB_OP_INTERRUPTED);
+	/* so that a new sequence may not be started under a running step */
+	gb_gpio_sequence_cancel(gpio);
+
+	return GB_OP_SUCCESS;
+}
+#endif /* CONFIG_GREYBUS_GPIO_SEQUENCE */
+
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+static void gb_gpio_capture_work(struct k_work *work)
+{
+	struct gb_gpio_bundle *gpio =
+		CONTAINER_OF(work, struct gb_gpio_bundle, capture.work);
+	struct gb_gpio_capture *cap = &gpio->capture;
+	uint8_t msg[sizeof(struct gb_operation_hdr)
+		+ sizeof(struct gb_gpio_capture_data_request)
+		+ GB_GPIO_CAPTURE_BATCH * sizeof(struct gb_gpio_capture_event)];
+	struct gb_gpio_capture_data_request *data =
+		(struct gb_gpio_capture_data_request *)(msg + sizeof(struct gb_operation_hdr));
+	atomic_val_t head = atomic_get(&cap->head);
+	atomic_val_t tail = atomic_get(&cap->tail);
+	atomic_val_t dropped = atomic_clear(&cap->dropped);
+	size_t n;
+
+	/* an empty batch is still sent when edges were dropped */
+	do {
+		for (n = 0; n < GB_GPIO_CAPTURE_BATCH && tail != head; ++n, ++tail) {
+			data->events[n].timestamp = sys_cpu_to_le32(
+				cap->ring[tail & (CONFIG_GREYBUS_GPIO_CAPTURE_RING_SIZE - 1)].cycles);
+			data->events[n].which =
+				cap->ring[tail & (CONFIG_GREYBUS_GPIO_CAPTURE_RING_SIZE - 1)].which;
+		}
+
+		/* hand the slots back to the callback */
+		atomic_set(&cap->tail, tail);
+
+		if (n == 0 && dropped == 0) {
+			break;
+		}
+
+		data->dropped = sys_cpu_to_le32(dropped);
+		data->count = sys_cpu_to_le16(n);
+		gb_gpio_send_event(gpio, GB_GPIO_TYPE_CAPTURE_DATA, msg,
+			sizeof(*data) + n * sizeof(data->events[0]));
+		dropped = 0;
+	} while (tail != head);
+
+	if (atomic_get(&cap->pins) != 0) {
+		k_delayed_work_submit(&cap->work, cap->period);
+	}
+}
+
+static uint8_t gb_gpio_capture_start(struct gb_operation *operation)
+{
+	int ret;
+	size_t i;
+	uint32_t pins;
+	uint16_t period_ms;
+	gpio_flags_t flags;
+	struct gb_gpio_bundle *gpio;
+	struct gb_gpio_capture_start_response *response;
+	struct gb_gpio_capture_start_request *request =
+		gb_operation_get_request_payload(operation);
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+		LOG_ERR("dropping short message");
+		return GB_OP_INVALID;
+	}
+
+	pins = sys_le32_to_cpu(request->pins);
+	period_ms = sys_le16_to_cpu(request->period_ms);
+	if (pins == 0 || (pins & ~gpio->valid_mask) || period_ms == 0) {
+		return GB_OP_INVALID;
+	}
+
+	/* levels would fire continuously while they are held */
+	if (gb_gpio_irq_flags(request->type, &flags) < 0 ||
+		!(flags & GPIO_INT_EDGE)) {
+		return GB_OP_INVALID;
+	}
+
+	if (atomic_get(&gpio->capture.pins) != 0) {
+		return GB_OP_RETRY;
+	}
+
+	response = gb_operation_alloc_response(operation, sizeof(*response));
+	if (!response)
+		return GB_OP_NO_MEMORY;
+
+	gpio->capture.period = K_MSEC(period_ms);
+	atomic_clear(&gpio->capture.dropped);
+	atomic_set(&gpio->capture.pins, pins);
+
+	for (i = 0; i < GPIO_MAX_PINS_PER_PORT; ++i) {
+		if (!(pins & BIT(i))) {
+			continue;
+		}
+		ret = gpio_pin_interrupt_configure(gpio->dev, i, flags);
+		if (ret < 0) {
+			LOG_ERR("gpio_pin_interrupt_configure() failed for pin %zu: %d", i, ret);
+			goto disable;
+		}
+	}
+
+	k_delayed_work_submit(&gpio->capture.work, gpio->capture.period);
+
+	response->cycles_per_sec = sys_cpu_to_le32(sys_clock_hw_cycles_per_sec());
+
+	return GB_OP_SUCCESS;
+
+disable:
+	atomic_clear(&gpio->capture.pins);
+	while (i-- > 0) {
+		if (pins & BIT(i)) {
+			gpio_pin_interrupt_configure(gpio->dev, i, GPIO_INT_DISABLE);
+		}
+	}
+
+	return gb_errno_to_op_result(ret);
+}
+
+static uint8_t gb_gpio_capture_stop(struct gb_operation *operation)
+{
+	size_t i;
+	gpio_port_pins_t pins;
+	struct gb_gpio_bundle *gpio;
+
+	gpio = gb_gpio_bundle_get(operation);
+	if (gpio == NULL) {
+		return GB_OP_INVALID;
+	}
+
+	pins = atomic_clear(&gpio->capture.pins);
+
+	for (i = 0; pins != 0; ++i, pins >>= 1) {
+		if (pins & 1) {
+			gpio_pin_interrupt_configure(gpio->dev, i, GPIO_INT_DISABLE);
+		}
+	}
+
+	/* report whatever is still buffered, without rescheduling */
+	k_delayed_work_submit(&gpio->capture.work, K_NO_WAIT);
+
+	return GB_OP_SUCCESS;
+}
+#endif /* CONFIG_GREYBUS_GPIO_CAPTURE */
+
 static struct gb_operation_handler gb_gpio_handlers[] = {
 	GB_HANDLER(GB_GPIO_TYPE_PROTOCOL_VERSION, gb_gpio_protocol_version),
 	GB_HANDLER(GB_GPIO_TYPE_LINE_COUNT, gb_gpio_line_count),
@@ -484,9 +1188,121 @@ static struct gb_operation_handler gb_gpio_handlers[] = {
 	GB_HANDLER(GB_GPIO_TYPE_IRQ_TYPE, gb_gpio_irq_type),
 	GB_HANDLER(GB_GPIO_TYPE_IRQ_MASK, gb_gpio_irq_mask),
 	GB_HANDLER(GB_GPIO_TYPE_IRQ_UNMASK, gb_gpio_irq_unmask),
+	GB_HANDLER(GB_GPIO_TYPE_GET_CAPABILITIES, gb_gpio_get_capabilities),
+	GB_HANDLER(GB_GPIO_TYPE_BULK_GET, gb_gpio_bulk_get),
+	GB_HANDLER(GB_GPIO_TYPE_BULK_SET, gb_gpio_bulk_set),
+	GB_HANDLER(GB_GPIO_TYPE_BULK_CONFIGURE, gb_gpio_bulk_configure),
+	GB_HANDLER(GB_GPIO_TYPE_IRQ_COALESCE, gb_gpio_irq_coalesce),
+#ifdef CONFIG_GREYBUS_GPIO_SEQUENCE
+	GB_HANDLER(GB_GPIO_TYPE_SEQUENCE_START, gb_gpio_sequence_start),
+	GB_HANDLER(GB_GPIO_TYPE_SEQUENCE_STOP, gb_gpio_sequence_stop),
+#endif
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+	GB_HANDLER(GB_GPIO_TYPE_CAPTURE_START, gb_gpio_capture_start),
+	GB_HANDLER(GB_GPIO_TYPE_CAPTURE_STOP, gb_gpio_capture_stop),
+#endif
 };
 
+static int gb_gpio_init(unsigned int cport, struct gb_bundle *bundle)
+{
+	int ret;
+	size_t i;
+	struct gb_gpio_bundle *gpio;
+	const struct gpio_driver_config *cfg;
+
+	__ASSERT_NO_MSG(bundle != NULL);
+
+	bundle->dev = (struct device *)gb_cport_to_device(cport);
+	if (!bundle->dev) {
+		return -EIO;
+	}
+
+	cfg = (const struct gpio_driver_config *)bundle->dev->config;
+	__ASSERT_NO_MSG(cfg != NULL);
+
+	gpio = calloc(1, sizeof(*gpio));
+	if (!gpio) {
+		return -ENOMEM;
+	}
+
+	gpio->dev = bundle->dev;
+	gpio->cport = cport;
+	gpio->valid_mask = cfg->port_pin_mask;
+	for (i = 0; i < GPIO_MAX_PINS_PER_PORT; ++i) {
+		if (gpio->valid_mask & BIT(i)) {
+			gpio->pin_line[i] = gpio->line_count;
+			gpio->line_pin[gpio->line_count++] = i;
+		}
+	}
+
+	k_delayed_work_init(&gpio->irq_work, gb_gpio_irq_work);
+#ifdef CONFIG_GREYBUS_GPIO_SEQUENCE
+	static bool seq_queue_started;
+
+	if (!seq_queue_started) {
+		k_work_q_start(&gb_gpio_seq_queue, gb_gpio_seq_stack,
+			K_THREAD_STACK_SIZEOF(gb_gpio_seq_stack),
+			CONFIG_GREYBUS_GPIO_SEQUENCE_PRIORITY);
+		k_thread_name_set(&gb_gpio_seq_queue.thread, "greybus_gpio_seq");
+		seq_queue_started = true;
+	}
+
+	k_delayed_work_init(&gpio->seq.work, gb_gpio_sequence_work);
+	k_work_init(&gpio->seq.done_work, gb_gpio_sequence_done_work);
+#endif
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+	k_delayed_work_init(&gpio->capture.work, gb_gpio_capture_work);
+#endif
+	gpio_init_callback(&gpio->callback, gb_gpio_irq_callback, cfg->port_pin_mask);
+	ret = gpio_add_callback(gpio->dev, &gpio->callback);
+	if (ret < 0) {
+		LOG_ERR("gpio_add_callback() failed for cport %u: %d", cport, ret);
+		free(gpio);
+		return ret;
+	}
+
+	bundle->priv = gpio;
+
+	return 0;
+}
+
+static void gb_gpio_exit(unsigned int cport, struct gb_bundle *bundle)
+{
+	struct gb_gpio_bundle *gpio = bundle->priv;
+
+	ARG_UNUSED(cport);
+
+	if (gpio != NULL) {
+		/* nothing is submitted again once these are stopped */
+		gpio_remove_callback(gpio->dev, &gpio->callback);
+#ifdef CONFIG_GREYBUS_GPIO_SEQUENCE
+		gb_gpio_sequence_cancel(gpio);
+#endif
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+		atomic_clear(&gpio->capture.pins);
+		k_delayed_work_cancel(&gpio->capture.work);
+#endif
+		k_delayed_work_cancel(&gpio->irq_work);
+
+		/*
+		 * Wait for handlers running or queued on the system work
+		 * queue, including seq.done_work, which cannot be cancelled.
+		 */
+		gb_gpio_flush_queue(&k_sys_work_q);
+
+#ifdef CONFIG_GREYBUS_GPIO_CAPTURE
+		/* in case a running capture work item rescheduled itself */
+		k_delayed_work_cancel(&gpio->capture.work);
+#endif
+		free(gpio);
+	}
+
+	bundle->priv = NULL;
+}
+
 struct gb_driver gpio_driver = {
+	.init = gb_gpio_init,
+	.exit = gb_gpio_exit,
 	.op_handlers = (struct gb_operation_handler*) gb_gpio_handlers,
 	.op_handlers_count = ARRAY_SIZE(gb_gpio_handlers),
 };
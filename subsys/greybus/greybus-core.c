@@ -35,6 +35,7 @@
 #include <greybus/tape.h>
 //#include <wdog.h>
 #include "greybus-stubs.h"
+#include "fragment.h"
 //#include <loopback-gb.h>
 #include <logging/log.h>
 
@@ -93,18 +94,16 @@ static int _m_clock_gettime(clockid_t clk_id, struct timespec *tp) {
 #define ONE_SEC_IN_MSEC         1000
 #define ONE_MSEC_IN_NSEC        1000000
 
-#ifndef CLOCKS_PER_SEC
-#define CLOCKS_PER_SEC 100
-#endif
-
 #define TIMEOUT_WD_DELAY    (TIMEOUT_IN_MS * CLOCKS_PER_SEC) / ONE_SEC_IN_MSEC
 
 #define DEBUGASSERT(x)
 #define atomic_init(ptr, val) *(ptr) = val
 
-struct wdog_s {
-	int woof;
-};
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+K_MEM_SLAB_DEFINE(gb_fragment_slab, ROUND_UP(CONFIG_GREYBUS_FRAGMENT_MAX_SIZE, 4),
+                  CONFIG_GREYBUS_FRAGMENT_BUFS, 4);
+#endif
+
 struct gb_cport_driver {
     struct gb_driver *driver;
     struct list_head tx_fifo;
@@ -114,6 +113,10 @@ struct gb_cport_driver {
     volatile bool exit_worker;
     struct wdog_s timeout_wd;
     struct gb_operation timedout_operation;
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+    struct gb_reassembly reassembly;
+    sem_t fragment_tx_lock;
+#endif
 };
 
 struct gb_tape_record_header {
@@ -133,6 +136,9 @@ static struct gb_operation_hdr timedout_hdr = {
     .result = GB_OP_TIMEOUT,
     .type = GB_TYPE_RESPONSE_FLAG,
 };
+#ifdef CONFIG_GREYBUS_LAZY_CPORTS
+static sem_t lazy_lock;
+#endif
 static struct gb_operation_hdr oom_hdr = {
     .size = sizeof(timedout_hdr),
     .result = GB_OP_NO_MEMORY,
@@ -270,6 +276,9 @@ static void gb_process_request(struct gb_operation_hdr *hdr,
     result = op_handler->handler(operation);
     LOG_DBG("%s: %u", log_strdup(gb_handler_name(op_handler)), result);
 
+    if (operation->response_deferred)
+        return;
+
     if (hdr->id)
         gb_operation_send_response(operation, result);
     op_mark_send_time(operation);
@@ -423,9 +432,7 @@ static void *gb_pending_message_worker(void *data)
     return NULL;
 }
 
-#if defined(CONFIG_UNIPRO_ZERO_COPY)
-static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
-                                                   size_t size)
+static struct gb_operation *gb_rx_wrap_operation(unsigned cport, void *data)
 {
     struct gb_operation *op;
 
@@ -438,6 +445,143 @@ static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
 
     return op;
 }
+
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+static bool gb_fragment_buf_owns(const void *data)
+{
+    const char *p = data;
+
+    return p >= gb_fragment_slab.buffer &&
+           p < gb_fragment_slab.buffer +
+               gb_fragment_slab.num_blocks * gb_fragment_slab.block_size;
+}
+
+/**
+ * Add a fragment to the message being reassembled on @cport.
+ *
+ * @return the complete message once the last fragment is received, which
+ *         is then owned by the caller, otherwise NULL
+ */
+static struct gb_operation_hdr *gb_fragment_rx(unsigned int cport,
+                                               struct gb_operation_hdr *hdr,
+                                               size_t size)
+{
+    struct gb_operation_hdr *msg;
+    int retval;
+
+    retval = gb_reassembly_add(&g_cport[cport].reassembly, hdr, size, &msg);
+    switch (retval) {
+    case 0:
+        return msg;
+    case -EAGAIN:
+    case -ENOENT:
+        break;
+    case -EMSGSIZE:
+        LOG_ERR("Cport %u: cannot reassemble message", cport);
+        break;
+    case -ENOMEM:
+        LOG_ERR("Cport %u: no reassembly buffer available", cport);
+        break;
+    default:
+        LOG_ERR("Cport %u: dropping message, unexpected fragment", cport);
+        break;
+    }
+
+    return NULL;
+}
+
+/**
+ * Send a message larger than GB_MTU as a series of fragments.
+ */
+static int gb_fragment_send(unsigned int cport, const void *buf, size_t len)
+{
+    const struct gb_operation_hdr *hdr = buf;
+    struct gb_operation_hdr *frag_hdr;
+    size_t payload_size = len - sizeof(*hdr);
+    size_t offset;
+    size_t chunk;
+    int retval = 0;
+
+    if (len > CONFIG_GREYBUS_FRAGMENT_MAX_SIZE) {
+        LOG_ERR("Cport %u: message too large (%zu)", cport, len);
+        return -EMSGSIZE;
+    }
+
+    frag_hdr = transport_backend->alloc_buf(GB_MTU);
+    if (!frag_hdr)
+        return -ENOMEM;
+
+    /* fragments are sent back to back, without waiting for the peer */
+    sem_wait(&g_cport[cport].fragment_tx_lock);
+    for (offset = 0; offset < payload_size; offset += chunk) {
+        chunk = gb_fragment_build(hdr, offset, frag_hdr);
+
+        retval = transport_backend->send(cport, frag_hdr,
+                                         sys_le16_to_cpu(frag_hdr->size));
+        if (retval)
+            break;
+    }
+    sem_post(&g_cport[cport].fragment_tx_lock);
+
+    transport_backend->free_buf(frag_hdr);
+
+    return retval;
+}
+#endif /* CONFIG_GREYBUS_FRAGMENTATION */
+
+static int gb_transport_send(unsigned int cport, const void *buf, size_t len)
+{
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+    if (gb_fragment_needed(len))
+        return gb_fragment_send(cport, buf, len);
+#endif
+
+    return transport_backend->send(cport, buf, len);
+}
+
+#ifdef CONFIG_GREYBUS_LAZY_CPORTS
+/**
+ * Register the driver of @cport the first time it is used, i.e. when the
+ * host connects it or sends the first message on it.
+ */
+static void gb_lazy_enable_cport(unsigned int cport)
+{
+    int64_t start;
+
+    sem_wait(&lazy_lock);
+    if (!g_cport[cport].driver) {
+        start = k_uptime_get();
+        if (enable_cport(cport) == 0) {
+            LOG_DBG("Cport %u enabled in %u ms", cport,
+                    (unsigned int)(k_uptime_get() - start));
+        }
+    }
+    sem_post(&lazy_lock);
+}
+#endif
+
+static void gb_rxbuf_free(unsigned int cport, void *data)
+{
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+    if (gb_fragment_buf_owns(data)) {
+        k_mem_slab_free(&gb_fragment_slab, &data);
+        return;
+    }
+#endif
+
+    if (transport_backend->rxbuf_free) {
+        transport_backend->rxbuf_free(cport, data);
+    } else {
+        unipro_rxbuf_free(cport, data);
+    }
+}
+
+#if defined(CONFIG_UNIPRO_ZERO_COPY)
+static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
+                                                   size_t size)
+{
+    return gb_rx_wrap_operation(cport, data);
+}
 #else
 static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
                                                    size_t size)
@@ -454,7 +598,8 @@ static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
 }
 #endif
 
-int greybus_rx_handler(unsigned int cport, void *data, size_t size)
+static int _greybus_rx_handler(unsigned int cport, void *data, size_t size,
+                               bool owned)
 {
     int flags;
     struct gb_operation *op;
@@ -468,8 +613,15 @@ int greybus_rx_handler(unsigned int cport, void *data, size_t size)
         return -EINVAL;
     }
 
+#ifdef CONFIG_GREYBUS_LAZY_CPORTS
+    if (!g_cport[cport].driver)
+        gb_lazy_enable_cport(cport);
+#endif
+
     if (!g_cport[cport].driver || !g_cport[cport].driver->op_handlers) {
         LOG_ERR("Cport %u does not have a valid driver registered", cport);
+        if (owned)
+            gb_rxbuf_free(cport, data);
         return 0;
     }
 
@@ -487,6 +639,22 @@ int greybus_rx_handler(unsigned int cport, void *data, size_t size)
 
     //LOG_HEXDUMP_DBG(data, size, "RX: ");
 
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+    if (hdr->type == GB_TYPE_FRAGMENT) {
+        struct gb_operation_hdr *msg = gb_fragment_rx(cport, hdr, hdr_size);
+
+        if (owned)
+            gb_rxbuf_free(cport, data);
+
+        if (msg && _greybus_rx_handler(cport, msg, sys_le16_to_cpu(msg->size),
+                                       true)) {
+            gb_rxbuf_free(cport, msg);
+        }
+
+        return 0;
+    }
+#endif
+
     if (gb_tape && gb_tape_fd >= 0) {
         struct gb_tape_record_header record_hdr = {
             .size = size,
@@ -501,10 +669,15 @@ int greybus_rx_handler(unsigned int cport, void *data, size_t size)
     if (op_handler && op_handler->fast_handler) {
         LOG_DBG("%s", gb_handler_name(op_handler));
         op_handler->fast_handler(cport, data);
+        if (owned)
+            gb_rxbuf_free(cport, data);
         return 0;
     }
 
-    op = gb_rx_create_operation(cport, data, hdr_size);
+    if (owned)
+        op = gb_rx_wrap_operation(cport, data);
+    else
+        op = gb_rx_create_operation(cport, data, hdr_size);
     if (!op)
         return -ENOMEM;
 
@@ -518,6 +691,21 @@ int greybus_rx_handler(unsigned int cport, void *data, size_t size)
     return 0;
 }
 
+int greybus_rx_handler(unsigned int cport, void *data, size_t size)
+{
+    return _greybus_rx_handler(cport, data, size, false);
+}
+
+/**
+ * Like greybus_rx_handler(), but the core takes ownership of @data instead
+ * of copying it. On success, @data is eventually released through the
+ * transport's rxbuf_free(). On failure, ownership stays with the caller.
+ */
+int greybus_rx_handler_owned(unsigned int cport, void *data, size_t size)
+{
+    return _greybus_rx_handler(cport, data, size, true);
+}
+
 static void gb_flush_tx_fifo(unsigned int cport)
 {
     struct list_head *iter, *iter_next;
@@ -540,6 +728,10 @@ int gb_unregister_driver(unsigned int cport)
 
     wd_cancel(&g_cport[cport].timeout_wd);
 
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+    gb_reassembly_abort(&g_cport[cport].reassembly);
+#endif
+
     g_cport[cport].exit_worker = true;
     sem_post(&g_cport[cport].rx_fifo_lock);
     pthread_join(g_cport[cport].thread, NULL);
@@ -681,6 +873,11 @@ int gb_listen(unsigned int cport)
         return -EINVAL;
     }
 
+#ifdef CONFIG_GREYBUS_LAZY_CPORTS
+    if (!g_cport[cport].driver)
+        gb_lazy_enable_cport(cport);
+#endif
+
     if (!g_cport[cport].driver) {
         LOG_ERR("No driver registered! Can not connect CP%u.", cport);
         return -EINVAL;
@@ -762,6 +959,10 @@ int gb_operation_send_request_nowait(struct gb_operation *operation,
         return -ENOTSUP;
     }
 
+    if (sys_le16_to_cpu(hdr->size) > GB_MTU) {
+        return -EMSGSIZE;
+    }
+
     hdr->id = 0;
     operation->callback = callback;
 
@@ -815,9 +1016,8 @@ int gb_operation_send_request(struct gb_operation *operation,
     }
 
     //LOG_HEXDUMP_DBG(operation->request_buffer, hdr->size, "TX: ");
-    retval = transport_backend->send(operation->cport,
-                                     operation->request_buffer,
-                                     sys_le16_to_cpu(hdr->size));
+    retval = gb_transport_send(operation->cport, operation->request_buffer,
+                               sys_le16_to_cpu(hdr->size));
     op_mark_send_time(operation);
     if (need_response && retval) {
         list_del(&operation->list);
@@ -830,6 +1030,31 @@ int gb_operation_send_request(struct gb_operation *operation,
     return retval;
 }
 
+/*
+ * Send a unidirectional request built in @msg, which has room for the
+ * operation header followed by @payload_size bytes of payload. No
+ * operation is created, so this is usable where allocating is not, e.g.
+ * for events and streamed data.
+ */
+int gb_operation_send_unidirectional(unsigned int cport, uint8_t type,
+                                     void *msg, size_t payload_size)
+{
+    struct gb_operation_hdr *hdr = msg;
+    size_t len = sizeof(*hdr) + payload_size;
+
+    if (!transport_backend || cport >= cport_count)
+        return -ENODEV;
+
+    if (g_cport[cport].exit_worker)
+        return -ENETDOWN;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->size = sys_cpu_to_le16(len);
+    hdr->type = type;
+
+    return gb_transport_send(cport, msg, len);
+}
+
 static void gb_operation_callback_sync(struct gb_operation *operation)
 {
     sem_post(&operation->sync_sem);
@@ -904,9 +1129,8 @@ int gb_operation_send_response(struct gb_operation *operation, uint8_t result)
 
     //LOG_HEXDUMP_DBG(operation->response_buffer, resp_hdr->size, "TX: ");
     gb_loopback_log_exit(operation->cport, operation, resp_hdr->size);
-    retval = transport_backend->send(operation->cport,
-                                     operation->response_buffer,
-                                     sys_le16_to_cpu(resp_hdr->size));
+    retval = gb_transport_send(operation->cport, operation->response_buffer,
+                               sys_le16_to_cpu(resp_hdr->size));
     if (retval) {
         LOG_ERR("Greybus backend failed to send: error %d", retval);
         if (has_allocated_response) {
@@ -921,6 +1145,33 @@ int gb_operation_send_response(struct gb_operation *operation, uint8_t result)
     return retval;
 }
 
+void gb_operation_defer_response(struct gb_operation *operation)
+{
+    DEBUGASSERT(operation);
+    DEBUGASSERT(!operation->response_deferred);
+
+    /* the cport worker drops its reference when the handler returns */
+    gb_operation_ref(operation);
+    operation->response_deferred = true;
+}
+
+int gb_operation_send_deferred_response(struct gb_operation *operation,
+                                        uint8_t result)
+{
+    struct gb_operation_hdr *hdr = operation->request_buffer;
+    int retval = 0;
+
+    DEBUGASSERT(operation->response_deferred);
+
+    if (hdr->id)
+        retval = gb_operation_send_response(operation, result);
+    op_mark_send_time(operation);
+
+    gb_operation_unref(operation);
+
+    return retval;
+}
+
 void *gb_operation_alloc_response(struct gb_operation *operation, size_t size)
 {
     struct gb_operation_hdr *req_hdr;
@@ -973,7 +1224,7 @@ void gb_operation_unref(struct gb_operation *operation)
     }
 
     if (operation->is_unipro_rx_buf) {
-        unipro_rxbuf_free(operation->cport, operation->request_buffer);
+        gb_rxbuf_free(operation->cport, operation->request_buffer);
     } else {
         transport_backend->free_buf(operation->request_buffer);
     }
@@ -1107,10 +1358,19 @@ int gb_init(struct gb_transport_backend *transport)
         wd_static(&g_cport[i].timeout_wd);
         g_cport[i].timedout_operation.request_buffer = &timedout_hdr;
         list_init(&g_cport[i].timedout_operation.list);
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+        g_cport[i].reassembly.slab = &gb_fragment_slab;
+        g_cport[i].reassembly.max_size = CONFIG_GREYBUS_FRAGMENT_MAX_SIZE;
+        sem_init(&g_cport[i].fragment_tx_lock, 0, 1);
+#endif
     }
 
     atomic_init(&request_id, (uint32_t) 0);
 
+#ifdef CONFIG_GREYBUS_LAZY_CPORTS
+    sem_init(&lazy_lock, 0, 1);
+#endif
+
     transport_backend = transport;
     transport_backend->init();
 
@@ -1129,6 +1389,9 @@ void gb_deinit(void)
 
         wd_delete(&g_cport[i].timeout_wd);
         sem_destroy(&g_cport[i].rx_fifo_lock);
+#ifdef CONFIG_GREYBUS_FRAGMENTATION
+        sem_destroy(&g_cport[i].fragment_tx_lock);
+#endif
     }
 
     free(g_cport);
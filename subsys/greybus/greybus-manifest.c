@@ -36,6 +36,7 @@
 
 #include <list.h>
 #include <sys/byteorder.h>
+#include <sys/util.h>
 #include <greybus-utils/utils.h>
 //#include <nuttx/util.h>
 
@@ -80,6 +81,7 @@ struct greybus {
     struct list_head cports;
     struct greybus_driver *drv;
     size_t max_bundle_id;
+    size_t num_cports;
 };
 
 static struct greybus g_greybus = {
@@ -101,6 +103,7 @@ static void *alloc_cport(void)
         return NULL;
 
     list_add(&g_greybus.cports, &gb_cport->list);
+    g_greybus.num_cports++;
     return gb_cport;
 }
 
@@ -113,135 +116,169 @@ static void free_cport(int cportid)
         if (gb_cport->id == cportid) {
             list_del(iter);
             free(gb_cport);
+            g_greybus.num_cports--;
         }
     }
 }
 
 #ifdef CONFIG_GREYBUS
-void enable_cports(void)
-{
-    struct list_head *iter;
-    struct gb_cport *gb_cport;
-    __attribute__((unused)) int cport_id;
-    __attribute__((unused)) int bundle_id;
-    __attribute__((unused)) int protocol;
-    list_foreach(&g_greybus.cports, iter) {
-        gb_cport = list_entry(iter, struct gb_cport, list);
-        cport_id = gb_cport->id;
-        bundle_id = gb_cport->bundle;
-        protocol = gb_cport->protocol;
+struct gb_protocol_driver {
+    const char *name;
+    void (*register_driver)(int cport, int bundle);
+};
 
+/* drivers indexed by protocol */
+static const struct gb_protocol_driver protocol_drivers[] = {
 #ifdef CONFIG_GREYBUS_CONTROL
-        if (protocol == GREYBUS_PROTOCOL_CONTROL) {
-            LOG_INF("Registering CONTROL greybus driver.");
-            gb_control_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_CONTROL] = { "CONTROL", gb_control_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_GPIO
-        if (protocol == GREYBUS_PROTOCOL_GPIO) {
-            LOG_INF("Registering GPIO greybus driver.");
-            gb_gpio_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_GPIO] = { "GPIO", gb_gpio_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_I2C
-        if (protocol == GREYBUS_PROTOCOL_I2C) {
-            LOG_INF("Registering I2C greybus driver.");
-            gb_i2c_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_I2C] = { "I2C", gb_i2c_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_POWER_SUPPLY
-        if (protocol == GREYBUS_PROTOCOL_POWER_SUPPLY) {
-            LOG_INF("Registering POWER_SUPPLY greybus driver.");
-            gb_power_supply_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_POWER_SUPPLY] = { "POWER_SUPPLY", gb_power_supply_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_LOOPBACK
-        if (protocol == GREYBUS_PROTOCOL_LOOPBACK) {
-            LOG_INF("Registering Loopback greybus driver.");
-            gb_loopback_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_LOOPBACK] = { "Loopback", gb_loopback_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_VIBRATOR
-        if (protocol == GREYBUS_PROTOCOL_VIBRATOR) {
-            LOG_INF("Registering VIBRATOR greybus driver.");
-            gb_vibrator_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_VIBRATOR] = { "VIBRATOR", gb_vibrator_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_USB_HOST
-        if (protocol == GREYBUS_PROTOCOL_USB) {
-            LOG_INF("Registering USB greybus driver.");
-            gb_usb_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_USB] = { "USB", gb_usb_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_PWM
-        if (protocol == GREYBUS_PROTOCOL_PWM) {
-            LOG_INF("Registering PWM greybus driver.");
-            gb_pwm_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_PWM] = { "PWM", gb_pwm_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_SPI
-        if (protocol == GREYBUS_PROTOCOL_SPI) {
-            LOG_INF("Registering SPI greybus driver.");
-            gb_spi_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_SPI] = { "SPI", gb_spi_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_UART
-        if (protocol == GREYBUS_PROTOCOL_UART) {
-            LOG_INF("Registering Uart greybus driver. id= %d", cport_id);
-            gb_uart_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_UART] = { "Uart", gb_uart_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_HID
-        if (protocol == GREYBUS_PROTOCOL_HID) {
-            LOG_INF("Registering HID greybus driver. id= %d", cport_id);
-            gb_hid_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_HID] = { "HID", gb_hid_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_LIGHTS
-        if (protocol == GREYBUS_PROTOCOL_LIGHTS) {
-            LOG_INF("Registering Lights greybus driver. id= %d", cport_id);
-            gb_lights_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_LIGHTS] = { "Lights", gb_lights_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_SDIO
-        if (protocol == GREYBUS_PROTOCOL_SDIO) {
-            LOG_INF("Registering SDIO greybus driver.");
-            gb_sdio_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_SDIO] = { "SDIO", gb_sdio_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_CAMERA
-        if (protocol == GREYBUS_PROTOCOL_CAMERA_MGMT) {
-            LOG_INF("Registering Camera greybus driver. id= %d", cport_id);
-            gb_camera_register(cport_id, bundle_id);
-        }
+    [GREYBUS_PROTOCOL_CAMERA_MGMT] = { "Camera", gb_camera_register },
 #endif
-
 #ifdef CONFIG_GREYBUS_AUDIO
-        if (protocol == GREYBUS_PROTOCOL_AUDIO_MGMT) {
-            LOG_INF("Registering Audio MGMT greybus driver.");
-            gb_audio_mgmt_register(cport_id, bundle_id);
+    [GREYBUS_PROTOCOL_AUDIO_MGMT] = { "Audio MGMT", gb_audio_mgmt_register },
+    [GREYBUS_PROTOCOL_AUDIO_DATA] = { "Audio DATA", gb_audio_data_register },
+#endif
+};
+
+static void register_cport(int cport_id, int bundle_id, int protocol)
+{
+    const struct gb_protocol_driver *drv;
+
+    if (protocol < 0 || (size_t)protocol >= ARRAY_SIZE(protocol_drivers)) {
+        return;
+    }
+
+    drv = &protocol_drivers[protocol];
+    if (!drv->register_driver) {
+        return;
+    }
+
+    LOG_INF("Registering %s greybus driver. id= %d", drv->name, cport_id);
+    drv->register_driver(cport_id, bundle_id);
+}
+
+#ifdef CONFIG_GREYBUS_CPORT_TABLE
+/*
+ * Generated from devicetree by gbutil.py along with the manifest, so that
+ * cports can be looked up without parsing it.
+ */
+#include "greybus_cports.h"
+
+struct gb_cport_entry {
+    uint8_t bundle;
+    uint8_t protocol;
+};
+
+#define GB_CPORT_TABLE_ENTRY(_id, _bundle, _protocol) \
+    [_id] = { .bundle = _bundle, .protocol = _protocol },
+
+static const struct gb_cport_entry cport_table[] = {
+    GB_CPORT_TABLE_ENTRIES
+};
+
+/*
+ * With CONFIG_GREYBUS_LAZY_CPORTS, only control cports are registered
+ * here. The others are registered by enable_cport() when first used.
+ */
+void enable_cports(void)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(cport_table); ++i) {
+        if (IS_ENABLED(CONFIG_GREYBUS_LAZY_CPORTS) &&
+            cport_table[i].protocol != GREYBUS_PROTOCOL_CONTROL) {
+            continue;
+        }
+
+        register_cport(i, cport_table[i].bundle, cport_table[i].protocol);
+    }
+}
+
+int enable_cport(unsigned int cport)
+{
+    if (cport >= ARRAY_SIZE(cport_table)) {
+        return -ENOENT;
+    }
+
+    register_cport(cport, cport_table[cport].bundle,
+                   cport_table[cport].protocol);
+    return 0;
+}
+#else
+/*
+ * With CONFIG_GREYBUS_LAZY_CPORTS, only control cports are registered
+ * here. The others are registered by enable_cport() when first used.
+ */
+void enable_cports(void)
+{
+    struct list_head *iter;
+    struct gb_cport *gb_cport;
+
+    list_foreach(&g_greybus.cports, iter) {
+        gb_cport = list_entry(iter, struct gb_cport, list);
+
+        if (IS_ENABLED(CONFIG_GREYBUS_LAZY_CPORTS) &&
+            gb_cport->protocol != GREYBUS_PROTOCOL_CONTROL) {
+            continue;
         }
 
-        if (protocol == GREYBUS_PROTOCOL_AUDIO_DATA) {
-            LOG_INF("Registering Audio DATA greybus driver.");
-            gb_audio_data_register(cport_id, bundle_id);
+        register_cport(gb_cport->id, gb_cport->bundle, gb_cport->protocol);
+    }
+}
+
+int enable_cport(unsigned int cport)
+{
+    struct list_head *iter;
+    struct gb_cport *gb_cport;
+
+    list_foreach(&g_greybus.cports, iter) {
+        gb_cport = list_entry(iter, struct gb_cport, list);
+        if ((unsigned int)gb_cport->id == cport) {
+            register_cport(gb_cport->id, gb_cport->bundle, gb_cport->protocol);
+            return 0;
         }
-#endif
     }
+
+    return -ENOENT;
 }
+#endif /* CONFIG_GREYBUS_CPORT_TABLE */
 #endif
 
 /*
@@ -475,14 +512,11 @@ struct list_head *get_manifest_cports(void)
 
 size_t manifest_get_num_cports(void)
 {
-	size_t r = 0;
-	struct list_head *iter;
-
-	list_foreach(&g_greybus.cports, iter) {
-		r++;
-	}
-
-	return r;
+#ifdef CONFIG_GREYBUS_CPORT_TABLE
+	return ARRAY_SIZE(cport_table);
+#else
+	return g_greybus.num_cports;
+#endif
 }
 
 int get_manifest_size(void)
@@ -494,5 +528,9 @@ int get_manifest_size(void)
 
 size_t manifest_get_max_bundle_id(void)
 {
+#ifdef CONFIG_GREYBUS_CPORT_TABLE
+    return GB_CPORT_TABLE_MAX_BUNDLE_ID;
+#else
     return g_greybus.max_bundle_id;
+#endif
 }
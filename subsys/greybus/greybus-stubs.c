@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <errno.h>
+#include <zephyr.h>
 #include <unipro/unipro.h>
 #include <logging/log.h>
 
@@ -7,21 +8,28 @@
 
 LOG_MODULE_REGISTER(greybus_stubs, LOG_LEVEL_INF);
 
+static void wd_work_fn(struct k_work *work)
+{
+	struct wdog_s *wd = CONTAINER_OF(work, struct wdog_s, work);
+
+	wd->callback(wd->argc, wd->cport);
+}
+
 void wd_cancel(struct wdog_s *wd) {
-	(void)wd;
-	LOG_DBG("");
+	(void)k_delayed_work_cancel(&wd->work);
 }
 void wd_delete(struct wdog_s *wd) {
-	(void)wd;
-	LOG_DBG("");
+	wd_cancel(wd);
 }
 void wd_start(struct wdog_s *wd, unsigned long delay, void (*callback)(int, uint32_t, ...), int integer, uint16_t cport) {
-	(void)wd;
-	LOG_DBG("");
+	wd->callback = callback;
+	wd->argc = integer;
+	wd->cport = cport;
+	k_delayed_work_submit(&wd->work,
+		K_MSEC(((uint64_t)delay * MSEC_PER_SEC) / CLOCKS_PER_SEC));
 }
 void wd_static(struct wdog_s *wd) {
-	(void)wd;
-	LOG_DBG("");
+	k_delayed_work_init(&wd->work, wd_work_fn);
 }
 
 void unipro_init(void) {
@@ -2,10 +2,26 @@
 #define __GREYBUS_STUBS_H__
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <zephyr.h>
 
-struct wdog_s;
+#ifndef CLOCKS_PER_SEC
+#define CLOCKS_PER_SEC 100
+#endif
 
-#define WDOG_ISACTIVE(wd) true
+/*
+ * NuttX-style watchdog, backed by a delayed work item on the system work
+ * queue. Delays are in units of 1 / CLOCKS_PER_SEC seconds.
+ */
+struct wdog_s {
+	struct k_delayed_work work;
+	void (*callback)(int, uint32_t, ...);
+	int argc;
+	uint16_t cport;
+};
+
+#define WDOG_ISACTIVE(wd) k_delayed_work_pending(&(wd)->work)
 
 void wd_cancel(struct wdog_s *wd);
 void wd_delete(struct wdog_s *wd);
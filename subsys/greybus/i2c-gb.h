@@ -37,6 +37,11 @@
 #define GB_I2C_PROTOCOL_VERSION             0x01
 #define GB_I2C_PROTOCOL_FUNCTIONALITY       0x02
 #define GB_I2C_PROTOCOL_TRANSFER            0x05
+/* vendor extensions, see periodic-gb.h */
+#define GB_I2C_PROTOCOL_PERIODIC_START      0x40
+#define GB_I2C_PROTOCOL_PERIODIC_STOP       0x41
+#define GB_I2C_PROTOCOL_PERIODIC_DATA       0x42
+#define GB_I2C_PROTOCOL_CACHE_STATS         0x43
 
 #define GB_I2C_FUNC_I2C                     0x00000001
 #define GB_I2C_FUNC_10BIT_ADDR              0x00000002
@@ -87,5 +92,14 @@ struct gb_i2c_transfer_rsp {
 	__u8	data[0];
 } __packed;
 
+struct gb_i2c_cache_stats_req {
+	__le16	addr;
+} __packed;
+
+struct gb_i2c_cache_stats_rsp {
+	__le32	hits;
+	__le32	misses;
+} __packed;
+
 #endif /* _GREYBUS_I2C_H_ */
 
@@ -28,15 +28,131 @@
  */
 
 #include <device.h>
+#include <devicetree.h>
 #include <drivers/i2c.h>
+#include <dt-bindings/greybus/i2c.h>
 #include <errno.h>
 #include <greybus/greybus.h>
 #include <greybus/platform.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/byteorder.h>
 #include <zephyr.h>
 
 #include "i2c-gb.h"
+#include "periodic.h"
+#include "periodic-gb.h"
+
+#define GB_I2C_NUM_BUSES \
+    MAX(1, DT_NUM_INST_STATUS_OKAY(zephyr_greybus_i2c_controller))
+
+/*
+ * One per I2C controller, shared by every cport that bridges it. Transfers
+ * on a bus are serialized, by its queue or else by its mutex, so they can
+ * share a single set of messages.
+ */
+struct gb_i2c_bus {
+    const struct device *dev;
+    struct i2c_msg msgs[CONFIG_GREYBUS_I2C_MAX_MSGS];
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+    /* transfers waiting for the bus, in arrival order */
+    struct k_work_q queue;
+    struct k_work work;
+    struct k_spinlock lock;
+    struct list_head pending;
+#else
+    /* every cport runs its transfers from a thread of its own */
+    struct k_mutex mutex;
+#endif
+};
+
+static struct gb_i2c_bus gb_i2c_buses[GB_I2C_NUM_BUSES];
+static K_MUTEX_DEFINE(gb_i2c_buses_mutex);
+
+#ifdef CONFIG_GREYBUS_I2C_CACHE
+struct gb_i2c_cache_config {
+    /* label of the I2C controller that the target is on */
+    const char *bus_name;
+    uint16_t addr;
+    uint8_t policy;
+    const uint8_t *volatile_regs;
+    size_t num_volatile;
+    const uint8_t *cacheable_regs;
+    size_t num_cacheable;
+    const uint8_t *write_through_regs;
+    size_t num_write_through;
+};
+
+/* the registers of one target, guarded by lock */
+struct gb_i2c_cache {
+    const struct device *dev;
+    struct k_mutex lock;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t cached[256 / 32];
+    uint32_t write_through[256 / 32];
+    uint32_t valid[256 / 32];
+    uint8_t regs[256];
+};
+
+#define GB_I2C_CACHE_REGS(node_id, prop) \
+    static const uint8_t _CONCAT(gb_i2c_cache_##prop##_, node_id)[] = \
+        DT_PROP_OR(node_id, prop, {});
+
+#define GB_I2C_CACHE_DEFINE_REGS(node_id) \
+    GB_I2C_CACHE_REGS(node_id, volatile_registers) \
+    GB_I2C_CACHE_REGS(node_id, cacheable_registers) \
+    GB_I2C_CACHE_REGS(node_id, write_through_registers)
+
+#define GB_I2C_CACHE_CONFIG(node_id) \
+    { \
+        .bus_name = DT_LABEL(DT_PHANDLE(DT_PARENT(node_id), \
+                                        greybus_i2c_controller)), \
+        .addr = DT_PROP(node_id, addr), \
+        .policy = DT_PROP(node_id, policy), \
+        .volatile_regs = _CONCAT(gb_i2c_cache_volatile_registers_, node_id), \
+        .num_volatile = DT_PROP_LEN_OR(node_id, volatile_registers, 0), \
+        .cacheable_regs = \
+            _CONCAT(gb_i2c_cache_cacheable_registers_, node_id), \
+        .num_cacheable = DT_PROP_LEN_OR(node_id, cacheable_registers, 0), \
+        .write_through_regs = \
+            _CONCAT(gb_i2c_cache_write_through_registers_, node_id), \
+        .num_write_through = \
+            DT_PROP_LEN_OR(node_id, write_through_registers, 0), \
+    },
+
+DT_FOREACH_STATUS_OKAY(zephyr_greybus_i2c_cache, GB_I2C_CACHE_DEFINE_REGS)
+
+static const struct gb_i2c_cache_config gb_i2c_cache_configs[] = {
+    DT_FOREACH_STATUS_OKAY(zephyr_greybus_i2c_cache, GB_I2C_CACHE_CONFIG)
+};
+
+static struct gb_i2c_cache gb_i2c_caches[ARRAY_SIZE(gb_i2c_cache_configs)];
+#endif
+
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+K_THREAD_STACK_ARRAY_DEFINE(gb_i2c_stacks, GB_I2C_NUM_BUSES,
+    CONFIG_GREYBUS_I2C_ASYNC_STACK_SIZE);
+#endif
+
+static struct gb_i2c_bus *gb_i2c_bus_find(unsigned int cport)
+{
+    const struct device *dev = gb_cport_to_device(cport);
+    size_t i;
+
+    for (i = 0; dev != NULL && i < ARRAY_SIZE(gb_i2c_buses); ++i) {
+        if (gb_i2c_buses[i].dev == dev) {
+            return &gb_i2c_buses[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct gb_i2c_bus *gb_i2c_bus_get(struct gb_operation *operation)
+{
+    return gb_i2c_bus_find(operation->cport);
+}
 
 static uint8_t gb_i2c_protocol_version(struct gb_operation *operation)
 {
@@ -72,35 +188,27 @@ static uint8_t gb_i2c_protocol_functionality(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
-static uint8_t gb_i2c_protocol_transfer(struct gb_operation *operation)
+/*
+ * Check that a transfer request of @req_size bytes is complete, and return
+ * its length, write data included, with the size of its read data.
+ */
+static int gb_i2c_transfer_check(const struct gb_i2c_transfer_req *request,
+                                 size_t req_size, size_t *read_size)
 {
     int i, op_count;
-    uint32_t size = 0;
-    int ret;
-    uint8_t *write_data;
+    size_t size = 0;
+    size_t write_size = 0;
     bool read_op;
-    int read_count = 0;
-    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
-    __ASSERT_NO_MSG(bundle != NULL);
-
-    struct i2c_msg *requests;
-
-    struct gb_i2c_transfer_desc *desc;
-    struct gb_i2c_transfer_req *request;
-    struct gb_i2c_transfer_rsp *response;
-    const size_t req_size = gb_operation_get_request_payload_size(operation);
-    uint16_t addr = -1;
+    const struct gb_i2c_transfer_desc *desc;
 
     if (req_size < sizeof(*request)) {
-        return GB_OP_INVALID;
+        return -EINVAL;
     }
 
-    request = gb_operation_get_request_payload(operation);
     op_count = sys_le16_to_cpu(request->op_count);
-    write_data = (uint8_t *)&request->desc[op_count];
 
     if (req_size < sizeof(*request) + op_count * sizeof(request->desc[0])) {
-        return GB_OP_INVALID;
+        return -EINVAL;
     }
 
     for (i = 0; i < op_count; i++) {
@@ -109,75 +217,656 @@ static uint8_t gb_i2c_protocol_transfer(struct gb_operation *operation)
 
         if (read_op)
             size += sys_le16_to_cpu(desc->size);
+        else
+            write_size += sys_le16_to_cpu(desc->size);
     }
 
-    response = gb_operation_alloc_response(operation, size);
-    if (!response) {
-        return GB_OP_NO_MEMORY;
+    if (req_size < sizeof(*request) + op_count * sizeof(request->desc[0])
+        + write_size) {
+        return -EINVAL;
     }
 
-    requests = malloc(sizeof(*requests) * op_count);
-    if (!requests) {
-        return GB_OP_NO_MEMORY;
+    *read_size = size;
+
+    return sizeof(*request) + op_count * sizeof(request->desc[0]) + write_size;
+}
+
+/*
+ * Build up to @num_msgs messages at a time for @op_count operations on
+ * target @addr, and run them on @dev as one bus transaction.
+ */
+static int gb_i2c_bus_transfer(const struct device *dev, struct i2c_msg *msgs,
+                               size_t num_msgs, uint16_t addr,
+                               const struct gb_i2c_transfer_desc *desc,
+                               int op_count, const uint8_t *write_data,
+                               uint8_t *read_data)
+{
+    int i;
+    int ret = 0;
+    size_t n = 0;
+    size_t split;
+    bool read_op;
+
+    /*
+     * i2c_transfer() is synchronous, so the messages only need to live
+     * until it returns. Runs longer than the bus has room for are issued
+     * as several consecutive calls, which each end with a STOP. A write
+     * followed by a read, e.g. of a register address and then of its
+     * value, needs a repeated start, so runs are never split between
+     * the two.
+     */
+    for (i = 0; i < op_count; i++) {
+        read_op = (sys_le16_to_cpu(desc[i].flags) & GB_I2C_M_RD) ? true : false;
+
+        msgs[n].flags = 0;
+        msgs[n].len  = sys_le16_to_cpu(desc[i].size);
+
+        if (read_op) {
+            msgs[n].flags |= I2C_MSG_READ;
+            msgs[n].buf = read_data;
+            read_data += msgs[n].len;
+        } else {
+            /* write buffers are only read by the driver */
+            msgs[n].buf = (uint8_t *)write_data;
+            write_data += msgs[n].len;
+        }
+        n++;
+
+        if (i == op_count - 1) {
+            msgs[n - 1].flags |= I2C_MSG_STOP;
+            ret = i2c_transfer(dev, msgs, n, addr);
+            break;
+        }
+
+        if (n < num_msgs) {
+            continue;
+        }
+
+        split = n;
+        if (!(msgs[n - 1].flags & I2C_MSG_READ) &&
+            (sys_le16_to_cpu(desc[i + 1].flags) & GB_I2C_M_RD)) {
+            /* keep the write with the read after it */
+            split--;
+        }
+        if (split == 0) {
+            /* only with room for a single message */
+            ret = -EINVAL;
+            break;
+        }
+
+        msgs[split - 1].flags |= I2C_MSG_STOP;
+        ret = i2c_transfer(dev, msgs, split, addr);
+        if (ret < 0) {
+            break;
+        }
+
+        n -= split;
+        memmove(msgs, &msgs[split], n * sizeof(msgs[0]));
+    }
+
+    return ret;
+}
+
+#ifdef CONFIG_GREYBUS_I2C_CACHE
+static inline bool gb_i2c_cache_test(const uint32_t *map, uint8_t reg)
+{
+    return (map[reg / 32] & BIT(reg % 32)) != 0;
+}
+
+static inline void gb_i2c_cache_assign(uint32_t *map, uint8_t reg, bool val)
+{
+    if (val) {
+        map[reg / 32] |= BIT(reg % 32);
+    } else {
+        map[reg / 32] &= ~BIT(reg % 32);
+    }
+}
+
+static struct gb_i2c_cache *gb_i2c_cache_get(const struct device *dev,
+                                             uint16_t addr)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(gb_i2c_caches); ++i) {
+        if (gb_i2c_caches[i].dev == dev &&
+            gb_i2c_cache_configs[i].addr == addr) {
+            return &gb_i2c_caches[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void gb_i2c_cache_attach(const struct device *dev)
+{
+    size_t i, j;
+    uint8_t policy;
+    struct gb_i2c_cache *cache;
+    const struct gb_i2c_cache_config *config;
+
+    for (i = 0; i < ARRAY_SIZE(gb_i2c_caches); ++i) {
+        cache = &gb_i2c_caches[i];
+        config = &gb_i2c_cache_configs[i];
+        if (strcmp(config->bus_name, dev->name) != 0) {
+            continue;
+        }
+
+        for (j = 0; j < ARRAY_SIZE(cache->regs); ++j) {
+            policy = config->policy;
+            if (memchr(config->volatile_regs, j, config->num_volatile)) {
+                policy = GB_I2C_CACHE_VOLATILE;
+            } else if (memchr(config->cacheable_regs, j,
+                              config->num_cacheable)) {
+                policy = GB_I2C_CACHE_CACHEABLE;
+            } else if (memchr(config->write_through_regs, j,
+                              config->num_write_through)) {
+                policy = GB_I2C_CACHE_WRITE_THROUGH;
+            }
+
+            gb_i2c_cache_assign(cache->cached, j,
+                                policy != GB_I2C_CACHE_VOLATILE);
+            gb_i2c_cache_assign(cache->write_through, j,
+                                policy == GB_I2C_CACHE_WRITE_THROUGH);
+        }
+
+        k_mutex_init(&cache->lock);
+        cache->dev = dev;
+    }
+}
+
+/*
+ * Serve a register read, i.e. a one byte write of the register address
+ * followed by a read, from the cache.
+ */
+static bool gb_i2c_cache_read(struct gb_i2c_cache *cache,
+                              const struct gb_i2c_transfer_desc *desc,
+                              int op_count, const uint8_t *write_data,
+                              uint8_t *read_data)
+{
+    unsigned int i;
+    unsigned int reg;
+    unsigned int size;
+    bool valid = true;
+
+    if (op_count != 2 ||
+        (sys_le16_to_cpu(desc[0].flags) & GB_I2C_M_RD) ||
+        sys_le16_to_cpu(desc[0].size) != 1 ||
+        !(sys_le16_to_cpu(desc[1].flags) & GB_I2C_M_RD)) {
+        return false;
+    }
+
+    reg = write_data[0];
+    size = sys_le16_to_cpu(desc[1].size);
+    if (size == 0 || reg + size > ARRAY_SIZE(cache->regs)) {
+        return false;
     }
 
-    if (op_count > 0) {
-    	addr = sys_le16_to_cpu(request->desc[0].addr);
+    for (i = reg; i < reg + size; ++i) {
+        if (!gb_i2c_cache_test(cache->cached, i)) {
+            /* volatile registers are neither hits nor misses */
+            return false;
+        }
+        valid &= gb_i2c_cache_test(cache->valid, i);
     }
 
+    if (!valid) {
+        cache->misses++;
+        return false;
+    }
+
+    memcpy(read_data, &cache->regs[reg], size);
+    cache->hits++;
+
+    return true;
+}
+
+/* follow the register address of the target through a completed run */
+static void gb_i2c_cache_update(struct gb_i2c_cache *cache,
+                                const struct gb_i2c_transfer_desc *desc,
+                                int op_count, const uint8_t *write_data,
+                                const uint8_t *read_data)
+{
+    int i;
+    size_t j;
+    size_t size;
+    uint8_t reg = 0;
+    bool known = false;
+
     for (i = 0; i < op_count; i++) {
-        desc = &request->desc[i];
-        read_op = (sys_le16_to_cpu(desc->flags) & GB_I2C_M_RD) ? true : false;
+        size = sys_le16_to_cpu(desc[i].size);
+
+        if (sys_le16_to_cpu(desc[i].flags) & GB_I2C_M_RD) {
+            for (j = 0; known && j < size; ++j, ++reg) {
+                if (gb_i2c_cache_test(cache->cached, reg)) {
+                    cache->regs[reg] = read_data[j];
+                    gb_i2c_cache_assign(cache->valid, reg, true);
+                }
+            }
+            read_data += size;
+            continue;
+        }
 
-        if (sys_le16_to_cpu(desc->addr) != addr) {
-        	/* Zephyr only allows a single address to be used */
-        	ret = -EINVAL;
-        	goto free_requests;
+        if (size > 0) {
+            reg = write_data[0];
+            known = true;
         }
 
-        requests[i].flags = 0;
-        requests[i].len  = sys_le16_to_cpu(desc->size);
+        for (j = 1; j < size; ++j, ++reg) {
+            if (gb_i2c_cache_test(cache->write_through, reg)) {
+                cache->regs[reg] = write_data[j];
+                gb_i2c_cache_assign(cache->valid, reg, true);
+            } else {
+                gb_i2c_cache_assign(cache->valid, reg, false);
+            }
+        }
+        write_data += size;
+    }
+}
+#endif
 
-        if (read_op) {
-            requests[i].flags |= I2C_MSG_READ;
-            requests[i].buf = &response->data[read_count];
-            read_count += sys_le16_to_cpu(desc->size);
-        } else {
-            requests[i].buf = write_data;
-            write_data += sys_le16_to_cpu(desc->size);
+/*
+ * Run an already validated request on @dev, with up to @num_msgs messages
+ * per bus transaction. Read data is stored in @read_data.
+ */
+static int gb_i2c_transfer_run(const struct device *dev, struct i2c_msg *msgs,
+                               size_t num_msgs,
+                               const struct gb_i2c_transfer_req *request,
+                               uint8_t *read_data)
+{
+    int i, j, n, op_count;
+    int ret = 0;
+    const uint8_t *write_data;
+    const struct gb_i2c_transfer_desc *desc;
+    uint16_t addr;
+#ifdef CONFIG_GREYBUS_I2C_CACHE
+    struct gb_i2c_cache *cache;
+#endif
+
+    op_count = sys_le16_to_cpu(request->op_count);
+    write_data = (const uint8_t *)&request->desc[op_count];
+
+    /*
+     * Zephyr addresses a single target per call, so each run of
+     * operations on the same address is a bus transaction of its own,
+     * and read data is laid out in request order regardless.
+     */
+    for (i = 0; i < op_count; i += n) {
+        desc = &request->desc[i];
+        addr = sys_le16_to_cpu(desc->addr);
+        for (n = 1; i + n < op_count &&
+             sys_le16_to_cpu(desc[n].addr) == addr; ++n) {
+        }
+
+#ifdef CONFIG_GREYBUS_I2C_CACHE
+        cache = gb_i2c_cache_get(dev, addr);
+        if (cache != NULL) {
+            k_mutex_lock(&cache->lock, K_FOREVER);
+            if (!gb_i2c_cache_read(cache, desc, n, write_data, read_data)) {
+                ret = gb_i2c_bus_transfer(dev, msgs, num_msgs, addr, desc, n,
+                                          write_data, read_data);
+                if (ret >= 0) {
+                    gb_i2c_cache_update(cache, desc, n, write_data,
+                                        read_data);
+                }
+            }
+            k_mutex_unlock(&cache->lock);
+        } else
+#endif
+        {
+            ret = gb_i2c_bus_transfer(dev, msgs, num_msgs, addr, desc, n,
+                                      write_data, read_data);
+        }
+        if (ret < 0) {
+            break;
+        }
+
+        for (j = 0; j < n; ++j) {
+            if (sys_le16_to_cpu(desc[j].flags) & GB_I2C_M_RD) {
+                read_data += sys_le16_to_cpu(desc[j].size);
+            } else {
+                write_data += sys_le16_to_cpu(desc[j].size);
+            }
         }
     }
 
-    ret = i2c_transfer(bundle->dev, requests, op_count, addr);
+    return ret;
+}
 
-free_requests:
-    free(requests);
+static uint8_t gb_i2c_transfer_execute(struct gb_i2c_bus *bus,
+                                       struct gb_operation *operation)
+{
+    struct gb_i2c_transfer_req *request =
+        gb_operation_get_request_payload(operation);
+    struct gb_i2c_transfer_rsp *response =
+        gb_operation_get_response_payload(operation);
+    int ret;
+
+    ret = gb_i2c_transfer_run(bus->dev, bus->msgs, ARRAY_SIZE(bus->msgs),
+                              request, response->data);
 
     return gb_errno_to_op_result(ret);
 }
 
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+static void gb_i2c_bus_work(struct k_work *work)
+{
+    struct gb_i2c_bus *bus = CONTAINER_OF(work, struct gb_i2c_bus, work);
+    struct gb_operation *operation;
+    k_spinlock_key_t key;
+    uint8_t result;
+
+    for (;;) {
+        key = k_spin_lock(&bus->lock);
+        if (list_is_empty(&bus->pending)) {
+            k_spin_unlock(&bus->lock, key);
+            break;
+        }
+        operation = list_entry(bus->pending.next, struct gb_operation, list);
+        list_del(&operation->list);
+        k_spin_unlock(&bus->lock, key);
+
+        result = gb_i2c_transfer_execute(bus, operation);
+        gb_operation_send_deferred_response(operation, result);
+    }
+}
+#endif
+
+static uint8_t gb_i2c_protocol_transfer(struct gb_operation *operation)
+{
+    int ret;
+    size_t size;
+    struct gb_i2c_bus *bus = gb_i2c_bus_get(operation);
+    struct gb_i2c_transfer_req *request;
+    struct gb_i2c_transfer_rsp *response;
+    const size_t req_size = gb_operation_get_request_payload_size(operation);
+
+    if (bus == NULL) {
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    ret = gb_i2c_transfer_check(request, req_size, &size);
+    if (ret < 0) {
+        return GB_OP_INVALID;
+    }
+
+    response = gb_operation_alloc_response(operation, size);
+    if (!response) {
+        return GB_OP_NO_MEMORY;
+    }
+
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+    /*
+     * Slow transfers, e.g. with clock stretching, would otherwise hold up
+     * every later request on this cport. Respond from the bus queue.
+     */
+    k_spinlock_key_t key;
+
+    gb_operation_defer_response(operation);
+
+    key = k_spin_lock(&bus->lock);
+    list_add(&bus->pending, &operation->list);
+    k_spin_unlock(&bus->lock, key);
+
+    k_work_submit_to_queue(&bus->queue, &bus->work);
+
+    return GB_OP_SUCCESS;
+#else
+    uint8_t result;
+
+    k_mutex_lock(&bus->mutex, K_FOREVER);
+    result = gb_i2c_transfer_execute(bus, operation);
+    k_mutex_unlock(&bus->mutex);
+
+    return result;
+#endif
+}
+
+#ifdef CONFIG_GREYBUS_PERIODIC
+/* a copy of the transfer request, with messages of its own */
+struct gb_i2c_periodic {
+    const struct device *dev;
+    size_t num_msgs;
+    struct i2c_msg *msgs;
+    struct gb_i2c_transfer_req *request;
+};
+
+static int gb_i2c_periodic_sample(void *script, uint8_t *data)
+{
+    struct gb_i2c_periodic *periodic = script;
+
+    return gb_i2c_transfer_run(periodic->dev, periodic->msgs,
+                               periodic->num_msgs, periodic->request, data);
+}
+
+static uint8_t gb_i2c_protocol_periodic_start(struct gb_operation *operation)
+{
+    int ret;
+    size_t len;
+    size_t size;
+    struct k_work_q *queue = NULL;
+    struct gb_i2c_bus *bus = gb_i2c_bus_get(operation);
+    struct gb_periodic_start_request *request;
+    struct gb_periodic_start_response *response;
+    struct gb_i2c_transfer_req *transfer;
+    struct gb_i2c_periodic *periodic;
+    size_t req_size = gb_operation_get_request_payload_size(operation);
+
+    if (bus == NULL || req_size < sizeof(*request)) {
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    transfer = (struct gb_i2c_transfer_req *)&request[1];
+    req_size -= sizeof(*request);
+
+    ret = gb_i2c_transfer_check(transfer, req_size, &size);
+    /* the transfer is followed by its compare mask */
+    if (ret < 0 || size == 0 || req_size - ret < size) {
+        return GB_OP_INVALID;
+    }
+    len = ret;
+
+    response = gb_operation_alloc_response(operation, sizeof(*response));
+    if (!response) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    periodic = malloc(sizeof(*periodic) + ARRAY_SIZE(bus->msgs)
+                      * sizeof(periodic->msgs[0]) + len);
+    if (periodic == NULL) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    periodic->dev = bus->dev;
+    periodic->num_msgs = MIN(ARRAY_SIZE(bus->msgs),
+                             MAX(1, sys_le16_to_cpu(transfer->op_count)));
+    periodic->msgs = (struct i2c_msg *)&periodic[1];
+    periodic->request =
+        (struct gb_i2c_transfer_req *)&periodic->msgs[periodic->num_msgs];
+    memcpy(periodic->request, transfer, len);
+
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+    /* samples then queue up with the host's own transfers on this bus */
+    queue = &bus->queue;
+#endif
+
+    ret = gb_periodic_start(operation->cport, GB_I2C_PROTOCOL_PERIODIC_DATA,
+                            queue, gb_i2c_periodic_sample, periodic, size,
+                            (uint8_t *)transfer + len,
+                            sys_le16_to_cpu(request->batch),
+                            sys_le32_to_cpu(request->period_us));
+    if (ret < 0) {
+        free(periodic);
+        return gb_errno_to_op_result(ret);
+    }
+
+    response->id = ret;
+
+    return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_i2c_protocol_periodic_stop(struct gb_operation *operation)
+{
+    struct gb_periodic_stop_request *request =
+        gb_operation_get_request_payload(operation);
+
+    if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        return GB_OP_INVALID;
+    }
+
+    return gb_errno_to_op_result(gb_periodic_stop(operation->cport,
+                                                  request->id));
+}
+#endif
+
+#ifdef CONFIG_GREYBUS_I2C_CACHE
+static uint8_t gb_i2c_protocol_cache_stats(struct gb_operation *operation)
+{
+    struct gb_i2c_bus *bus = gb_i2c_bus_get(operation);
+    struct gb_i2c_cache_stats_req *request =
+        gb_operation_get_request_payload(operation);
+    struct gb_i2c_cache_stats_rsp *response;
+    struct gb_i2c_cache *cache;
+
+    if (bus == NULL ||
+        gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        return GB_OP_INVALID;
+    }
+
+    cache = gb_i2c_cache_get(bus->dev, sys_le16_to_cpu(request->addr));
+    if (cache == NULL) {
+        return GB_OP_NONEXISTENT;
+    }
+
+    response = gb_operation_alloc_response(operation, sizeof(*response));
+    if (!response) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    k_mutex_lock(&cache->lock, K_FOREVER);
+    response->hits = sys_cpu_to_le32(cache->hits);
+    response->misses = sys_cpu_to_le32(cache->misses);
+    k_mutex_unlock(&cache->lock);
+
+    return GB_OP_SUCCESS;
+}
+#endif
+
 static int gb_i2c_init(unsigned int cport, struct gb_bundle *bundle)
 {
-	__ASSERT_NO_MSG(bundle != NULL);
+    int ret = 0;
+    size_t i;
+    const struct device *dev;
+    struct gb_i2c_bus *bus = NULL;
 
-    bundle->dev = (struct device *)gb_cport_to_device(cport);
-    if (!bundle->dev) {
+    dev = gb_cport_to_device(cport);
+    if (!dev) {
         return -EIO;
     }
 
-    return 0;
+    if (bundle != NULL) {
+        bundle->dev = (struct device *)dev;
+    }
+
+    k_mutex_lock(&gb_i2c_buses_mutex, K_FOREVER);
+
+    /* cports that bridge the same controller share its bus */
+    for (i = 0; i < ARRAY_SIZE(gb_i2c_buses); ++i) {
+        if (gb_i2c_buses[i].dev == dev) {
+            goto unlock;
+        }
+        if (bus == NULL && gb_i2c_buses[i].dev == NULL) {
+            bus = &gb_i2c_buses[i];
+        }
+    }
+
+    if (bus == NULL) {
+        ret = -ENOMEM;
+        goto unlock;
+    }
+
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+    list_init(&bus->pending);
+    k_work_init(&bus->work, gb_i2c_bus_work);
+    k_work_q_start(&bus->queue, gb_i2c_stacks[bus - gb_i2c_buses],
+        K_THREAD_STACK_SIZEOF(gb_i2c_stacks[0]),
+        CONFIG_GREYBUS_I2C_ASYNC_PRIORITY);
+    k_thread_name_set(&bus->queue.thread, dev->name);
+#else
+    k_mutex_init(&bus->mutex);
+#endif
+
+#ifdef CONFIG_GREYBUS_I2C_CACHE
+    gb_i2c_cache_attach(dev);
+#endif
+
+    bus->dev = dev;
+
+unlock:
+    k_mutex_unlock(&gb_i2c_buses_mutex);
+
+    return ret;
 }
 
 static void gb_i2c_exit(unsigned int cport, struct gb_bundle *bundle)
 {
-	ARG_UNUSED(cport);
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+    struct gb_i2c_bus *bus;
+    struct gb_operation *operation;
+    struct list_head *iter, *iter_next;
+    struct list_head cancelled;
+    k_spinlock_key_t key;
+#endif
+
 	ARG_UNUSED(bundle);
+
+#ifdef CONFIG_GREYBUS_PERIODIC
+    gb_periodic_stop(cport, -1);
+#endif
+
+#ifdef CONFIG_GREYBUS_I2C_ASYNC
+    /*
+     * Transfers of this cport that did not reach the bus yet are failed.
+     * Their responses, like that of a transfer in progress, are then
+     * dropped, since the cport is down.
+     */
+    bus = gb_i2c_bus_find(cport);
+    if (bus != NULL) {
+        list_init(&cancelled);
+
+        key = k_spin_lock(&bus->lock);
+        list_foreach_safe(&bus->pending, iter, iter_next) {
+            operation = list_entry(iter, struct gb_operation, list);
+            if (operation->cport == cport) {
+                list_del(iter);
+                list_add(&cancelled, iter);
+            }
+        }
+        k_spin_unlock(&bus->lock, key);
+
+        list_foreach_safe(&cancelled, iter, iter_next) {
+            operation = list_entry(iter, struct gb_operation, list);
+            list_del(iter);
+            gb_operation_send_deferred_response(operation, GB_OP_INTERRUPTED);
+        }
+    }
+#endif
+
+    /* the bus and its queue are kept for when the cport comes back */
 }
 
 static struct gb_operation_handler gb_i2c_handlers[] = {
     GB_HANDLER(GB_I2C_PROTOCOL_VERSION, gb_i2c_protocol_version),
     GB_HANDLER(GB_I2C_PROTOCOL_FUNCTIONALITY, gb_i2c_protocol_functionality),
     GB_HANDLER(GB_I2C_PROTOCOL_TRANSFER, gb_i2c_protocol_transfer),
+#ifdef CONFIG_GREYBUS_PERIODIC
+    GB_HANDLER(GB_I2C_PROTOCOL_PERIODIC_START, gb_i2c_protocol_periodic_start),
+    GB_HANDLER(GB_I2C_PROTOCOL_PERIODIC_STOP, gb_i2c_protocol_periodic_stop),
+#endif
+#ifdef CONFIG_GREYBUS_I2C_CACHE
+    GB_HANDLER(GB_I2C_PROTOCOL_CACHE_STATS, gb_i2c_protocol_cache_stats),
+#endif
 };
 
 static struct gb_driver gb_i2c_driver = {
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _GREYBUS_PERIODIC_H_
+#define _GREYBUS_PERIODIC_H_
+
+#include <greybus/types.h>
+
+/*
+ * Periodic transfers are started with a protocol specific request. It
+ * begins with struct gb_periodic_start_request, followed by the transfer
+ * to run, in the format of that protocol's transfer request, and then by
+ * a compare mask with one byte per byte of read data.
+ *
+ * A sample is reported when its read data, masked, differs from that of
+ * the previously reported sample. An all-zero mask reports every sample.
+ * Reported samples are sent in data requests of @batch samples each, or
+ * of fewer samples once @batch periods have passed since the first one.
+ */
+struct gb_periodic_start_request {
+	__le32	period_us;
+	__le16	batch;
+	__u8	pad[2];
+} __packed;
+
+struct gb_periodic_start_response {
+	__u8	id;
+} __packed;
+
+struct gb_periodic_stop_request {
+	__u8	id;
+} __packed;
+/* periodic stop response has no payload */
+
+struct gb_periodic_sample {
+	__le32	timestamp_us;
+	__u8	data[0];
+} __packed;
+
+/* periodic data requests are unidirectional */
+struct gb_periodic_data_request {
+	__u8	id;
+	__u8	result;		/* set if a failed transfer ended the batch early */
+	__le16	count;
+	__le16	missed;		/* periods skipped because sampling fell behind */
+	__u8	pad[2];
+	__u8	samples[0];	/* count struct gb_periodic_sample */
+} __packed;
+/* periodic data has no response */
+
+#endif /* _GREYBUS_PERIODIC_H_ */
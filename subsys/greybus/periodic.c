@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <greybus/greybus.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <sys/util.h>
+#include <zephyr.h>
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(greybus_periodic, CONFIG_GREYBUS_LOG_LEVEL);
+
+#include "periodic.h"
+#include "periodic-gb.h"
+
+struct gb_periodic {
+	/* the timer only queues work, samples are taken on the work queue */
+	struct k_timer timer;
+	struct k_work work;
+	struct k_work stop;
+	struct k_work_q *queue;
+	gb_periodic_sample_t sample;
+	void *script;
+	atomic_t stopping;
+	struct k_sem stopped;
+	atomic_t missed;
+	unsigned int cport;
+	uint8_t type;
+	uint8_t id;
+	bool primed;
+	bool filter;
+	uint16_t batch;
+	uint16_t count;
+	/* periods since the first sample of the batch was taken */
+	uint16_t age;
+	size_t size;
+	uint8_t *mask;
+	uint8_t *last;
+	/* operation header, data request and up to batch samples */
+	uint8_t *msg;
+};
+
+static struct gb_periodic *transfers[CONFIG_GREYBUS_PERIODIC_MAX];
+static K_MUTEX_DEFINE(transfers_mutex);
+
+static inline size_t gb_periodic_sample_size(const struct gb_periodic *periodic)
+{
+	return sizeof(struct gb_periodic_sample) + periodic->size;
+}
+
+static inline struct gb_periodic_data_request *
+gb_periodic_data(const struct gb_periodic *periodic)
+{
+	return (struct gb_periodic_data_request *)
+		(periodic->msg + sizeof(struct gb_operation_hdr));
+}
+
+static void gb_periodic_submit(struct gb_periodic *periodic,
+	struct k_work *work)
+{
+	if (periodic->queue != NULL) {
+		k_work_submit_to_queue(periodic->queue, work);
+	} else {
+		k_work_submit(work);
+	}
+}
+
+static void gb_periodic_timer(struct k_timer *timer)
+{
+	struct gb_periodic *periodic =
+		CONTAINER_OF(timer, struct gb_periodic, timer);
+
+	/* the previous sample has not even started */
+	if (k_work_pending(&periodic->work)) {
+		atomic_inc(&periodic->missed);
+		return;
+	}
+
+	gb_periodic_submit(periodic, &periodic->work);
+}
+
+static void gb_periodic_flush(struct gb_periodic *periodic, uint8_t result)
+{
+	struct gb_periodic_data_request *data = gb_periodic_data(periodic);
+	size_t len = sizeof(*data)
+		+ periodic->count * gb_periodic_sample_size(periodic);
+	atomic_val_t missed = atomic_clear(&periodic->missed);
+	int r;
+
+	data->id = periodic->id;
+	data->result = result;
+	data->count = sys_cpu_to_le16(periodic->count);
+	data->missed = sys_cpu_to_le16(MIN(missed, UINT16_MAX));
+	memset(data->pad, 0, sizeof(data->pad));
+
+	periodic->count = 0;
+	periodic->age = 0;
+
+	r = gb_operation_send_unidirectional(periodic->cport, periodic->type,
+		periodic->msg, len);
+	if (r != 0) {
+		LOG_ERR("failed to send samples: %d", r);
+	}
+}
+
+static bool gb_periodic_changed(const struct gb_periodic *periodic,
+	const uint8_t *data)
+{
+	size_t i;
+
+	if (!periodic->primed || !periodic->filter) {
+		return true;
+	}
+
+	for (i = 0; i < periodic->size; ++i) {
+		if ((data[i] ^ periodic->last[i]) & periodic->mask[i]) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void gb_periodic_work(struct k_work *work)
+{
+	struct gb_periodic *periodic =
+		CONTAINER_OF(work, struct gb_periodic, work);
+	struct gb_periodic_sample *sample;
+	uint32_t now;
+	int r;
+
+	if (atomic_get(&periodic->stopping)) {
+		return;
+	}
+
+	sample = (struct gb_periodic_sample *)(gb_periodic_data(periodic)->samples
+		+ periodic->count * gb_periodic_sample_size(periodic));
+
+	/* truncated from 64 bits, so it wraps at 2^32 us */
+	now = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+	r = periodic->sample(periodic->script, sample->data);
+	if (r < 0) {
+		gb_periodic_flush(periodic, gb_errno_to_op_result(r));
+		return;
+	}
+
+	if (gb_periodic_changed(periodic, sample->data)) {
+		memcpy(periodic->last, sample->data, periodic->size);
+		periodic->primed = true;
+		sample->timestamp_us = sys_cpu_to_le32(now);
+		periodic->count++;
+	}
+
+	if (periodic->count == 0) {
+		return;
+	}
+
+	/*
+	 * With a compare mask, the batch may take forever to fill. Its
+	 * samples are then sent after as many periods as it would take
+	 * without one.
+	 */
+	if (periodic->count == periodic->batch ||
+		++periodic->age >= periodic->batch) {
+		gb_periodic_flush(periodic, GB_OP_SUCCESS);
+	}
+}
+
+static void gb_periodic_stop_work(struct k_work *work)
+{
+	struct gb_periodic *periodic =
+		CONTAINER_OF(work, struct gb_periodic, stop);
+
+	if (periodic->count > 0) {
+		gb_periodic_flush(periodic, GB_OP_SUCCESS);
+	}
+
+	/* gb_periodic_stop() frees the transfer after this */
+	k_sem_give(&periodic->stopped);
+}
+
+int gb_periodic_start(unsigned int cport, uint8_t type, struct k_work_q *queue,
+	gb_periodic_sample_t sample, void *script, size_t size,
+	const uint8_t *mask, uint16_t batch, uint32_t period_us)
+{
+	struct gb_periodic *periodic;
+	size_t msg_size;
+	size_t i;
+
+	if (size == 0 || batch == 0 || period_us == 0) {
+		return -EINVAL;
+	}
+
+	msg_size = sizeof(struct gb_operation_hdr)
+		+ sizeof(struct gb_periodic_data_request)
+		+ batch * (sizeof(struct gb_periodic_sample) + size);
+	if (msg_size > GB_MTU) {
+		return -EOVERFLOW;
+	}
+
+	periodic = calloc(1, sizeof(*periodic) + 2 * size + msg_size);
+	if (periodic == NULL) {
+		return -ENOMEM;
+	}
+
+	periodic->mask = (uint8_t *)&periodic[1];
+	periodic->last = periodic->mask + size;
+	periodic->msg = periodic->last + size;
+
+	memcpy(periodic->mask, mask, size);
+	for (i = 0; i < size; ++i) {
+		periodic->filter |= mask[i] != 0;
+	}
+
+	periodic->queue = queue;
+	periodic->sample = sample;
+	periodic->script = script;
+	periodic->cport = cport;
+	periodic->type = type;
+	periodic->size = size;
+	periodic->batch = batch;
+	k_sem_init(&periodic->stopped, 0, 1);
+	k_work_init(&periodic->work, gb_periodic_work);
+	k_work_init(&periodic->stop, gb_periodic_stop_work);
+	k_timer_init(&periodic->timer, gb_periodic_timer, NULL);
+
+	k_mutex_lock(&transfers_mutex, K_FOREVER);
+	for (i = 0; i < ARRAY_SIZE(transfers); ++i) {
+		if (transfers[i] == NULL) {
+			break;
+		}
+	}
+	if (i == ARRAY_SIZE(transfers)) {
+		k_mutex_unlock(&transfers_mutex);
+		free(periodic);
+		return -EBUSY;
+	}
+	periodic->id = i;
+	transfers[i] = periodic;
+	k_mutex_unlock(&transfers_mutex);
+
+	k_timer_start(&periodic->timer, K_USEC(period_us), K_USEC(period_us));
+
+	LOG_DBG("cport %u: periodic transfer %u every %u us", cport,
+		periodic->id, period_us);
+
+	return periodic->id;
+}
+
+static void gb_periodic_release(struct gb_periodic *periodic)
+{
+	k_timer_stop(&periodic->timer);
+
+	/*
+	 * With the timer stopped, nothing queues samples anymore. A sample
+	 * that is still queued or running finishes before the stop work,
+	 * which runs on the same queue.
+	 */
+	atomic_set(&periodic->stopping, 1);
+	gb_periodic_submit(periodic, &periodic->stop);
+	k_sem_take(&periodic->stopped, K_FOREVER);
+
+	free(periodic->script);
+	free(periodic);
+}
+
+int gb_periodic_stop(unsigned int cport, int id)
+{
+	struct gb_periodic *periodic;
+	int ret = -ENODEV;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(transfers); ++i) {
+		if (id >= 0 && i != (size_t)id) {
+			continue;
+		}
+
+		k_mutex_lock(&transfers_mutex, K_FOREVER);
+		periodic = transfers[i];
+		if (periodic != NULL && periodic->cport == cport) {
+			transfers[i] = NULL;
+		} else {
+			periodic = NULL;
+		}
+		k_mutex_unlock(&transfers_mutex);
+
+		if (periodic != NULL) {
+			gb_periodic_release(periodic);
+			ret = 0;
+		}
+	}
+
+	return (id < 0) ? 0 : ret;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef GREYBUS_PERIODIC_ENGINE_H_
+#define GREYBUS_PERIODIC_ENGINE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr.h>
+
+/* run the transfer described by @script once, storing its read data in @data */
+typedef int (*gb_periodic_sample_t)(void *script, uint8_t *data);
+
+/*
+ * Run @sample every @period_us on @queue, or on the system work queue if
+ * @queue is NULL, and report samples of @size bytes to @cport with data
+ * requests of @type. On success, the id of the periodic transfer is
+ * returned and @script belongs to the engine, which free()s it once the
+ * transfer is stopped.
+ */
+int gb_periodic_start(unsigned int cport, uint8_t type, struct k_work_q *queue,
+	gb_periodic_sample_t sample, void *script, size_t size,
+	const uint8_t *mask, uint16_t batch, uint32_t period_us);
+
+/*
+ * Stop periodic transfer @id of @cport, or all of its periodic transfers
+ * if @id is negative. Samples that were not reported yet are sent first.
+ */
+int gb_periodic_stop(unsigned int cport, int id);
+
+#endif /* GREYBUS_PERIODIC_ENGINE_H_ */
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr.h>
+#include <shell/shell.h>
+#include <sys/byteorder.h>
+#include <sys/util.h>
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(greybus_compress, CONFIG_GREYBUS_LOG_LEVEL);
+
+#include "compress.h"
+#include "lz4.h"
+
+/* original payload size, prepended to the LZ4 block */
+#define GB_COMPRESS_HDR_SIZE sizeof(uint16_t)
+
+struct gb_compress_cport {
+	bool peer_ok;
+	struct gb_xport_compress_stats stats;
+};
+
+static struct gb_compress_cport *cports;
+static size_t num_compress_cports;
+
+/* senders and receivers of all transports update the statistics */
+static struct k_spinlock stats_lock;
+
+/* positions are at most GB_MTU, so 16 bits are enough */
+static uint16_t hash_table[GB_LZ4_HASH_SIZE];
+static K_MUTEX_DEFINE(hash_mutex);
+
+int gb_xport_compress_init(size_t num_cports)
+{
+	if (cports != NULL) {
+		/* already initialized by another transport */
+		return 0;
+	}
+
+	cports = calloc(num_cports, sizeof(*cports));
+	if (cports == NULL) {
+		LOG_ERR("failed to allocate %zu cports", num_cports);
+		return -ENOMEM;
+	}
+
+	num_compress_cports = num_cports;
+
+	return 0;
+}
+
+bool gb_xport_compress_wanted(unsigned int cport, struct gb_operation_hdr *msg)
+{
+	msg->pad[1] |= GB_XPORT_FLAG_COMPRESS_OK;
+
+	return cport < num_compress_cports && cports[cport].peer_ok
+		&& sys_le16_to_cpu(msg->size) - sizeof(*msg)
+			>= CONFIG_GREYBUS_XPORT_COMPRESS_THRESHOLD;
+}
+
+size_t gb_xport_compress(unsigned int cport, struct gb_operation_hdr *msg,
+	void *out, size_t out_size)
+{
+	struct gb_operation_hdr *zmsg = out;
+	struct gb_compress_cport *ccp;
+	size_t payload_size;
+	size_t zsize;
+	uint32_t start;
+	uint32_t cycles;
+	k_spinlock_key_t key;
+
+	if (!gb_xport_compress_wanted(cport, msg)
+		|| out_size <= sizeof(*msg) + GB_COMPRESS_HDR_SIZE) {
+		return 0;
+	}
+
+	ccp = &cports[cport];
+	payload_size = sys_le16_to_cpu(msg->size) - sizeof(*msg);
+
+	start = k_cycle_get_32();
+
+	/* only worthwhile if the result is strictly smaller */
+	out_size = MIN(out_size, sizeof(*msg) + payload_size - 1);
+
+	k_mutex_lock(&hash_mutex, K_FOREVER);
+	zsize = gb_lz4_compress((const uint8_t *)(msg + 1), payload_size,
+		(uint8_t *)(zmsg + 1) + GB_COMPRESS_HDR_SIZE,
+		out_size - sizeof(*msg) - GB_COMPRESS_HDR_SIZE, hash_table);
+	k_mutex_unlock(&hash_mutex);
+
+	cycles = k_cycle_get_32() - start;
+
+	if (zsize != 0) {
+		zsize += sizeof(*msg) + GB_COMPRESS_HDR_SIZE;
+		memcpy(zmsg, msg, sizeof(*msg));
+		zmsg->size = sys_cpu_to_le16(zsize);
+		zmsg->pad[1] |= GB_XPORT_FLAG_COMPRESSED;
+		sys_put_le16(payload_size, (uint8_t *)(zmsg + 1));
+	}
+
+	key = k_spin_lock(&stats_lock);
+	ccp->stats.tx_cycles += cycles;
+	ccp->stats.tx_bytes_in += payload_size;
+	if (zsize == 0) {
+		ccp->stats.tx_bytes_out += payload_size;
+	} else {
+		ccp->stats.tx_msgs++;
+		ccp->stats.tx_bytes_out += zsize - sizeof(*msg);
+	}
+	k_spin_unlock(&stats_lock, key);
+
+	return zsize;
+}
+
+bool gb_xport_compress_rx(unsigned int cport, const struct gb_operation_hdr *msg)
+{
+	if (cport < num_compress_cports
+		&& (msg->pad[1] & GB_XPORT_FLAG_COMPRESS_OK)
+		&& !cports[cport].peer_ok) {
+		LOG_DBG("cport %u: peer supports compression", cport);
+		cports[cport].peer_ok = true;
+	}
+
+	return (msg->pad[1] & GB_XPORT_FLAG_COMPRESSED) != 0;
+}
+
+int gb_xport_decompress(unsigned int cport, const struct gb_operation_hdr *msg,
+	void *out, size_t out_size)
+{
+	struct gb_operation_hdr *dmsg = out;
+	size_t zsize = sys_le16_to_cpu(msg->size);
+	size_t payload_size;
+	uint32_t start;
+	uint32_t cycles;
+	k_spinlock_key_t key;
+	int r;
+
+	if (zsize < sizeof(*msg) + GB_COMPRESS_HDR_SIZE) {
+		return -EINVAL;
+	}
+
+	payload_size = sys_get_le16((const uint8_t *)(msg + 1));
+	if (sizeof(*msg) + payload_size > out_size) {
+		return -EINVAL;
+	}
+
+	start = k_cycle_get_32();
+	r = gb_lz4_decompress((const uint8_t *)(msg + 1) + GB_COMPRESS_HDR_SIZE,
+		zsize - sizeof(*msg) - GB_COMPRESS_HDR_SIZE,
+		(uint8_t *)(dmsg + 1), payload_size);
+	if (r != payload_size) {
+		LOG_ERR("cport %u: corrupt compressed message", cport);
+		return -EINVAL;
+	}
+
+	memcpy(dmsg, msg, sizeof(*msg));
+	dmsg->size = sys_cpu_to_le16(sizeof(*msg) + payload_size);
+	dmsg->pad[1] &= ~GB_XPORT_FLAG_COMPRESSED;
+
+	cycles = k_cycle_get_32() - start;
+
+	if (cport < num_compress_cports) {
+		key = k_spin_lock(&stats_lock);
+		cports[cport].stats.rx_cycles += cycles;
+		cports[cport].stats.rx_msgs++;
+		cports[cport].stats.rx_bytes_in += zsize - sizeof(*msg);
+		cports[cport].stats.rx_bytes_out += payload_size;
+		k_spin_unlock(&stats_lock, key);
+	}
+
+	return sizeof(*msg) + payload_size;
+}
+
+void gb_xport_compress_reset(unsigned int cport)
+{
+	if (cport < num_compress_cports) {
+		cports[cport].peer_ok = false;
+	}
+}
+
+int gb_xport_compress_stats_get(unsigned int cport,
+	struct gb_xport_compress_stats *stats)
+{
+	k_spinlock_key_t key;
+
+	if (cport >= num_compress_cports || stats == NULL) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&stats_lock);
+	*stats = cports[cport].stats;
+	k_spin_unlock(&stats_lock, key);
+
+	return 0;
+}
+
+#ifdef CONFIG_SHELL
+
+/* ratio of compressed to original bytes, in percent */
+static uint32_t ratio(uint64_t compressed, uint64_t original)
+{
+	return original ? (uint32_t)((100 * compressed) / original) : 100;
+}
+
+/* CPU time spent per KiB of original data */
+static uint32_t us_per_kib(uint64_t cycles, uint64_t original)
+{
+	return original ? (uint32_t)(k_cyc_to_us_floor64(cycles) * 1024 / original)
+		: 0;
+}
+
+static int cmd_gb_compress(const struct shell *shell, size_t argc, char **argv)
+{
+	struct gb_xport_compress_stats s;
+	size_t i;
+
+	shell_print(shell, "cport peer    tx msgs tx ratio tx us/KiB    rx msgs rx ratio rx us/KiB");
+	for (i = 0; i < num_compress_cports; ++i) {
+		gb_xport_compress_stats_get(i, &s);
+		shell_print(shell, "%5zu %4s %10u %7u%% %9u %10u %7u%% %9u", i,
+			cports[i].peer_ok ? "yes" : "no",
+			s.tx_msgs, ratio(s.tx_bytes_out, s.tx_bytes_in),
+			us_per_kib(s.tx_cycles, s.tx_bytes_in),
+			s.rx_msgs, ratio(s.rx_bytes_in, s.rx_bytes_out),
+			us_per_kib(s.rx_cycles, s.rx_bytes_out));
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(gb_compress, NULL,
+	"Show Greybus compression ratio and CPU cost per CPort", cmd_gb_compress);
+
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef GREYBUS_PLATFORM_COMPRESS_H_
+#define GREYBUS_PLATFORM_COMPRESS_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+#include <greybus/greybus.h>
+
+/*
+ * Optional message compression for bandwidth-limited transports.
+ *
+ * Link flags are carried in gb_operation_hdr.pad[1]. Each side sets
+ * GB_XPORT_FLAG_COMPRESS_OK on every message it sends to advertise that it
+ * can decompress, and only compresses towards a peer that has done the same.
+ * A compressed message has GB_XPORT_FLAG_COMPRESSED set, its size covers the
+ * wire representation, and its payload is the little-endian original payload
+ * size followed by an LZ4 block.
+ */
+#define GB_XPORT_FLAG_COMPRESS_OK BIT(6)
+#define GB_XPORT_FLAG_COMPRESSED BIT(7)
+
+/*
+ * Transports that address CPorts with a little-endian CPort ID in pad, such
+ * as UART, find the flags in its two top bits. CPort IDs have at most 12
+ * bits, so the rest of the field is the CPort ID.
+ */
+#define GB_XPORT_CPORT_MASK BIT_MASK(14)
+
+/* running totals, wide enough not to wrap in practice */
+struct gb_xport_compress_stats {
+	uint32_t tx_msgs;
+	uint64_t tx_bytes_in;
+	uint64_t tx_bytes_out;
+	uint64_t tx_cycles;
+	uint32_t rx_msgs;
+	uint64_t rx_bytes_in;
+	uint64_t rx_bytes_out;
+	uint64_t rx_cycles;
+};
+
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+
+int gb_xport_compress_init(size_t num_cports);
+
+/**
+ * @brief Advertise compression support in @p msg
+ *
+ * @return true if @p msg is large enough to compress and the peer of
+ *         @p cport can decompress it, so that a buffer for
+ *         gb_xport_compress() is needed
+ */
+bool gb_xport_compress_wanted(unsigned int cport, struct gb_operation_hdr *msg);
+
+/**
+ * @brief Compress @p msg for @p cport if it is worthwhile
+ *
+ * Also advertises compression support in @p msg.
+ *
+ * @return the size of the compressed message written to @p out
+ * @return 0 if @p msg should be sent as is
+ */
+size_t gb_xport_compress(unsigned int cport, struct gb_operation_hdr *msg,
+	void *out, size_t out_size);
+
+/**
+ * @brief Record the peer's link flags for @p cport
+ *
+ * @return true if @p msg is compressed and must be passed to
+ *         gb_xport_decompress()
+ */
+bool gb_xport_compress_rx(unsigned int cport, const struct gb_operation_hdr *msg);
+
+/**
+ * @brief Decompress @p msg into @p out
+ *
+ * @return the size of the decompressed message on success
+ * @return -EINVAL if @p msg is malformed or does not fit into @p out
+ */
+int gb_xport_decompress(unsigned int cport, const struct gb_operation_hdr *msg,
+	void *out, size_t out_size);
+
+/* forget the peer's capabilities, e.g. when a connection is closed */
+void gb_xport_compress_reset(unsigned int cport);
+
+int gb_xport_compress_stats_get(unsigned int cport,
+	struct gb_xport_compress_stats *stats);
+
+#else
+
+static inline int gb_xport_compress_init(size_t num_cports)
+{
+	return 0;
+}
+
+static inline bool gb_xport_compress_wanted(unsigned int cport,
+	struct gb_operation_hdr *msg)
+{
+	return false;
+}
+
+static inline size_t gb_xport_compress(unsigned int cport,
+	struct gb_operation_hdr *msg, void *out, size_t out_size)
+{
+	return 0;
+}
+
+static inline bool gb_xport_compress_rx(unsigned int cport,
+	const struct gb_operation_hdr *msg)
+{
+	return false;
+}
+
+static inline int gb_xport_decompress(unsigned int cport,
+	const struct gb_operation_hdr *msg, void *out, size_t out_size)
+{
+	return -ENOTSUP;
+}
+
+static inline void gb_xport_compress_reset(unsigned int cport)
+{
+}
+
+#endif /* CONFIG_GREYBUS_XPORT_COMPRESS */
+
+#endif /* GREYBUS_PLATFORM_COMPRESS_H_ */
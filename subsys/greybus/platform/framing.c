@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <sys/byteorder.h>
+#include <sys/crc.h>
+
+#include "framing.h"
+
+#define GB_FRAME_CRC_SEED 0xffff
+
+size_t gb_frame_encode(const uint8_t *msg, size_t len, uint8_t *frame)
+{
+	uint8_t crc[GB_FRAME_CRC_SIZE];
+	size_t code_idx = 0;
+	size_t out = 1;
+	uint8_t code = 1;
+	const uint8_t *src;
+	size_t i;
+
+	sys_put_le16(crc16_ccitt(GB_FRAME_CRC_SEED, msg, len), crc);
+
+	for (i = 0; i < len + sizeof(crc); ++i) {
+		src = (i < len) ? &msg[i] : &crc[i - len];
+
+		if (*src != 0) {
+			frame[out++] = *src;
+			code++;
+		}
+
+		if (*src == 0 || code == 0xff) {
+			frame[code_idx] = code;
+			code_idx = out++;
+			code = 1;
+		}
+	}
+
+	frame[code_idx] = code;
+	frame[out++] = GB_FRAME_DELIMITER;
+
+	return out;
+}
+
+static int gb_frame_end(struct gb_frame_decoder *dec)
+{
+	size_t len = dec->len;
+
+	/* nothing since the last delimiter, code bytes are never zero */
+	if (dec->code == 0) {
+		return -EAGAIN;
+	}
+
+	if (dec->buf == NULL) {
+		return -ENOBUFS;
+	}
+
+	if (dec->overflow) {
+		return -EMSGSIZE;
+	}
+
+	if (dec->left != 0 || len < GB_FRAME_CRC_SIZE) {
+		return -EBADMSG;
+	}
+
+	len -= GB_FRAME_CRC_SIZE;
+	if (sys_get_le16(&dec->buf[len]) !=
+		crc16_ccitt(GB_FRAME_CRC_SEED, dec->buf, len)) {
+		return -EILSEQ;
+	}
+
+	return len;
+}
+
+static void gb_frame_append(struct gb_frame_decoder *dec, uint8_t byte)
+{
+	if (dec->buf == NULL) {
+		return;
+	}
+
+	if (dec->len >= dec->size) {
+		dec->overflow = true;
+		return;
+	}
+
+	dec->buf[dec->len++] = byte;
+}
+
+/* COBS decoder, a zero byte always terminates the current frame */
+int gb_frame_decode(struct gb_frame_decoder *dec, uint8_t byte)
+{
+	int r;
+
+	if (byte == GB_FRAME_DELIMITER) {
+		r = gb_frame_end(dec);
+		dec->len = 0;
+		dec->code = 0;
+		dec->left = 0;
+		dec->overflow = false;
+		return r;
+	}
+
+	if (dec->left == 0) {
+		/* code byte: the previous block ended with an implicit zero */
+		if (dec->code != 0 && dec->code != 0xff) {
+			gb_frame_append(dec, 0);
+		}
+		dec->code = byte;
+		dec->left = byte - 1;
+		return -EAGAIN;
+	}
+
+	gb_frame_append(dec, byte);
+	dec->left--;
+
+	return -EAGAIN;
+}
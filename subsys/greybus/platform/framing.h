@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef GREYBUS_FRAMING_H_
+#define GREYBUS_FRAMING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+/*
+ * Each message is followed by a little-endian CRC-16/CCITT, the result is
+ * COBS encoded and terminated by a zero byte. Since COBS output never
+ * contains zero, the receiver resynchronizes at the next delimiter after
+ * any corruption.
+ */
+#define GB_FRAME_DELIMITER 0x00
+#define GB_FRAME_CRC_SIZE sizeof(uint16_t)
+/* one overhead byte per 254 bytes, plus leading code and delimiter */
+#define GB_FRAME_MAX(len) ((len) + GB_FRAME_CRC_SIZE + \
+	DIV_ROUND_UP((len) + GB_FRAME_CRC_SIZE, 254) + 2)
+
+struct gb_frame_decoder {
+	/* where the frame is decoded, or NULL to drop its data */
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+	uint8_t code;
+	uint8_t left;
+	bool overflow;
+};
+
+/**
+ * @brief Encode @p msg into @p frame
+ *
+ * @param msg the message
+ * @param len length of @p msg
+ * @param frame room for GB_FRAME_MAX(len) bytes
+ * @return the length of the frame, delimiter included
+ */
+size_t gb_frame_encode(const uint8_t *msg, size_t len, uint8_t *frame);
+
+/**
+ * @brief Feed one received byte to @p dec
+ *
+ * @return -EAGAIN until a frame delimiter is received, or for empty frames
+ * @return the message length, when a valid frame ends
+ * @return -ENOBUFS if the frame ended while no buffer was set
+ * @return -EMSGSIZE if the frame did not fit in the buffer
+ * @return -EBADMSG if the frame was truncated or too short for a CRC
+ * @return -EILSEQ if the frame had a bad CRC
+ */
+int gb_frame_decode(struct gb_frame_decoder *dec, uint8_t byte);
+
+#endif /* GREYBUS_FRAMING_H_ */
@@ -19,7 +19,6 @@
 LOG_MODULE_REGISTER(greybus_platform_gpio_control, CONFIG_GREYBUS_LOG_LEVEL);
 
 #include "../gpio-gb.h"
-#include "transport.h"
 
 struct greybus_gpio_control_config {
     const uint8_t id;
@@ -30,59 +29,8 @@ struct greybus_gpio_control_config {
 
 struct greybus_gpio_control_data {
     const struct device *greybus_gpio_controller;
-    struct gpio_callback callback;
 };
 
-static void gpio_callback_handler(const struct device *port,
-					struct gpio_callback *cb,
-					gpio_port_pins_t pins)
-{
-	/*
-	 * Note: Currently, the greybus subsystem sends IRQ events
-	 * kind of excessively, because there is no way to query
-	 * the gpio subsystem for current pin configuration.
-	 * Greybus irq events should naturally only be generated
-	 * for input pins for example, and more specifically,
-	 * input pins that are configured to generate interrupts!
-	 * So we need to filter-out irq messages here until
-	 * the expected message comes through :(
-	 *
-	 * See https://github.com/zephyrproject-rtos/zephyr/issues/26938
-	 */
-
-	int r;
-	const struct gb_transport_backend *xport;
-	unsigned int cport;
-	uint8_t req_[
-		 0
-		 + sizeof(struct gb_operation_hdr)
-		 + sizeof(struct gb_gpio_irq_event_request)
-		 ] = {};
-	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
-	struct gb_gpio_irq_event_request *const irq_event_req =
-		(struct gb_gpio_irq_event_request *)
-		(req_ + sizeof(struct gb_operation_hdr));
-
-	req->size = sys_cpu_to_le16(sizeof(req_));
-	req->type = GB_GPIO_TYPE_IRQ_EVENT;
-
-	xport = gb_transport_get_backend();
-	__ASSERT(xport != NULL, "unable to get greybus transport backend");
-
-	cport = gb_device_to_cport(port);
-	__ASSERT(cport >= 0, "unabled to get cport binding for device %p", port);
-
-	for(size_t i = 0; i < GPIO_MAX_PINS_PER_PORT && pins != 0; ++i, pins >>= 1) {
-		if (pins & 1) {
-			irq_event_req->which = i;
-			r = xport->send(cport, req_, sizeof(req_));
-			if (r != 0) {
-				LOG_ERR("xport->send() failed: %d", r);
-			}
-		}
-	}
-}
-
 static int greybus_gpio_control_init(const struct device *dev) {
 
 	struct greybus_gpio_control_data *drv_data =
@@ -91,7 +39,6 @@ static int greybus_gpio_control_init(const struct device *dev) {
         (struct greybus_gpio_control_config *)dev->config;
     int r;
     const struct device *bus;
-    gpio_port_pins_t mask;
 
     drv_data->greybus_gpio_controller =
         device_get_binding(config->greybus_gpio_controller_name);
@@ -101,9 +48,6 @@ static int greybus_gpio_control_init(const struct device *dev) {
 		return -ENODEV;
     }
 
-    mask = ((struct gpio_driver_config *)drv_data->greybus_gpio_controller
-    			->config)->port_pin_mask;
-
     bus = device_get_binding(config->bus_name);
     if (NULL == bus) {
 		LOG_ERR("gpio control: failed to get binding for device '%s'", config->bus_name);
@@ -116,14 +60,6 @@ static int greybus_gpio_control_init(const struct device *dev) {
 		return r;
     }
 
-    drv_data->callback.handler = gpio_callback_handler;
-    drv_data->callback.pin_mask = mask;
-	r = gpio_add_callback(drv_data->greybus_gpio_controller, &drv_data->callback);
-	if (r < 0) {
-		LOG_ERR("gpio_add_callback() failed for cport %u", config->id);
-		return r;
-	}
-
     LOG_DBG("probed cport %u: bundle: %u protocol: %u", config->id,
 		config->bundle, CPORT_PROTOCOL_GPIO);
 
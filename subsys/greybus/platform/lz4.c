@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <sys/util.h>
+
+#include "lz4.h"
+
+#define LZ4_MINMATCH 4
+#define LZ4_LASTLITERALS 5
+#define LZ4_MFLIMIT 12
+#define LZ4_MAX_OFFSET 65535
+
+static inline uint32_t lz4_read32(const uint8_t *p)
+{
+	return sys_get_le32(p);
+}
+
+static inline uint32_t lz4_hash(const uint8_t *p)
+{
+	return (lz4_read32(p) * 2654435761U) >> (32 - GB_LZ4_HASH_LOG);
+}
+
+static uint8_t *lz4_put_length(uint8_t *op, size_t len)
+{
+	for (; len >= 255; len -= 255) {
+		*op++ = 255;
+	}
+	*op++ = len;
+
+	return op;
+}
+
+size_t gb_lz4_compress(const uint8_t *src, size_t len, uint8_t *dst,
+	size_t dst_size, uint16_t *hash_table)
+{
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	const uint8_t *const iend = src + len;
+	const uint8_t *const mflimit = iend - LZ4_MFLIMIT;
+	const uint8_t *const matchlimit = iend - LZ4_LASTLITERALS;
+	const uint8_t *ref;
+	uint8_t *op = dst;
+	uint8_t *const oend = dst + dst_size;
+	uint8_t *token;
+	size_t lit;
+	size_t match;
+	uint32_t h;
+
+	if (len > UINT16_MAX) {
+		return 0;
+	}
+
+	memset(hash_table, 0, GB_LZ4_HASH_SIZE * sizeof(*hash_table));
+
+	if (len >= LZ4_MFLIMIT + 1) {
+		hash_table[lz4_hash(ip)] = 0;
+		ip++;
+	}
+
+	while (len >= LZ4_MFLIMIT + 1 && ip < mflimit) {
+		h = lz4_hash(ip);
+		ref = src + hash_table[h];
+		hash_table[h] = ip - src;
+
+		if (ref >= ip || ip - ref > LZ4_MAX_OFFSET
+			|| lz4_read32(ref) != lz4_read32(ip)) {
+			ip++;
+			continue;
+		}
+
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		for (match = LZ4_MINMATCH; ip + match < matchlimit
+			&& ip[match] == ref[match]; ++match) {
+		}
+
+		lit = ip - anchor;
+		if (op + 1 + lit + lit / 255 + 1 + 2 + match / 255 + 1 > oend) {
+			return 0;
+		}
+
+		token = op++;
+		if (lit >= 15) {
+			*token = 15 << 4;
+			op = lz4_put_length(op, lit - 15);
+		} else {
+			*token = lit << 4;
+		}
+
+		memcpy(op, anchor, lit);
+		op += lit;
+
+		sys_put_le16(ip - ref, op);
+		op += 2;
+
+		if (match - LZ4_MINMATCH >= 15) {
+			*token |= 15;
+			op = lz4_put_length(op, match - LZ4_MINMATCH - 15);
+		} else {
+			*token |= match - LZ4_MINMATCH;
+		}
+
+		ip += match;
+		anchor = ip;
+
+		if (ip < mflimit) {
+			hash_table[lz4_hash(ip - 2)] = ip - 2 - src;
+		}
+	}
+
+	lit = iend - anchor;
+	if (op + 1 + lit + lit / 255 + 1 > oend) {
+		return 0;
+	}
+
+	token = op++;
+	if (lit >= 15) {
+		*token = 15 << 4;
+		op = lz4_put_length(op, lit - 15);
+	} else {
+		*token = lit << 4;
+	}
+
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	return op - dst;
+}
+
+static int lz4_get_length(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+	uint8_t b;
+
+	do {
+		if (*ip >= iend) {
+			return -EINVAL;
+		}
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+
+	return 0;
+}
+
+int gb_lz4_decompress(const uint8_t *src, size_t len, uint8_t *dst,
+	size_t dst_size)
+{
+	const uint8_t *ip = src;
+	const uint8_t *const iend = src + len;
+	uint8_t *op = dst;
+	uint8_t *const oend = dst + dst_size;
+	const uint8_t *ref;
+	uint8_t token;
+	size_t lit;
+	size_t match;
+	size_t offset;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		lit = token >> 4;
+		if (lit == 15 && lz4_get_length(&ip, iend, &lit) < 0) {
+			return -EINVAL;
+		}
+
+		if (lit > iend - ip || lit > oend - op) {
+			return -EINVAL;
+		}
+
+		memcpy(op, ip, lit);
+		op += lit;
+		ip += lit;
+
+		if (ip == iend) {
+			/* the last sequence has no match */
+			break;
+		}
+
+		if (iend - ip < 2) {
+			return -EINVAL;
+		}
+
+		offset = sys_get_le16(ip);
+		ip += 2;
+		if (offset == 0 || offset > op - dst) {
+			return -EINVAL;
+		}
+
+		match = token & 15;
+		if (match == 15 && lz4_get_length(&ip, iend, &match) < 0) {
+			return -EINVAL;
+		}
+		match += LZ4_MINMATCH;
+
+		if (match > oend - op) {
+			return -EINVAL;
+		}
+
+		/* byte-wise, since the match may overlap its own output */
+		for (ref = op - offset; match > 0; --match) {
+			*op++ = *ref++;
+		}
+	}
+
+	return op - dst;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef GREYBUS_PLATFORM_LZ4_H_
+#define GREYBUS_PLATFORM_LZ4_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A small LZ4 block format codec. Compression is greedy with a single
+ * hash probe, which keeps it cheap enough for an MCU; the output can be
+ * decoded by any standard LZ4 block decoder.
+ */
+#define GB_LZ4_HASH_LOG 10
+#define GB_LZ4_HASH_SIZE (1 << GB_LZ4_HASH_LOG)
+
+/**
+ * @brief Compress @p len bytes of @p src into an LZ4 block
+ *
+ * @param hash_table scratch of GB_LZ4_HASH_SIZE entries. Positions are
+ *        stored in 16 bits, so @p len is at most UINT16_MAX.
+ * @return the compressed size, or 0 if it does not fit into @p dst_size
+ */
+size_t gb_lz4_compress(const uint8_t *src, size_t len, uint8_t *dst,
+	size_t dst_size, uint16_t *hash_table);
+
+/**
+ * @brief Decompress the LZ4 block @p src
+ *
+ * @return the decompressed size, or -EINVAL if @p src is malformed or does
+ *         not fit into @p dst_size
+ */
+int gb_lz4_decompress(const uint8_t *src, size_t len, uint8_t *dst,
+	size_t dst_size);
+
+#endif /* GREYBUS_PLATFORM_LZ4_H_ */
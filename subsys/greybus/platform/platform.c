@@ -5,31 +5,67 @@
  */
 
 #include <device.h>
+#include <devicetree.h>
 #include <errno.h>
 #include <greybus/platform.h>
 #include <stddef.h>
-#include <stdlib.h>
-#include <string.h>
+#include <stdint.h>
 #include <zephyr.h>
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(greybus_platform, CONFIG_GREYBUS_LOG_LEVEL);
 
-struct map_entry {
-	unsigned int cport;
+/*
+ * The map is filled in once, while cport devices are initialized, and is
+ * read on every request and from GPIO interrupts. Readers take no locks:
+ * an entry is written before it is published with a release store.
+ */
+
+/* one slot per cport id in devicetree */
+#define GB_CPORT_MAP_SLOT(node_id) [DT_PROP(node_id, id)] = NULL,
+
+static const struct device *cport_map[] = {
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_control, GB_CPORT_MAP_SLOT)
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_gpio_controller, GB_CPORT_MAP_SLOT)
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_i2c_controller, GB_CPORT_MAP_SLOT)
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_spi_controller, GB_CPORT_MAP_SLOT)
+};
+
+/* device to cport, open addressing with at most half of the slots used */
+struct dev_map_entry {
 	const struct device *dev;
+	unsigned int cport;
 };
 
-static size_t map_size;
-static struct map_entry *map;
+/* never empty, so that dev_map_hash() does not divide by zero */
+#define DEV_MAP_SIZE (2 * MAX(ARRAY_SIZE(cport_map), 1))
+
+static struct dev_map_entry dev_map[DEV_MAP_SIZE];
 K_MUTEX_DEFINE(map_mutex);
 
+static inline size_t dev_map_hash(const struct device *dev)
+{
+	/* device structs are word aligned */
+	return ((uintptr_t)dev / sizeof(void *)) % DEV_MAP_SIZE;
+}
+
+static inline const struct device *map_load(const struct device **slot)
+{
+	return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+static inline void map_store(const struct device **slot,
+	const struct device *dev)
+{
+	__atomic_store_n(slot, dev, __ATOMIC_RELEASE);
+}
+
 int gb_add_cport_device_mapping(unsigned int cport, const struct device *dev)
 {
 	int ret;
 	int mutex_ret;
 	size_t idx;
-	struct map_entry *entry;
+	struct dev_map_entry *entry;
 
 	if (dev == NULL) {
 		return -EINVAL;
@@ -37,15 +73,24 @@ int gb_add_cport_device_mapping(unsigned int cport, const struct device *dev)
 
 	__ASSERT_NO_MSG(dev->name != NULL);
 
+	if (cport >= ARRAY_SIZE(cport_map)) {
+		LOG_ERR("cport %u is not in devicetree", cport);
+		return -EINVAL;
+	}
+
 	mutex_ret = k_mutex_lock(&map_mutex, K_FOREVER);
 	__ASSERT_NO_MSG(mutex_ret == 0);
 
-	for(idx = 0; idx < map_size; ++idx) {
-		entry = &map[idx];
-		if (entry->cport == cport) {
-			LOG_ERR("%u is already mapped to %s", cport, entry->dev->name);
-			ret = -EALREADY;
-			goto unlock;
+	if (cport_map[cport] != NULL) {
+		LOG_ERR("%u is already mapped to %s", cport, cport_map[cport]->name);
+		ret = -EALREADY;
+		goto unlock;
+	}
+
+	for (idx = dev_map_hash(dev);; idx = (idx + 1) % DEV_MAP_SIZE) {
+		entry = &dev_map[idx];
+		if (entry->dev == NULL) {
+			break;
 		}
 		if (entry->dev == dev) {
 			LOG_ERR("%s is already mapped to %u", entry->dev->name, entry->cport);
@@ -54,18 +99,9 @@ int gb_add_cport_device_mapping(unsigned int cport, const struct device *dev)
 		}
 	}
 
-	entry = realloc(map, (map_size + 1) * sizeof(*entry));
-	if (entry == NULL) {
-		ret = -ENOMEM;
-		goto unlock;
-	}
-
-	map = entry;
-	entry = &map[map_size];
-	map_size++;
-
 	entry->cport = cport;
-	entry->dev = dev;
+	map_store(&entry->dev, dev);
+	map_store(&cport_map[cport], dev);
 
 	LOG_DBG("added mapping between cport %u and device %s", cport, dev->name);
 
@@ -80,56 +116,36 @@ unlock:
 
 int gb_device_to_cport(const struct device *dev)
 {
-	int ret;
-	int mutex_ret;
 	size_t idx;
-	struct map_entry *entry;
-
-	mutex_ret = k_mutex_lock(&map_mutex, K_FOREVER);
-	__ASSERT_NO_MSG(mutex_ret == 0);
-
-	for(idx = 0; idx < map_size; ++idx) {
-		entry = &map[idx];
-		if (entry->dev == dev) {
-			ret = entry->cport;
-			goto unlock;
+	const struct device *slot;
+
+	if (dev != NULL) {
+		for (idx = dev_map_hash(dev);; idx = (idx + 1) % DEV_MAP_SIZE) {
+			slot = map_load(&dev_map[idx].dev);
+			if (slot == NULL) {
+				break;
+			}
+			if (slot == dev) {
+				return dev_map[idx].cport;
+			}
 		}
 	}
 
 	LOG_ERR("no mapping for device %s", (dev == NULL) ? "(null)" : ((dev->name == NULL) ? "(null)" : dev->name));
-	ret = -ENOENT;
-
-unlock:
-	mutex_ret = k_mutex_unlock(&map_mutex);
-	__ASSERT_NO_MSG(mutex_ret == 0);
-
-	return ret;
+	return -ENOENT;
 }
 
 const struct device *gb_cport_to_device(unsigned int cport)
 {
-	const struct device *ret;
-	int mutex_ret;
-	size_t idx;
-	struct map_entry *entry;
+	const struct device *dev = NULL;
 
-	mutex_ret = k_mutex_lock(&map_mutex, K_FOREVER);
-	__ASSERT_NO_MSG(mutex_ret == 0);
-
-	for(idx = 0; idx < map_size; ++idx) {
-		entry = &map[idx];
-		if (entry->cport == cport) {
-			ret = entry->dev;
-			goto unlock;
-		}
+	if (cport < ARRAY_SIZE(cport_map)) {
+		dev = map_load(&cport_map[cport]);
 	}
 
-	LOG_ERR("no mapping for cport %u", cport);
-	ret = NULL;
-
-unlock:
-	mutex_ret = k_mutex_unlock(&map_mutex);
-	__ASSERT_NO_MSG(mutex_ret == 0);
+	if (dev == NULL) {
+		LOG_ERR("no mapping for cport %u", cport);
+	}
 
-	return ret;
+	return dev;
 }
@@ -26,6 +26,7 @@ LOG_MODULE_REGISTER(greybus_service, CONFIG_GREYBUS_LOG_LEVEL);
 
 static struct gb_transport_backend *xport;
 static size_t num_cports;
+static uint32_t init_time_us;
 
 unsigned int unipro_cport_count(void)
 {
@@ -44,6 +45,8 @@ static int greybus_service_init(const struct device *bus)
 	uint8_t *mnfb;
 	size_t mnfb_size;
 	unsigned int *cports = NULL;
+	uint32_t start = k_uptime_get_32();
+	uint32_t start_cycles = k_cycle_get_32();
 
 	if (xport != NULL) {
 		LOG_ERR("service already initialized");
@@ -72,11 +75,14 @@ static int greybus_service_init(const struct device *bus)
 		goto out;
 	}
 
-	r = manifest_parse(mnfb, mnfb_size);
-	if (r != true) {
-		LOG_ERR("failed to parse mnfb");
-		r = -EINVAL;
-		goto out;
+	/* with a generated cport table, the manifest is only sent to the host */
+	if (!IS_ENABLED(CONFIG_GREYBUS_CPORT_TABLE)) {
+		r = manifest_parse(mnfb, mnfb_size);
+		if (r != true) {
+			LOG_ERR("failed to parse mnfb");
+			r = -EINVAL;
+			goto out;
+		}
 	}
 
 	extern size_t manifest_get_num_cports(void);
@@ -103,8 +109,11 @@ static int greybus_service_init(const struct device *bus)
     }
 
     enable_cports();
+    init_time_us = k_cyc_to_us_floor64(k_cycle_get_32() - start_cycles);
 
-    LOG_INF("Greybus is active");
+    /* the control cport is ready, so the host may enumerate us now */
+    LOG_INF("Greybus is active %u ms after boot (%u ms in init)",
+        k_uptime_get_32(), k_uptime_get_32() - start);
 
     r = 0;
     goto out;
@@ -120,4 +129,9 @@ out:
     return r;
 }
 
+uint32_t greybus_service_init_time_us(void)
+{
+    return init_time_us;
+}
+
 SYS_INIT(greybus_service_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
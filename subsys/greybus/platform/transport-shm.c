@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/byteorder.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <greybus/greybus.h>
+#include <greybus/shm.h>
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(greybus_transport_shm, CONFIG_GREYBUS_LOG_LEVEL);
+
+#include "transport.h"
+
+/* Based on UniPro, from Linux */
+#define CPORT_ID_MAX 4095
+
+/*
+ * The service thread polls the ring. A host futex wait would block the
+ * whole native_posix process, including the thread that must produce
+ * the response, so it first yields for a number of empty polls, then
+ * sleeps between polls. Such a sleep lasts at least a tick.
+ */
+#define GB_SHM_POLL_SPIN 64
+#define GB_SHM_POLL_US 100
+/* how long a sender waits for room in the ring, in uptime */
+#define GB_SHM_SEND_TIMEOUT_MS 1000
+
+BUILD_ASSERT((CONFIG_GREYBUS_XPORT_SHM_RING_SIZE &
+	(CONFIG_GREYBUS_XPORT_SHM_RING_SIZE - 1)) == 0,
+	"CONFIG_GREYBUS_XPORT_SHM_RING_SIZE must be a power of 2");
+
+/* For some reason, not declared even with _GNU_SOURCE */
+extern int pthread_setname_np(pthread_t thread, const char *name);
+
+static struct gb_shm_region *region;
+static struct gb_shm_ring *rx_ring;
+static struct gb_shm_ring *tx_ring;
+static size_t shm_cports;
+static pthread_mutex_t tx_mutex;
+/*
+ * Senders that find the tx ring full wait for the service thread, which
+ * sees the host consume as it polls, rather than polling themselves.
+ */
+static K_SEM_DEFINE(tx_room, 0, 1);
+static atomic_t tx_waiting;
+static pthread_t service_thread_id;
+static uint8_t rx_buf[GB_MTU];
+
+/* wake a waiting sender if the host has consumed since the last wakeup */
+static void tx_room_check(void)
+{
+	static uint32_t last_tail;
+	uint32_t tail;
+
+	if (atomic_get(&tx_waiting) == 0) {
+		return;
+	}
+
+	tail = __atomic_load_n(&tx_ring->tail, __ATOMIC_ACQUIRE);
+	if (tail != last_tail) {
+		last_tail = tail;
+		k_sem_give(&tx_room);
+	}
+}
+
+static void *service_thread(void *arg)
+{
+	int r;
+	uint16_t cport;
+	unsigned int idle = 0;
+	struct gb_operation_hdr *msg = (struct gb_operation_hdr *)rx_buf;
+
+	ARG_UNUSED(arg);
+
+	for (;;) {
+		tx_room_check();
+
+		r = gb_shm_pop(rx_ring, region->ring_size, &cport, rx_buf,
+			sizeof(rx_buf));
+		if (r == -EAGAIN) {
+			if (idle < GB_SHM_POLL_SPIN) {
+				idle++;
+				k_yield();
+			} else {
+				k_sleep(K_USEC(GB_SHM_POLL_US));
+			}
+			continue;
+		}
+
+		idle = 0;
+
+		if (r < 0) {
+			LOG_ERR("dropping oversized record (%d)", r);
+			continue;
+		}
+
+		if (cport >= shm_cports
+			|| !gb_transport_cport_routed(cport, GREYBUS_TRANSPORT_SHM)
+			|| (size_t)r < sizeof(*msg)
+			|| sys_le16_to_cpu(msg->size) != r) {
+			LOG_ERR("cport %u: invalid record (len: %d)", cport, r);
+			continue;
+		}
+
+		r = greybus_rx_handler(cport, msg, r);
+		if (r < 0) {
+			LOG_ERR("cport %u failed to handle message: size: %u, id: %u, type: %u",
+				cport, sys_le16_to_cpu(msg->size),
+				sys_le16_to_cpu(msg->id), msg->type);
+		}
+	}
+
+	return NULL;
+}
+
+static void gb_xport_init(void)
+{
+}
+
+static void gb_xport_exit(void)
+{
+}
+
+static int gb_xport_listen_start(unsigned int cport)
+{
+	return 0;
+}
+
+static int gb_xport_listen_stop(unsigned int cport)
+{
+	return 0;
+}
+
+static int gb_xport_send(unsigned int cport, const void *buf, size_t len)
+{
+	int r;
+	int64_t remaining;
+	const int64_t deadline = k_uptime_get() + GB_SHM_SEND_TIMEOUT_MS;
+	const struct gb_operation_hdr *msg = buf;
+
+	if (NULL == msg) {
+		LOG_ERR("message is NULL");
+		return -EINVAL;
+	}
+
+	if (sys_le16_to_cpu(msg->size) != len || len < sizeof(*msg)) {
+		LOG_ERR("invalid message size %u (len: %u)",
+			(unsigned)sys_le16_to_cpu(msg->size), (unsigned)len);
+		return -EINVAL;
+	}
+
+	if (cport >= shm_cports) {
+		LOG_ERR("invalid cport %u", cport);
+		return -EINVAL;
+	}
+
+	for (;;) {
+		/* the ring is single-producer, so pushes are serialized */
+		pthread_mutex_lock(&tx_mutex);
+		r = gb_shm_push(tx_ring, region->ring_size, cport, buf, len);
+		if (r == -EAGAIN) {
+			atomic_inc(&tx_waiting);
+		}
+		pthread_mutex_unlock(&tx_mutex);
+
+		if (r != -EAGAIN) {
+			break;
+		}
+
+		/* the ring is not held while waiting for room */
+		remaining = deadline - k_uptime_get();
+		if (remaining > 0) {
+			r = k_sem_take(&tx_room, K_MSEC(remaining));
+		}
+		atomic_dec(&tx_waiting);
+
+		if (remaining <= 0 || r != 0) {
+			LOG_ERR("cport %u: ring full, host not consuming", cport);
+			r = -ETIMEDOUT;
+			break;
+		}
+	}
+
+	/* there may be room for the next waiting sender as well */
+	if (r == 0 && atomic_get(&tx_waiting) > 0) {
+		k_sem_give(&tx_room);
+	}
+
+	return r;
+}
+
+static void *gb_xport_alloc_buf(size_t size)
+{
+	void *p = malloc(size);
+
+	if (!p) {
+		LOG_ERR("Failed to allocate %zu bytes", size);
+	}
+
+	return p;
+}
+
+static void gb_xport_free_buf(void *ptr)
+{
+	free(ptr);
+}
+
+static const struct gb_transport_backend gb_xport = {
+	.init = gb_xport_init,
+	.exit = gb_xport_exit,
+	.listen = gb_xport_listen_start,
+	.stop_listening = gb_xport_listen_stop,
+	.send = gb_xport_send,
+	.send_async = NULL,
+	.alloc_buf = gb_xport_alloc_buf,
+	.free_buf = gb_xport_free_buf,
+};
+
+static int shmsetup(size_t num_cports)
+{
+	int fd;
+	int r;
+	void *p;
+	const size_t size =
+		gb_shm_region_bytes(CONFIG_GREYBUS_XPORT_SHM_RING_SIZE);
+
+	fd = shm_open(CONFIG_GREYBUS_XPORT_SHM_NAME, O_CREAT | O_RDWR, 0600);
+	if (fd == -1) {
+		LOG_ERR("shm_open: %d", errno);
+		return -errno;
+	}
+
+	r = ftruncate(fd, size);
+	if (r == -1) {
+		LOG_ERR("ftruncate: %d", errno);
+		r = -errno;
+		goto close_fd;
+	}
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		LOG_ERR("mmap: %d", errno);
+		r = -errno;
+		goto close_fd;
+	}
+
+	region = p;
+	memset(region, 0, size);
+	region->version = GB_SHM_VERSION;
+	region->ring_size = CONFIG_GREYBUS_XPORT_SHM_RING_SIZE;
+	region->num_cports = num_cports;
+	tx_ring = gb_shm_ring(region, GB_SHM_D2H);
+	rx_ring = gb_shm_ring(region, GB_SHM_H2D);
+	/* clients must not touch the region before the magic is visible */
+	__atomic_store_n(&region->magic, GB_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	LOG_INF("%zu CPorts mapped to shared memory %s (%zu bytes)",
+		num_cports, CONFIG_GREYBUS_XPORT_SHM_NAME, size);
+
+	r = 0;
+
+close_fd:
+	close(fd);
+
+	return r;
+}
+
+struct gb_transport_backend *gb_transport_shm_init(size_t num_cports)
+{
+	int r;
+	struct gb_transport_backend *ret = NULL;
+
+	LOG_DBG("Greybus SHM Transport initializing..");
+
+	if (num_cports >= CPORT_ID_MAX) {
+		LOG_ERR("invalid number of cports %u", (unsigned)num_cports);
+		goto out;
+	}
+
+	shm_cports = num_cports;
+	pthread_mutex_init(&tx_mutex, NULL);
+
+	r = shmsetup(num_cports);
+	if (r < 0) {
+		LOG_ERR("shmsetup() failed: %d", r);
+		goto out;
+	}
+
+	r = pthread_create(&service_thread_id, NULL, service_thread, NULL);
+	if (r != 0) {
+		LOG_ERR("pthread_create: %d", r);
+		goto out;
+	}
+
+	pthread_setname_np(service_thread_id, "greybus");
+
+	ret = (struct gb_transport_backend *)&gb_xport;
+
+	LOG_INF("Greybus SHM Transport initialized");
+
+out:
+	return ret;
+}
@@ -82,6 +82,7 @@ LOG_MODULE_REGISTER(greybus_transport_tcpip, CONFIG_GREYBUS_LOG_LEVEL);
 
 #include "transport.h"
 #include "certificate.h"
+#include "compress.h"
 
 #ifndef CONFIG_GREYBUS_ENABLE_TLS
 #define CONFIG_GREYBUS_TLS_HOSTNAME ""
@@ -121,9 +122,61 @@ DNS_SD_REGISTER_TCP_SERVICE(gb_service_advertisement, CONFIG_NET_HOSTNAME,
 	"_greybus", "local", DNS_SD_EMPTY_TXT, GB_TRANSPORT_TCPIP_BASE_PORT);
 #endif /* CONFIG_GREYBUS_ENABLE_TLS */
 
+/*
+ * Each service thread owns a shard of the CPorts routed to TCP/IP, which are
+ * dealt out to the shards in turn, and polls only the server and client
+ * sockets belonging to that shard, so that traffic on one CPort is never
+ * serialized behind traffic on another shard.
+ */
+struct service_shard {
+	pthread_t thread;
+	size_t id;
+	/* written to, so that the thread polls its sockets anew */
+	int wake[2];
+	struct pollfd pollfds[CONFIG_NET_SOCKETS_POLL_MAX];
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+	/* decompressed messages, only used by the thread */
+	uint8_t rx_zbuf[GB_MTU];
+	/* compressed messages of any sender to the shard's CPorts */
+	pthread_mutex_t tx_zbuf_mutex;
+	uint8_t tx_zbuf[GB_MTU];
+#endif
+};
+
 static sys_dlist_t fd_list;
 static pthread_mutex_t fd_list_mutex;
-static pthread_t accept_thread;
+static struct service_shard shards[CONFIG_GREYBUS_XPORT_TCPIP_RX_THREADS];
+static size_t num_shards = 1;
+/* the shard of each CPort routed to TCP/IP */
+static uint8_t *cport_shards;
+static atomic_t shards_quit;
+static pthread_mutex_t netsetup_mutex;
+/* large enough for either address family, unlike struct sockaddr */
+union net_addr {
+	struct sockaddr sa;
+	struct sockaddr_in sin;
+	struct sockaddr_in6 sin6;
+};
+/* the address that CPorts are bound to, with the port left out */
+static union net_addr net_addr;
+static socklen_t net_sa_len;
+
+static int netsetup_cport_once(size_t cport);
+static bool netsetup_deferred(size_t cport);
+
+static inline bool cport_in_shard(int cport, int shard)
+{
+	return shard == -1 || cport_shards[cport] == shard;
+}
+
+static void shard_wake(struct service_shard *shard)
+{
+	const uint8_t one = 1;
+
+	if (send(shard->wake[1], &one, sizeof(one), 0) == -1) {
+		LOG_ERR("failed to wake service thread %zu (%d)", shard->id, errno);
+	}
+}
 
 static struct fd_context *fd_context_new(int fd, int cport, enum fd_context_type type)
 {
@@ -164,6 +217,11 @@ static void fd_context_delete(struct fd_context *ctx)
 		return;
 	}
 
+	if (ctx->type == FD_CONTEXT_CLIENT) {
+		/* the next client may not support compression */
+		gb_xport_compress_reset(ctx->cport);
+	}
+
 	close(ctx->fd);
 	free(ctx);
 }
@@ -249,7 +307,8 @@ out:
 	return success;
 }
 
-static void fd_context_clear(void)
+/* shard == -1 clears all contexts */
+static void fd_context_clear(int shard)
 {
 	int r;
 	struct fd_context *ctx;
@@ -261,9 +320,10 @@ static void fd_context_clear(void)
 		return;
 	}
 
-	for ( ctx = SYS_DLIST_PEEK_HEAD_CONTAINER(&fd_list, cnode, node);
-		ctx != NULL; ctx = SYS_DLIST_PEEK_HEAD_CONTAINER(&fd_list, cnode, node)) {
-		fd_context_erase_inner(ctx);
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&fd_list, ctx, cnode, node) {
+		if (cport_in_shard(ctx->cport, shard)) {
+			fd_context_erase_inner(ctx);
+		}
 	}
 
 	pthread_mutex_unlock(&fd_list_mutex);
@@ -358,6 +418,7 @@ static void handle_client_input(struct fd_context *ctx)
 {
 	int r;
 	struct gb_operation_hdr *msg = NULL;
+	struct gb_operation_hdr *rx_msg;
 
 	r = getMessage(ctx->fd, &msg);
 	if (r == 0) {
@@ -370,7 +431,21 @@ static void handle_client_input(struct fd_context *ctx)
 		goto close_conn;
 	}
 
-	r = greybus_rx_handler(ctx->cport, msg, sys_le16_to_cpu(msg->size));
+	rx_msg = msg;
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+	if (gb_xport_compress_rx(ctx->cport, msg)) {
+		/* the core copies the message, so the shard's buffer is reused */
+		rx_msg = (struct gb_operation_hdr *)
+			shards[cport_shards[ctx->cport]].rx_zbuf;
+		r = gb_xport_decompress(ctx->cport, msg, rx_msg, GB_MTU);
+		if (r < 0) {
+			goto close_conn;
+		}
+	}
+#endif
+
+	r = greybus_rx_handler(ctx->cport, rx_msg,
+		sys_le16_to_cpu(rx_msg->size));
 	if (r == 0) {
 		/* Message handled properly */
 		goto free_msg;
@@ -379,8 +454,8 @@ static void handle_client_input(struct fd_context *ctx)
 	__ASSERT_NO_MSG(r < 0);
 
 	LOG_ERR("cport %u failed to handle message: size: %u, id: %u, type: %u",
-		ctx->cport, sys_le16_to_cpu(msg->size), sys_le16_to_cpu(msg->id),
-		msg->type);
+		ctx->cport, sys_le16_to_cpu(rx_msg->size),
+		sys_le16_to_cpu(rx_msg->id), rx_msg->type);
 
 close_conn:
 	LOG_DBG("closing fd %d", ctx->fd);
@@ -390,12 +465,16 @@ free_msg:
 	free(msg);
 }
 
-/* return the number of valid entries in the pollfds array */
-static int prepare_pollfds(struct pollfd *pollfds, size_t array_size)
+/*
+ * return the number of valid entries in the pollfds array, the first of
+ * which is the wake socket of the shard
+ */
+static int prepare_pollfds(struct service_shard *shard)
 {
 	int r;
     struct fd_context *cnode;
-    sys_dnode_t *node;
+    struct pollfd *pollfds = shard->pollfds;
+    const size_t array_size = ARRAY_SIZE(shard->pollfds);
     size_t fds;
 
     memset(pollfds, 0, array_size * sizeof(*pollfds));
@@ -407,9 +486,11 @@ static int prepare_pollfds(struct pollfd *pollfds, size_t array_size)
 		goto out;
 	}
 
-	fds = 0;
-	SYS_DLIST_FOR_EACH_NODE(&fd_list, node) {
-		++fds;
+	fds = 1;
+	SYS_DLIST_FOR_EACH_CONTAINER(&fd_list, cnode, node) {
+		if (cport_in_shard(cnode->cport, shard->id)) {
+			++fds;
+		}
 	}
 
 	if (fds > array_size) {
@@ -418,8 +499,15 @@ static int prepare_pollfds(struct pollfd *pollfds, size_t array_size)
 		goto unlock;
 	}
 
-	r = 0;
+	pollfds[0].fd = shard->wake[0];
+	pollfds[0].events = POLLIN;
+
+	r = 1;
 	SYS_DLIST_FOR_EACH_CONTAINER(&fd_list, cnode, node) {
+		if (!cport_in_shard(cnode->cport, shard->id)) {
+			continue;
+		}
+
 		switch(cnode->type) {
 		case FD_CONTEXT_SERVER:
 		case FD_CONTEXT_CLIENT:
@@ -444,10 +532,11 @@ static void *service_thread(void *arg)
 	int r;
     struct fd_context *ctx;
     int pollfds_size;
-    static struct pollfd pollfds[CONFIG_NET_SOCKETS_POLL_MAX];
+    struct service_shard *shard = (struct service_shard *)arg;
+    struct pollfd *pollfds = shard->pollfds;
 
 	for (;;) {
-		pollfds_size = prepare_pollfds(pollfds, ARRAY_SIZE(pollfds));
+		pollfds_size = prepare_pollfds(shard);
 		if (pollfds_size <= 0) {
 			LOG_DBG("prepare_pollfds() returned %d", pollfds_size);
 			break;
@@ -459,7 +548,19 @@ static void *service_thread(void *arg)
 			break;
 		}
 
-		for(size_t i = 0, revents = r; revents > 0 && i < pollfds_size; ++i) {
+		if (pollfds[0].revents & POLLIN) {
+			uint8_t wake[8];
+
+			(void)recv(shard->wake[0], wake, sizeof(wake), 0);
+			if (atomic_get(&shards_quit)) {
+				LOG_DBG("Greybus service thread %zu is stopping",
+					shard->id);
+				return NULL;
+			}
+			continue;
+		}
+
+		for(size_t i = 1, revents = r; revents > 0 && i < pollfds_size; ++i) {
 			if (pollfds[i].revents & POLLIN) {
 				ctx = fd_to_context(pollfds[i].fd);
 
@@ -484,8 +585,8 @@ static void *service_thread(void *arg)
 		}
 	}
 
-	LOG_WRN("Greybus is quitting");
-	fd_context_clear();
+	LOG_WRN("Greybus service thread %zu is quitting", shard->id);
+	fd_context_clear(shard->id);
 
 	return NULL;
 }
@@ -601,6 +702,37 @@ static int sendMessage(int fd, struct gb_operation_hdr *msg)
 	return 0;
 }
 
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+/* compress into the buffer of the CPort's shard, if it is worthwhile */
+static int sendCompressedMessage(int fd, unsigned int cport,
+	struct gb_operation_hdr *msg)
+{
+	int r;
+	struct service_shard *shard;
+
+	if (!gb_xport_compress_wanted(cport, msg)) {
+		return sendMessage(fd, msg);
+	}
+
+	shard = &shards[cport_shards[cport]];
+	pthread_mutex_lock(&shard->tx_zbuf_mutex);
+	if (gb_xport_compress(cport, msg, shard->tx_zbuf,
+		sizeof(shard->tx_zbuf)) > 0) {
+		msg = (struct gb_operation_hdr *)shard->tx_zbuf;
+	}
+	r = sendMessage(fd, msg);
+	pthread_mutex_unlock(&shard->tx_zbuf_mutex);
+
+	return r;
+}
+#else
+static inline int sendCompressedMessage(int fd, unsigned int cport,
+	struct gb_operation_hdr *msg)
+{
+	return sendMessage(fd, msg);
+}
+#endif /* CONFIG_GREYBUS_XPORT_COMPRESS */
+
 static void gb_xport_init(void)
 {
 }
@@ -611,6 +743,12 @@ static void gb_xport_exit(void)
 
 static int gb_xport_listen_start(unsigned int cport)
 {
+	if (netsetup_deferred(cport)
+		&& gb_transport_cport_routed(cport, GREYBUS_TRANSPORT_TCPIP)) {
+		/* the host connects the CPort, so it is bound now */
+		return netsetup_cport_once(cport);
+	}
+
 	return 0;
 }
 
@@ -643,7 +781,7 @@ static int gb_xport_send(unsigned int cport, const void *buf, size_t len)
     	return -EINVAL;
     }
 
-    r = sendMessage(ctx->fd, msg);
+    r = sendCompressedMessage(ctx->fd, cport, msg);
     if (r != 0) {
     	fd_context_erase(ctx->fd);
     }
@@ -678,147 +816,254 @@ static const struct gb_transport_backend gb_xport = {
 	.free_buf = gb_xport_free__buf,
 };
 
-static int netsetup(size_t num_cports)
+static int netsetup_cport(size_t cport)
 {
 	int r;
 	int fd;
-	size_t i;
 	const int yes = true;
-	int family;
-	uint16_t *port;
 	int proto = IPPROTO_TCP;
-	struct sockaddr sa;
-	socklen_t sa_len;
+	union net_addr addr = net_addr;
 
 	if (IS_ENABLED(CONFIG_GREYBUS_TLS_BUILTIN)) {
 		proto = IPPROTO_TLS_1_2;
 	}
 
-	memset(&sa, 0, sizeof(sa));
-	if (IS_ENABLED(CONFIG_NET_IPV6)) {
-		family = AF_INET6;
-		net_sin6(&sa)->sin6_family = AF_INET6;
-		net_sin6(&sa)->sin6_addr = in6addr_any;
-		port = &net_sin6(&sa)->sin6_port;
-		sa_len = sizeof(struct sockaddr_in6);
-	} else if (IS_ENABLED(CONFIG_NET_IPV4)) {
-		family = AF_INET;
-		net_sin(&sa)->sin_family = AF_INET;
-		net_sin(&sa)->sin_addr.s_addr = INADDR_ANY;
-		port = &net_sin(&sa)->sin_port;
-		sa_len = sizeof(struct sockaddr_in);
+	if (addr.sa.sa_family == AF_INET6) {
+		addr.sin6.sin6_port = htons(GB_TRANSPORT_TCPIP_BASE_PORT + cport);
 	} else {
-		LOG_ERR("Neither IPv6 nor IPv4 is available");
-		return -EINVAL;
+		addr.sin.sin_port = htons(GB_TRANSPORT_TCPIP_BASE_PORT + cport);
+	}
+
+	fd = socket(addr.sa.sa_family, SOCK_STREAM, proto);
+	if (fd == -1) {
+		LOG_ERR("socket: %d", errno);
+		return -errno;
+	}
+
+	r = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	if (-1 == r) {
+		LOG_ERR("setsockopt: Failed to set SO_REUSEADDR (%d)", errno);
+		goto close_fd;
 	}
-	*port = htons(GB_TRANSPORT_TCPIP_BASE_PORT);
-
-    for(i = 0; i < num_cports; ++i) {
-        fd = socket(family, SOCK_STREAM, proto);
-        if (fd == -1) {
-            LOG_ERR("socket: %d", errno);
-            return -errno;
-        }
-
-        if (!fd_context_insert(fd, i, FD_CONTEXT_SERVER)) {
-        	LOG_ERR("failed to add fd context for cport %zu", i);
-        	close(fd);
-        	return -EINVAL;
-        }
-
-        r = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-        if (-1 == r) {
-        	LOG_ERR("setsockopt: Failed to set SO_REUSEADDR (%d)", errno);
-            return -errno;
-        }
-
-		if (IS_ENABLED(CONFIG_GREYBUS_ENABLE_TLS)) {
-			static const sec_tag_t sec_tag_opt[] = {
+
+	if (IS_ENABLED(CONFIG_GREYBUS_ENABLE_TLS)) {
+		static const sec_tag_t sec_tag_opt[] = {
 #if defined(CONFIG_GREYBUS_TLS_CLIENT_VERIFY_OPTIONAL) \
 	|| defined(CONFIG_GREYBUS_TLS_CLIENT_VERIFY_REQUIRED)
-				GB_TLS_CA_CERT_TAG,
+			GB_TLS_CA_CERT_TAG,
 #endif
-				GB_TLS_SERVER_CERT_TAG,
-			};
+			GB_TLS_SERVER_CERT_TAG,
+		};
 
-			r = setsockopt(fd, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag_opt, sizeof(sec_tag_opt));
-			if (-1 == r) {
-				LOG_ERR("setsockopt: Failed to set SEC_TAG_LIST (%d)", errno);
-				return -errno;
-			}
+		r = setsockopt(fd, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag_opt, sizeof(sec_tag_opt));
+		if (-1 == r) {
+			LOG_ERR("setsockopt: Failed to set SEC_TAG_LIST (%d)", errno);
+			goto close_fd;
+		}
 
-			r = setsockopt(fd, SOL_TLS, TLS_HOSTNAME, CONFIG_GREYBUS_TLS_HOSTNAME,
-				strlen(CONFIG_GREYBUS_TLS_HOSTNAME));
-			if (-1 == r) {
-				LOG_ERR("setsockopt: Failed to set TLS_HOSTNAME (%d)", errno);
-				return -errno;
-			}
+		r = setsockopt(fd, SOL_TLS, TLS_HOSTNAME, CONFIG_GREYBUS_TLS_HOSTNAME,
+			strlen(CONFIG_GREYBUS_TLS_HOSTNAME));
+		if (-1 == r) {
+			LOG_ERR("setsockopt: Failed to set TLS_HOSTNAME (%d)", errno);
+			goto close_fd;
+		}
 
-			/* default to no client verification */
-			int verify = TLS_PEER_VERIFY_NONE;
+		/* default to no client verification */
+		int verify = TLS_PEER_VERIFY_NONE;
 
-			if (IS_ENABLED(CONFIG_GREYBUS_TLS_CLIENT_VERIFY_OPTIONAL)) {
-				verify = TLS_PEER_VERIFY_OPTIONAL;
-			}
+		if (IS_ENABLED(CONFIG_GREYBUS_TLS_CLIENT_VERIFY_OPTIONAL)) {
+			verify = TLS_PEER_VERIFY_OPTIONAL;
+		}
 
-			if (IS_ENABLED(CONFIG_GREYBUS_TLS_CLIENT_VERIFY_REQUIRED)) {
-				verify = TLS_PEER_VERIFY_REQUIRED;
-			}
+		if (IS_ENABLED(CONFIG_GREYBUS_TLS_CLIENT_VERIFY_REQUIRED)) {
+			verify = TLS_PEER_VERIFY_REQUIRED;
+		}
 
-			r = setsockopt(fd, SOL_TLS, TLS_PEER_VERIFY, &verify, sizeof(verify));
-			if (-1 == r) {
-				LOG_ERR("setsockopt: Failed to set TLS_PEER_VERIFY (%d)", errno);
-				return -errno;
-			}
+		r = setsockopt(fd, SOL_TLS, TLS_PEER_VERIFY, &verify, sizeof(verify));
+		if (-1 == r) {
+			LOG_ERR("setsockopt: Failed to set TLS_PEER_VERIFY (%d)", errno);
+			goto close_fd;
 		}
+	}
 
-    	*port = htons(GB_TRANSPORT_TCPIP_BASE_PORT + i);
-        r = bind(fd, &sa, sa_len);
-        if (-1 == r) {
-            LOG_ERR("bind: %d", errno);
-            return -errno;
-        }
-
-        r = listen(fd, GB_TRANSPORT_TCPIP_BACKLOG);
-        if (-1 == r) {
-            LOG_ERR("listen: %d", errno);
-            return -errno;
-        }
-
-        LOG_INF("CPort %zu mapped to " XPORT " port %zu",
-			i, GB_TRANSPORT_TCPIP_BASE_PORT + i);
-    }
+	r = bind(fd, &addr.sa, net_sa_len);
+	if (-1 == r) {
+		LOG_ERR("bind: %d", errno);
+		goto close_fd;
+	}
+
+	r = listen(fd, GB_TRANSPORT_TCPIP_BACKLOG);
+	if (-1 == r) {
+		LOG_ERR("listen: %d", errno);
+		goto close_fd;
+	}
+
+	if (!fd_context_insert(fd, cport, FD_CONTEXT_SERVER)) {
+		LOG_ERR("failed to add fd context for cport %zu", cport);
+		close(fd);
+		return -EINVAL;
+	}
+
+	LOG_INF("CPort %zu mapped to " XPORT " port %zu",
+		cport, GB_TRANSPORT_TCPIP_BASE_PORT + cport);
+
+	return 0;
+
+close_fd:
+	r = -errno;
+	close(fd);
+
+	return r;
+}
+
+/*
+ * With CONFIG_GREYBUS_LAZY_CPORTS, only the control cport is bound at
+ * boot. The others are bound when the host connects them, which also
+ * brings up their driver, and the service thread of their shard is woken
+ * to poll the new socket.
+ */
+static int netsetup_cport_once(size_t cport)
+{
+	int r = 0;
+
+	pthread_mutex_lock(&netsetup_mutex);
+	if (cport_to_server_context(cport) == NULL) {
+		r = netsetup_cport(cport);
+		if (r == 0) {
+			shard_wake(&shards[cport_shards[cport]]);
+		}
+	}
+	pthread_mutex_unlock(&netsetup_mutex);
+
+	return r;
+}
+
+static bool netsetup_deferred(size_t cport)
+{
+	return IS_ENABLED(CONFIG_GREYBUS_LAZY_CPORTS) && cport != CONTROL_CPORT_ID;
+}
+
+static int netsetup(size_t num_cports)
+{
+	int r;
+	size_t i;
+
+	memset(&net_addr, 0, sizeof(net_addr));
+	if (IS_ENABLED(CONFIG_NET_IPV6)) {
+		net_addr.sin6.sin6_family = AF_INET6;
+		net_addr.sin6.sin6_addr = in6addr_any;
+		net_sa_len = sizeof(struct sockaddr_in6);
+	} else if (IS_ENABLED(CONFIG_NET_IPV4)) {
+		net_addr.sin.sin_family = AF_INET;
+		net_addr.sin.sin_addr.s_addr = INADDR_ANY;
+		net_sa_len = sizeof(struct sockaddr_in);
+	} else {
+		LOG_ERR("Neither IPv6 nor IPv4 is available");
+		return -EINVAL;
+	}
 
-    return 0;
+	for (i = 0; i < num_cports; ++i) {
+		if (!gb_transport_cport_routed(i, GREYBUS_TRANSPORT_TCPIP)
+			|| netsetup_deferred(i)) {
+			continue;
+		}
+
+		r = netsetup_cport(i);
+		if (r < 0) {
+			return r;
+		}
+	}
+
+	return 0;
 }
 
-struct gb_transport_backend *gb_transport_backend_init(size_t num_cports) {
+/* stop the first @count service threads, and wait for them */
+static void shards_stop(size_t count)
+{
+	size_t i;
+
+	atomic_set(&shards_quit, 1);
+
+	for (i = 0; i < count; ++i) {
+		shard_wake(&shards[i]);
+		pthread_join(shards[i].thread, NULL);
+		close(shards[i].wake[0]);
+		close(shards[i].wake[1]);
+	}
+}
+
+struct gb_transport_backend *gb_transport_tcpip_init(size_t num_cports) {
 
     int r;
+    size_t i;
+    size_t routed;
+    char name[CONFIG_THREAD_MAX_NAME_LEN];
     struct gb_transport_backend *ret = NULL;
 
 	LOG_DBG("Greybus " XPORT " Transport initializing..");
 
 	pthread_mutex_init(&fd_list_mutex, NULL);
+	pthread_mutex_init(&netsetup_mutex, NULL);
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+	for (i = 0; i < ARRAY_SIZE(shards); ++i) {
+		pthread_mutex_init(&shards[i].tx_zbuf_mutex, NULL);
+	}
+#endif
 	sys_dlist_init(&fd_list);
     if (num_cports >= CPORT_ID_MAX) {
         LOG_ERR("invalid number of cports %u", (unsigned)num_cports);
         goto out;
     }
 
+	cport_shards = calloc(MAX(num_cports, 1), sizeof(*cport_shards));
+	if (cport_shards == NULL) {
+		LOG_ERR("failed to allocate shard map");
+		goto out;
+	}
+
+	/* only CPorts routed to TCP/IP get a share of the threads */
+	for (i = 0, routed = 0; i < num_cports; ++i) {
+		if (gb_transport_cport_routed(i, GREYBUS_TRANSPORT_TCPIP)) {
+			cport_shards[i] = routed++ % ARRAY_SIZE(shards);
+		}
+	}
+	num_shards = MIN(ARRAY_SIZE(shards), MAX(routed, 1));
+	atomic_set(&shards_quit, 0);
+
     r = netsetup(num_cports);
     if (r < 0) {
     	LOG_ERR("netsetup() failed: %d", r);
         goto cleanup;
     }
 
-    r = pthread_create(&accept_thread, NULL, service_thread, NULL);
-    if (r != 0) {
-		LOG_ERR("pthread_create: %d", r);
+	r = gb_xport_compress_init(num_cports);
+	if (r < 0) {
 		goto cleanup;
 	}
 
-	pthread_setname_np(accept_thread, "greybus");
+	for (i = 0; i < num_shards; ++i) {
+		shards[i].id = i;
+		r = socketpair(AF_UNIX, SOCK_STREAM, 0, shards[i].wake);
+		if (r != 0) {
+			LOG_ERR("socketpair: %d", errno);
+			goto stop_shards;
+		}
+
+		r = pthread_create(&shards[i].thread, NULL, service_thread,
+			&shards[i]);
+		if (r != 0) {
+			LOG_ERR("pthread_create: %d", r);
+			close(shards[i].wake[0]);
+			close(shards[i].wake[1]);
+			goto stop_shards;
+		}
+
+		snprintf(name, sizeof(name), "greybus[%zu]", i);
+		pthread_setname_np(shards[i].thread, name);
+	}
+
+	LOG_DBG("%zu service thread(s) for %zu of %zu cports", num_shards,
+		routed, num_cports);
 
     ret = (struct gb_transport_backend *)&gb_xport;
 
@@ -826,8 +1071,14 @@ struct gb_transport_backend *gb_transport_backend_init(size_t num_cports) {
 
 	goto out;
 
+stop_shards:
+	/* the threads that did start poll the sockets about to be closed */
+	shards_stop(i);
+
 cleanup:
-	fd_context_clear();
+	fd_context_clear(-1);
+	free(cport_shards);
+	cport_shards = NULL;
 
 out:
     return ret;
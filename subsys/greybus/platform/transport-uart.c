@@ -13,21 +13,26 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/byteorder.h>
+#include <shell/shell.h>
 #include <sys/ring_buffer.h>
 #include <zephyr.h>
 
+#include "compress.h"
+#include "framing.h"
 #include "transport.h"
 
 LOG_MODULE_REGISTER(greybus_xsport_uart, CONFIG_GREYBUS_LOG_LEVEL);
 
 /* Based on UniPro, from Linux */
 #define CPORT_ID_MAX 4095
+BUILD_ASSERT(CPORT_ID_MAX <= GB_XPORT_CPORT_MASK,
+	"CPort IDs must not overlap the link flags");
 
 /* pad to not fill up ring buffer on GB_MTU */
 #define RB_PAD 8
 #define UART_RB_SIZE GB_MTU + RB_PAD
 
-static int sendMessage(struct device *dev, struct gb_operation_hdr *msg);
+static int sendMessage(const struct device *dev, struct gb_operation_hdr *msg);
 static void uart_work_fn(struct k_work *work);
 
 static const struct device *uart_dev;
@@ -35,82 +40,337 @@ static const struct device *uart_dev;
 RING_BUF_DECLARE(uart_rb, UART_RB_SIZE);
 static K_WORK_DEFINE(uart_work, uart_work_fn);
 
-static void uart_work_fn(struct k_work *work)
-{
-	struct gb_operation_hdr *msg;
-	uint8_t *data;
+/* serializes senders, and signals TX completion from the driver */
+static K_MUTEX_DEFINE(tx_mutex);
+static K_SEM_DEFINE(tx_sem, 0, 1);
+
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+/* compressed copy of the message being sent, protected by tx_mutex */
+static uint8_t tx_zbuf[GB_MTU];
+#endif
+
+/* updated from the UART ISR and uart_work */
+static struct gb_transport_uart_stats stats;
+
+#ifdef CONFIG_GREYBUS_XPORT_UART_FRAMING
+
+#define UART_RX_BUF_SIZE (GB_MTU + GB_FRAME_CRC_SIZE)
+
+static uint8_t tx_frame[GB_FRAME_MAX(GB_MTU)];
+
+static struct {
+	uint8_t *buf;
+	struct gb_frame_decoder dec;
+	bool no_buf;
+} rx;
+
+#else
+
+#define UART_RX_BUF_SIZE GB_MTU
+
+static struct {
+	uint8_t *buf;
+	uint8_t hdr[sizeof(struct gb_operation_hdr)];
 	size_t len;
-	size_t msg_size;
-	size_t payload_size;
-	size_t expected_size;
-	unsigned int cport = -1;
-	int r;
+	size_t expected;
+	bool discard;
+} rx;
+
+#endif /* CONFIG_GREYBUS_XPORT_UART_FRAMING */
+
+/*
+ * Frames are decoded straight into blocks of this slab, which are then
+ * handed to the core without copying and returned via gb_xport_rxbuf_free().
+ */
+K_MEM_SLAB_DEFINE(uart_rx_slab, ROUND_UP(UART_RX_BUF_SIZE, 4),
+	CONFIG_GREYBUS_XPORT_UART_RX_BUFS, 4);
 
-	expected_size = sizeof(*msg);
-	len = UART_RB_SIZE - ring_buf_space_get(&uart_rb);
-	while(len < expected_size){
-		len = UART_RB_SIZE - ring_buf_space_get(&uart_rb);
-		k_usleep(100);
+static bool uart_rx_buf_get(void)
+{
+	if (rx.buf != NULL) {
+		return true;
 	}
 
-	data = malloc(expected_size);
-	len = ring_buf_get(&uart_rb, data, expected_size);
-	msg = (struct gb_operation_hdr *)data;
-	msg_size = sys_le16_to_cpu(msg->size);
+	if (k_mem_slab_alloc(&uart_rx_slab, (void **)&rx.buf, K_NO_WAIT) < 0) {
+		rx.buf = NULL;
+		stats.rx_no_buffers++;
+		LOG_WRN("dropping frame: no rx buffer (%u)", stats.rx_no_buffers);
+		return false;
+	}
 
-	if (msg_size < sizeof(struct gb_operation_hdr)) {
-		LOG_ERR("invalid message size %u", (unsigned)msg_size);
-		free(data);
-		return;
+	return true;
+}
+
+#ifdef CONFIG_UART_ASYNC_API
+/* receive timeout (ms) after which partially filled buffers are reported */
+#define UART_RX_TIMEOUT 1
+
+static uint8_t uart_rx_bufs[2][CONFIG_GREYBUS_XPORT_UART_RX_BUF_SIZE];
+static uint8_t uart_rx_buf_idx;
+#else
+static const uint8_t *tx_buf;
+static size_t tx_remaining;
+#endif
+
+static void uart_rx_notify(void)
+{
+	if (!ring_buf_is_empty(&uart_rb)) {
+		k_work_submit(&uart_work);
 	}
+}
 
-	payload_size = msg_size - sizeof(struct gb_operation_hdr);
-	if (payload_size > GB_MAX_PAYLOAD_SIZE) {
-		LOG_ERR("invalid payload size %u", (unsigned)payload_size);
-		free(data);
-		return;
+#ifdef CONFIG_UART_ASYNC_API
+static void uart_rx_put(const uint8_t *data, size_t len)
+{
+	size_t put;
+
+	put = ring_buf_put(&uart_rb, data, len);
+	if (put < len) {
+		/* drop the newest bytes rather than corrupt the stream */
+		stats.rx_overruns += len - put;
+		LOG_ERR("overflow occurred, %zu bytes dropped", len - put);
+	}
+
+	uart_rx_notify();
+}
+#endif
+
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+/*
+ * Decompress into a second slab block, so that the block holding the
+ * compressed frame stays in rx.buf and is reused for the next frame.
+ */
+static struct gb_operation_hdr *uart_rx_decompress(unsigned int cport,
+	struct gb_operation_hdr *msg, size_t *len)
+{
+	struct gb_operation_hdr *dmsg;
+	int r;
+
+	if (k_mem_slab_alloc(&uart_rx_slab, (void **)&dmsg, K_NO_WAIT) < 0) {
+		stats.rx_no_buffers++;
+		LOG_WRN("dropping frame: no rx buffer (%u)", stats.rx_no_buffers);
+		return NULL;
 	}
 
-	len = UART_RB_SIZE - ring_buf_space_get(&uart_rb);
-	while(len < payload_size){
-		len = UART_RB_SIZE - ring_buf_space_get(&uart_rb);
-		k_usleep(100);
+	r = gb_xport_decompress(cport, msg, dmsg, UART_RX_BUF_SIZE);
+	if (r < 0) {
+		stats.rx_framing_errors++;
+		k_mem_slab_free(&uart_rx_slab, (void **)&dmsg);
+		return NULL;
 	}
 
-	data = realloc(data, msg_size);
-	msg = (struct gb_operation_hdr *)data;
-	len = ring_buf_get(&uart_rb, data + sizeof(struct gb_operation_hdr), payload_size);
-	if (len != payload_size) {
-		LOG_ERR("gb_operation payload not received");
-		free(data);
+	*len = r;
+
+	return dmsg;
+}
+#endif /* CONFIG_GREYBUS_XPORT_COMPRESS */
+
+static void uart_rx_deliver(struct gb_operation_hdr *msg, size_t len)
+{
+	int r;
+	unsigned int cport;
+	struct gb_operation_hdr *frame = msg;
+
+	if (len < sizeof(*msg) || sys_le16_to_cpu(msg->size) != len) {
+		LOG_ERR("invalid message size %u (len: %zu)",
+			(unsigned)sys_le16_to_cpu(msg->size), len);
+		stats.rx_framing_errors++;
 		return;
 	}
 
-	LOG_HEXDUMP_DBG(msg, msg_size, "RX:");
+	LOG_HEXDUMP_DBG(msg, len, "RX:");
 
-	cport = sys_le16_to_cpu(*((uint16_t *)msg->pad));
-	r = greybus_rx_handler(cport, msg, sys_le16_to_cpu(msg->size));
+	cport = sys_get_le16(msg->pad);
+	if (IS_ENABLED(CONFIG_GREYBUS_XPORT_COMPRESS)) {
+		/* the top bits carry link flags */
+		cport &= GB_XPORT_CPORT_MASK;
+	}
+	if (!gb_transport_cport_routed(cport, GREYBUS_TRANSPORT_UART)) {
+		LOG_ERR("cport %u is not routed to this transport", cport);
+		stats.rx_framing_errors++;
+		return;
+	}
+
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+	if (gb_xport_compress_rx(cport, msg)) {
+		msg = uart_rx_decompress(cport, msg, &len);
+		if (msg == NULL) {
+			return;
+		}
+	}
+#endif
+
+	stats.rx_frames++;
+	r = greybus_rx_handler_owned(cport, msg, len);
 	if (r < 0) {
 		LOG_DBG("failed to handle message : size: %u, id: %u, type: %u",
 		sys_le16_to_cpu(msg->size), sys_le16_to_cpu(msg->id),
 		msg->type);
+		if (msg != frame) {
+			k_mem_slab_free(&uart_rx_slab, (void **)&msg);
+		}
+		/* the frame buffer is still ours, reuse it for the next frame */
+		return;
+	}
+
+	if (msg == frame) {
+		rx.buf = NULL;
+	}
+}
+
+#ifdef CONFIG_GREYBUS_XPORT_UART_FRAMING
+
+static void uart_rx_frame_error(const char *reason)
+{
+	stats.rx_framing_errors++;
+	LOG_WRN("dropping frame: %s (%u framing, %u crc errors)", reason,
+		stats.rx_framing_errors, stats.rx_crc_errors);
+}
+
+static void uart_rx_byte(uint8_t byte)
+{
+	int r;
+
+	/* the first byte of a frame claims a buffer for it */
+	if (byte != GB_FRAME_DELIMITER && rx.buf == NULL && !rx.no_buf) {
+		rx.no_buf = !uart_rx_buf_get();
+		rx.dec.buf = rx.buf;
+		rx.dec.size = UART_RX_BUF_SIZE;
+	}
+
+	r = gb_frame_decode(&rx.dec, byte);
+	if (r == -EAGAIN) {
+		return;
+	}
+
+	rx.no_buf = false;
+
+	switch (r) {
+	case -ENOBUFS:
+		/* already counted */
+		break;
+	case -EMSGSIZE:
+		uart_rx_frame_error("overlong");
+		break;
+	case -EBADMSG:
+		uart_rx_frame_error("truncated");
+		break;
+	case -EILSEQ:
+		stats.rx_crc_errors++;
+		LOG_WRN("dropping frame: bad crc (%u framing, %u crc errors)",
+			stats.rx_framing_errors, stats.rx_crc_errors);
+		break;
+	default:
+		uart_rx_deliver((struct gb_operation_hdr *)rx.buf, r);
+		/* the core may have taken the buffer */
+		rx.dec.buf = rx.buf;
+		break;
+	}
+}
+
+#else /* CONFIG_GREYBUS_XPORT_UART_FRAMING */
+
+/* raw messages, delimited by gb_operation_hdr.size only */
+static void uart_rx_byte(uint8_t byte)
+{
+	struct gb_operation_hdr *hdr = (struct gb_operation_hdr *)rx.hdr;
+
+	if (rx.len < sizeof(rx.hdr)) {
+		rx.hdr[rx.len++] = byte;
+		if (rx.len < sizeof(rx.hdr)) {
+			return;
+		}
+
+		rx.expected = sys_le16_to_cpu(hdr->size);
+		if (rx.expected < sizeof(*hdr) || rx.expected > UART_RX_BUF_SIZE) {
+			LOG_ERR("invalid message size %u", (unsigned)rx.expected);
+			stats.rx_framing_errors++;
+			rx.len = 0;
+			return;
+		}
+
+		/* without a buffer, the message is skipped to stay in sync */
+		rx.discard = !uart_rx_buf_get();
+		if (!rx.discard) {
+			memcpy(rx.buf, rx.hdr, sizeof(rx.hdr));
+		}
+	} else {
+		if (!rx.discard) {
+			rx.buf[rx.len] = byte;
+		}
+		rx.len++;
+	}
+
+	if (rx.len == rx.expected) {
+		if (!rx.discard) {
+			uart_rx_deliver((struct gb_operation_hdr *)rx.buf, rx.len);
+		}
+		rx.len = 0;
+	}
+}
+
+#endif /* CONFIG_GREYBUS_XPORT_UART_FRAMING */
+
+static void uart_work_fn(struct k_work *work)
+{
+	uint8_t *data;
+	uint32_t len;
+	uint32_t i;
+
+	/* decode whatever has arrived, the ISR resubmits when there is more */
+	while ((len = ring_buf_get_claim(&uart_rb, &data, UART_RB_SIZE)) > 0) {
+		for (i = 0; i < len; ++i) {
+			uart_rx_byte(data[i]);
+		}
+		ring_buf_get_finish(&uart_rb, len);
 	}
-	free(data);
-	return;
 }
 
-static int sendMessage(struct device *dev, struct gb_operation_hdr *msg)
+#ifdef CONFIG_UART_ASYNC_API
+
+static int sendMessage(const struct device *dev, struct gb_operation_hdr *msg)
 {
-	size_t offset = 0;
-	size_t remaining;
+	int r;
+	const uint8_t *buf = (const uint8_t *)msg;
+	size_t len = sys_le16_to_cpu(msg->size);
+
+#ifdef CONFIG_GREYBUS_XPORT_UART_FRAMING
+	len = gb_frame_encode(buf, len, tx_frame);
+	buf = tx_frame;
+#endif
 
-	for (remaining = sys_le16_to_cpu(msg->size); remaining; remaining -= 1, offset += 1) {
-		uart_poll_out(dev, ((uint8_t *)msg)[offset]);
+	r = uart_tx(dev, buf, len, SYS_FOREVER_MS);
+	if (r < 0) {
+		LOG_ERR("uart_tx() failed (%d)", r);
+		return r;
 	}
 
+	k_sem_take(&tx_sem, K_FOREVER);
+
+	return 0;
+}
+
+#else /* CONFIG_UART_ASYNC_API */
+
+static int sendMessage(const struct device *dev, struct gb_operation_hdr *msg)
+{
+	tx_buf = (const uint8_t *)msg;
+	tx_remaining = sys_le16_to_cpu(msg->size);
+
+#ifdef CONFIG_GREYBUS_XPORT_UART_FRAMING
+	tx_remaining = gb_frame_encode(tx_buf, tx_remaining, tx_frame);
+	tx_buf = tx_frame;
+#endif
+
+	uart_irq_tx_enable(dev);
+
+	k_sem_take(&tx_sem, K_FOREVER);
+
 	return 0;
 }
 
+#endif /* CONFIG_UART_ASYNC_API */
+
 static void gb_xport_init(void)
 {
 }
@@ -136,7 +396,7 @@ static int gb_xport_send(unsigned int cport, const void *buf, size_t len)
 		return -EINVAL;
 	}
 
-	msg->pad[0] = cport;
+	sys_put_le16(cport, msg->pad);
 
 	LOG_HEXDUMP_DBG(msg, sys_le16_to_cpu(msg->size), "TX:");
 
@@ -146,7 +406,14 @@ static int gb_xport_send(unsigned int cport, const void *buf, size_t len)
 		return -EINVAL;
 	}
 
+	k_mutex_lock(&tx_mutex, K_FOREVER);
+#ifdef CONFIG_GREYBUS_XPORT_COMPRESS
+	if (gb_xport_compress(cport, msg, tx_zbuf, sizeof(tx_zbuf)) > 0) {
+		msg = (struct gb_operation_hdr *)tx_zbuf;
+	}
+#endif
 	r = sendMessage(uart_dev, msg);
+	k_mutex_unlock(&tx_mutex);
 
 	return r;
 }
@@ -158,6 +425,10 @@ static void gb_xport_free_buf(void *ptr)
 {
 	free(ptr);
 }
+static void gb_xport_rxbuf_free(unsigned int cport, void *ptr)
+{
+	k_mem_slab_free(&uart_rx_slab, &ptr);
+}
 
 static const struct gb_transport_backend gb_xport = {
 	.init = gb_xport_init,
@@ -168,48 +439,147 @@ static const struct gb_transport_backend gb_xport = {
 	.send_async = NULL,
 	.alloc_buf = gb_xport_alloc_buf,
 	.free_buf = gb_xport_free_buf,
+	.rxbuf_free = gb_xport_rxbuf_free,
 };
 
+#ifdef CONFIG_UART_ASYNC_API
+
+static void gb_xport_uart_cb(const struct device *dev, struct uart_event *evt,
+	void *user_data)
+{
+	int r;
+
+	switch (evt->type) {
+	case UART_TX_DONE:
+	case UART_TX_ABORTED:
+		k_sem_give(&tx_sem);
+		break;
+
+	case UART_RX_RDY:
+		uart_rx_put(&evt->data.rx.buf[evt->data.rx.offset],
+			evt->data.rx.len);
+		break;
+
+	case UART_RX_BUF_REQUEST:
+		uart_rx_buf_idx ^= 1;
+		r = uart_rx_buf_rsp(dev, uart_rx_bufs[uart_rx_buf_idx],
+			sizeof(uart_rx_bufs[0]));
+		if (r < 0) {
+			LOG_ERR("uart_rx_buf_rsp() failed (%d)", r);
+		}
+		break;
+
+	case UART_RX_STOPPED:
+		LOG_ERR("rx stopped (%d)", evt->data.rx_stop.reason);
+		break;
+
+	case UART_RX_DISABLED:
+		/* e.g. after a line error, restart reception */
+		uart_rx_buf_idx = 0;
+		r = uart_rx_enable(dev, uart_rx_bufs[0], sizeof(uart_rx_bufs[0]),
+			UART_RX_TIMEOUT);
+		if (r < 0) {
+			LOG_ERR("uart_rx_enable() failed (%d)", r);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static int gb_xport_uart_init(void)
+{
+	int r;
+
+	LOG_INF("binding %s", CONFIG_GREYBUS_XPORT_UART_DEV);
+	uart_dev = device_get_binding(CONFIG_GREYBUS_XPORT_UART_DEV);
+	if (uart_dev == NULL) {
+		LOG_ERR("unable to bind device named %s!", CONFIG_GREYBUS_XPORT_UART_DEV);
+		r = -ENODEV;
+		goto out;
+	}
+
+	r = uart_callback_set(uart_dev, gb_xport_uart_cb, NULL);
+	if (r < 0) {
+		LOG_ERR("uart_callback_set() failed (%d)", r);
+		goto out;
+	}
+
+	uart_rx_buf_idx = 0;
+	r = uart_rx_enable(uart_dev, uart_rx_bufs[0], sizeof(uart_rx_bufs[0]),
+		UART_RX_TIMEOUT);
+	if (r < 0) {
+		LOG_ERR("uart_rx_enable() failed (%d)", r);
+		goto out;
+	}
+
+out:
+	return r;
+}
+
+#else /* CONFIG_UART_ASYNC_API */
+
 static void gb_xport_uart_isr(const struct device *dev, void *user_data)
 {
 	int r;
-	uint8_t byte;
-	uint8_t ovflw;
-	size_t count;
+	uint8_t *data;
+	uint8_t scratch[16];
+	uint32_t claimed;
+	bool received = false;
 
 	while (uart_irq_update(dev) &&
 	       uart_irq_is_pending(dev)) {
 
+		if (uart_irq_tx_ready(dev) && tx_remaining > 0) {
+			r = uart_fifo_fill(dev, tx_buf, tx_remaining);
+			if (r < 0) {
+				LOG_ERR("uart_fifo_fill() failed (%d)", r);
+				r = tx_remaining;
+			}
+			tx_buf += r;
+			tx_remaining -= r;
+			if (tx_remaining == 0) {
+				uart_irq_tx_disable(dev);
+				k_sem_give(&tx_sem);
+			}
+		}
+
 		if (!uart_irq_rx_ready(dev)) {
 			continue;
 		}
 
-		r = uart_fifo_read(dev, &byte, 1);
-		if (r < 0) {
-			LOG_ERR("uart_fifo_read() failed (%d)", r);
-			uart_irq_rx_disable(dev);
-			return;
-		}
+		/* drain the FIFO straight into the ring buffer */
+		for (;;) {
+			claimed = ring_buf_put_claim(&uart_rb, &data, UART_RB_SIZE);
+			if (claimed == 0) {
+				/* drop the newest bytes rather than corrupt the stream */
+				r = uart_fifo_read(dev, scratch, sizeof(scratch));
+				if (r > 0) {
+					stats.rx_overruns += r;
+					LOG_ERR("overflow occurred, %d bytes dropped", r);
+				}
+			} else {
+				r = uart_fifo_read(dev, data, claimed);
+				ring_buf_put_finish(&uart_rb, MAX(r, 0));
+			}
 
-		if (0 == ring_buf_space_get(&uart_rb)) {
-			r = ring_buf_get(&uart_rb, &ovflw, 1);
-			if (r != 1) {
-				LOG_ERR("failed to remove head of ring buffer");
+			if (r < 0) {
+				LOG_ERR("uart_fifo_read() failed (%d)", r);
 				uart_irq_rx_disable(dev);
 				return;
 			}
-			LOG_ERR("overflow occurred");
-		}
 
-		if (1 != ring_buf_put(&uart_rb, &byte, 1)) {
-			LOG_ERR("ring_buf_put() failed");
-			uart_irq_rx_disable(dev);
-			return;
+			if (r == 0) {
+				break;
+			}
+
+			received = true;
 		}
 	}
-	count = UART_RB_SIZE - ring_buf_space_get(&uart_rb);
-	if (count >= sizeof(struct gb_operation_hdr)) {
-		k_work_submit(&uart_work);
+
+	if (received) {
+		uart_rx_notify();
 	}
 }
 
@@ -243,7 +613,39 @@ out:
 	return r;
 }
 
-struct gb_transport_backend *gb_transport_backend_init(size_t num_cports) {
+#endif /* CONFIG_UART_ASYNC_API */
+
+void gb_transport_uart_stats_get(struct gb_transport_uart_stats *out)
+{
+	unsigned int key;
+
+	/* a consistent snapshot, since the ISR updates them */
+	key = irq_lock();
+	*out = stats;
+	irq_unlock(key);
+}
+
+#ifdef CONFIG_SHELL
+
+static int cmd_gb_uart(const struct shell *shell, size_t argc, char **argv)
+{
+	struct gb_transport_uart_stats s;
+
+	gb_transport_uart_stats_get(&s);
+	shell_print(shell, "    rx frames   overruns    framing        crc no buffers");
+	shell_print(shell, "%13u %10u %10u %10u %10u", s.rx_frames,
+		s.rx_overruns, s.rx_framing_errors, s.rx_crc_errors,
+		s.rx_no_buffers);
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(gb_uart, NULL,
+	"Show Greybus UART transport receive counters", cmd_gb_uart);
+
+#endif /* CONFIG_SHELL */
+
+struct gb_transport_backend *gb_transport_uart_init(size_t num_cports) {
 
 	int r;
 	struct gb_transport_backend *ret = NULL;
@@ -255,6 +657,11 @@ struct gb_transport_backend *gb_transport_backend_init(size_t num_cports) {
 		goto out;
 		}
 
+	r = gb_xport_compress_init(num_cports);
+	if (r < 0) {
+		goto out;
+	}
+
 	r = gb_xport_uart_init();
 	if (r < 0) {
 		goto out;
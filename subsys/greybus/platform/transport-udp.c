@@ -0,0 +1,684 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr.h>
+#include <sys/dlist.h>
+
+#if defined(CONFIG_BOARD_NATIVE_POSIX_64BIT) \
+    || defined(CONFIG_BOARD_NATIVE_POSIX_32BIT) \
+    || defined(CONFIG_BOARD_NRF52_BSIM)
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/byteorder.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static inline struct sockaddr_in *net_sin(struct sockaddr *sa)
+{
+	return (struct sockaddr_in *)sa;
+}
+
+static inline struct sockaddr_in6 *net_sin6(struct sockaddr *sa)
+{
+	return (struct sockaddr_in6 *)sa;
+}
+
+/* For some reason, not declared even with _GNU_SOURCE */
+extern int pthread_setname_np(pthread_t thread, const char *name);
+
+#else
+
+#include <greybus/greybus.h>
+#include <greybus-utils/manifest.h>
+#include <posix/unistd.h>
+#include <posix/pthread.h>
+#include <net/net_ip.h>
+
+#endif
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(greybus_transport_udp, CONFIG_GREYBUS_LOG_LEVEL);
+
+#include "transport.h"
+#include "../greybus-stubs.h"
+
+#ifdef CONFIG_DNS_SD
+#include <net/dns_sd.h>
+#endif
+
+/* Based on UniPro, from Linux */
+#define CPORT_ID_MAX 4095
+
+#define GB_TRANSPORT_UDP_BASE_PORT 4242
+
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+
+/*
+ * In reliable mode, every datagram is prefixed with a small header that
+ * carries a per-CPort sequence number. Data datagrams are acknowledged
+ * by the receiver and retransmitted by the sender until acknowledged or
+ * until CONFIG_GREYBUS_XPORT_UDP_MAX_RETRIES is exhausted. Retransmission
+ * runs from the same per-CPort watchdog as the core operation timeout, and
+ * final failure is left to the latter, which is longer than the whole
+ * retransmission schedule.
+ */
+struct gb_udp_hdr {
+	uint8_t flags;
+	uint8_t reserved;
+	uint16_t seq;
+} __packed;
+
+#define GB_UDP_F_DATA BIT(0)
+#define GB_UDP_F_ACK BIT(1)
+
+/* size of the duplicate suppression window, in sequence numbers */
+#define GB_UDP_DUP_WINDOW 32
+
+BUILD_ASSERT(CONFIG_GREYBUS_XPORT_UDP_RTO_MS *
+	(CONFIG_GREYBUS_XPORT_UDP_MAX_RETRIES + 1) < 1000,
+	"UDP retransmission must complete within the operation timeout");
+
+struct udp_pending {
+	sys_dnode_t node;
+	uint16_t seq;
+	uint8_t tries;
+	/* sendto() runs unlocked, so an ack may arrive while in flight */
+	bool in_flight;
+	bool acked;
+	int64_t deadline;
+	size_t len;
+	uint8_t data[];
+};
+
+#define GB_UDP_HDR_SIZE sizeof(struct gb_udp_hdr)
+
+#define GB_UDP_RTO_WD_DELAY \
+	((CONFIG_GREYBUS_XPORT_UDP_RTO_MS * CLOCKS_PER_SEC) / MSEC_PER_SEC)
+
+#else
+
+#define GB_UDP_HDR_SIZE 0
+
+#endif /* CONFIG_GREYBUS_XPORT_UDP_RELIABLE */
+
+struct udp_cport {
+	int fd;
+	bool have_peer;
+	struct sockaddr_storage peer;
+	socklen_t peer_len;
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	uint16_t tx_seq;
+	bool have_rx_seq;
+	uint16_t rx_seq;
+	uint32_t rx_window;
+	sys_dlist_t pending;
+	struct k_sem window;
+	struct wdog_s retransmit_wd;
+#endif
+};
+
+#ifdef CONFIG_DNS_SD
+DNS_SD_REGISTER_UDP_SERVICE(gb_service_advertisement, CONFIG_NET_HOSTNAME,
+	"_greybus", "local", DNS_SD_EMPTY_TXT, GB_TRANSPORT_UDP_BASE_PORT);
+#endif
+
+static struct udp_cport *cports;
+static size_t num_udp_cports;
+static struct k_mutex cports_mutex;
+static pthread_t service_thread_id;
+static struct pollfd pollfds[CONFIG_NET_SOCKETS_POLL_MAX];
+static uint8_t rx_buf[GB_UDP_HDR_SIZE + GB_MTU];
+
+/* must be called without cports_mutex held */
+static int send_datagram(struct udp_cport *ucp, const void *buf, size_t len)
+{
+	ssize_t r;
+	struct sockaddr_storage peer;
+	socklen_t peer_len;
+
+	k_mutex_lock(&cports_mutex, K_FOREVER);
+	if (!ucp->have_peer) {
+		k_mutex_unlock(&cports_mutex);
+		return -ENOTCONN;
+	}
+	memcpy(&peer, &ucp->peer, ucp->peer_len);
+	peer_len = ucp->peer_len;
+	k_mutex_unlock(&cports_mutex);
+
+	r = sendto(ucp->fd, buf, len, 0, (struct sockaddr *)&peer, peer_len);
+	if (r < 0) {
+		LOG_ERR("sendto: %d", errno);
+		return -errno;
+	}
+
+	if ((size_t)r != len) {
+		LOG_ERR("short datagram %d / %zu", (int)r, len);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+
+static void retransmit_timeout(int argc, uint32_t cport, ...);
+
+static void send_ack(struct udp_cport *ucp, uint16_t seq)
+{
+	struct gb_udp_hdr ack = {
+		.flags = GB_UDP_F_ACK,
+		.seq = sys_cpu_to_le16(seq),
+	};
+
+	(void)send_datagram(ucp, &ack, sizeof(ack));
+}
+
+/* must be called with cports_mutex held */
+static void pending_release(struct udp_cport *ucp, struct udp_pending *p)
+{
+	sys_dlist_remove(&p->node);
+	free(p);
+	k_sem_give(&ucp->window);
+}
+
+/*
+ * Send a pending datagram with cports_mutex dropped around sendto(). The
+ * entry is released here if it was acked in the meantime, so the caller
+ * must not touch it again after a successful send.
+ */
+static int send_pending(struct udp_cport *ucp, struct udp_pending *p)
+{
+	int r;
+
+	p->in_flight = true;
+	k_mutex_unlock(&cports_mutex);
+	r = send_datagram(ucp, p->data, p->len);
+	k_mutex_lock(&cports_mutex, K_FOREVER);
+	p->in_flight = false;
+
+	if (p->acked) {
+		pending_release(ucp, p);
+	}
+
+	return r;
+}
+
+static void handle_ack(struct udp_cport *ucp, uint16_t seq)
+{
+	struct udp_pending *p;
+
+	k_mutex_lock(&cports_mutex, K_FOREVER);
+	SYS_DLIST_FOR_EACH_CONTAINER(&ucp->pending, p, node) {
+		if (p->seq == seq) {
+			if (p->in_flight) {
+				p->acked = true;
+			} else {
+				pending_release(ucp, p);
+			}
+			break;
+		}
+	}
+	k_mutex_unlock(&cports_mutex);
+}
+
+/* return true if seq has already been delivered */
+static bool rx_seq_is_dup(struct udp_cport *ucp, uint16_t seq)
+{
+	int16_t delta;
+
+	if (!ucp->have_rx_seq) {
+		ucp->have_rx_seq = true;
+		ucp->rx_seq = seq;
+		ucp->rx_window = BIT(0);
+		return false;
+	}
+
+	delta = (int16_t)(seq - ucp->rx_seq);
+	if (delta > 0) {
+		ucp->rx_window = (delta >= GB_UDP_DUP_WINDOW) ? 0
+			: ucp->rx_window << delta;
+		ucp->rx_window |= BIT(0);
+		ucp->rx_seq = seq;
+		return false;
+	}
+
+	delta = -delta;
+	if (delta >= GB_UDP_DUP_WINDOW) {
+		/* too old to tell, most likely a peer restart */
+		ucp->rx_seq = seq;
+		ucp->rx_window = BIT(0);
+		return false;
+	}
+
+	if (ucp->rx_window & BIT(delta)) {
+		return true;
+	}
+
+	ucp->rx_window |= BIT(delta);
+	return false;
+}
+
+static void retransmit_arm(struct udp_cport *ucp)
+{
+	wd_start(&ucp->retransmit_wd, GB_UDP_RTO_WD_DELAY, retransmit_timeout, 1,
+		ucp - cports);
+}
+
+/* return the oldest datagram that is due and not being sent already */
+static struct udp_pending *pending_due(struct udp_cport *ucp, int64_t now)
+{
+	struct udp_pending *p;
+
+	SYS_DLIST_FOR_EACH_CONTAINER(&ucp->pending, p, node) {
+		if (!p->in_flight && !p->acked && p->deadline <= now) {
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+static void retransmit_timeout(int argc, uint32_t cport, ...)
+{
+	int64_t now = k_uptime_get();
+	struct udp_pending *p;
+	struct udp_cport *ucp = &cports[cport];
+	bool rearm;
+
+	ARG_UNUSED(argc);
+
+	k_mutex_lock(&cports_mutex, K_FOREVER);
+	while ((p = pending_due(ucp, now)) != NULL) {
+		if (p->tries >= CONFIG_GREYBUS_XPORT_UDP_MAX_RETRIES) {
+			LOG_WRN("cport %u: giving up on seq %u", cport, p->seq);
+			pending_release(ucp, p);
+			continue;
+		}
+
+		p->tries++;
+		p->deadline = now + CONFIG_GREYBUS_XPORT_UDP_RTO_MS;
+		(void)send_pending(ucp, p);
+	}
+	rearm = !sys_dlist_is_empty(&ucp->pending);
+	k_mutex_unlock(&cports_mutex);
+
+	if (rearm) {
+		retransmit_arm(ucp);
+	}
+}
+
+static int send_reliable(struct udp_cport *ucp, const void *buf, size_t len)
+{
+	int r;
+	struct udp_pending *p;
+	struct gb_udp_hdr *hdr;
+
+	/* the oldest datagram is acked or given up within one more RTO */
+	r = k_sem_take(&ucp->window, K_MSEC(CONFIG_GREYBUS_XPORT_UDP_RTO_MS *
+		(CONFIG_GREYBUS_XPORT_UDP_MAX_RETRIES + 2)));
+	if (r < 0) {
+		return -ETIMEDOUT;
+	}
+
+	p = malloc(sizeof(*p) + sizeof(*hdr) + len);
+	if (p == NULL) {
+		k_sem_give(&ucp->window);
+		return -ENOMEM;
+	}
+
+	hdr = (struct gb_udp_hdr *)p->data;
+	hdr->flags = GB_UDP_F_DATA;
+	hdr->reserved = 0;
+	memcpy(&p->data[sizeof(*hdr)], buf, len);
+	p->len = sizeof(*hdr) + len;
+	p->tries = 0;
+	p->in_flight = false;
+	p->acked = false;
+	sys_dnode_init(&p->node);
+
+	k_mutex_lock(&cports_mutex, K_FOREVER);
+	p->seq = ucp->tx_seq++;
+	hdr->seq = sys_cpu_to_le16(p->seq);
+	p->deadline = k_uptime_get() + CONFIG_GREYBUS_XPORT_UDP_RTO_MS;
+	sys_dlist_append(&ucp->pending, &p->node);
+	r = send_pending(ucp, p);
+	if (r < 0) {
+		/* never reached the peer, so it cannot have been acked */
+		pending_release(ucp, p);
+	} else if (!WDOG_ISACTIVE(&ucp->retransmit_wd)) {
+		retransmit_arm(ucp);
+	}
+	k_mutex_unlock(&cports_mutex);
+
+	return r;
+}
+
+#endif /* CONFIG_GREYBUS_XPORT_UDP_RELIABLE */
+
+static void handle_datagram(unsigned int cport)
+{
+	struct udp_cport *ucp = &cports[cport];
+	struct sockaddr_storage peer;
+	socklen_t peer_len = sizeof(peer);
+	struct gb_operation_hdr *msg;
+	size_t len;
+	int r;
+
+	r = recvfrom(ucp->fd, rx_buf, sizeof(rx_buf), 0,
+		(struct sockaddr *)&peer, &peer_len);
+	if (r < 0) {
+		LOG_ERR("recvfrom: %d", errno);
+		return;
+	}
+
+	len = r;
+
+	/* replies go to whoever spoke to this CPort last */
+	k_mutex_lock(&cports_mutex, K_FOREVER);
+	memcpy(&ucp->peer, &peer, peer_len);
+	ucp->peer_len = peer_len;
+	ucp->have_peer = true;
+	k_mutex_unlock(&cports_mutex);
+
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	struct gb_udp_hdr *hdr = (struct gb_udp_hdr *)rx_buf;
+	uint16_t seq;
+
+	if (len < sizeof(*hdr)) {
+		LOG_DBG("cport %u: runt datagram (%zu bytes)", cport, len);
+		return;
+	}
+
+	seq = sys_le16_to_cpu(hdr->seq);
+
+	if (hdr->flags & GB_UDP_F_ACK) {
+		handle_ack(ucp, seq);
+		return;
+	}
+
+	if (!(hdr->flags & GB_UDP_F_DATA)) {
+		LOG_DBG("cport %u: unknown flags %x", cport, hdr->flags);
+		return;
+	}
+
+	/* always ack, the previous ack may have been lost */
+	send_ack(ucp, seq);
+
+	if (rx_seq_is_dup(ucp, seq)) {
+		LOG_DBG("cport %u: dropping duplicate seq %u", cport, seq);
+		return;
+	}
+#endif
+
+	msg = (struct gb_operation_hdr *)&rx_buf[GB_UDP_HDR_SIZE];
+	len -= GB_UDP_HDR_SIZE;
+
+	if (len < sizeof(*msg) || sys_le16_to_cpu(msg->size) != len) {
+		LOG_ERR("cport %u: invalid datagram size %zu", cport, len);
+		return;
+	}
+
+	r = greybus_rx_handler(cport, msg, len);
+	if (r < 0) {
+		LOG_ERR("cport %u failed to handle message: size: %u, id: %u, type: %u",
+			cport, sys_le16_to_cpu(msg->size),
+			sys_le16_to_cpu(msg->id), msg->type);
+	}
+}
+
+static void *service_thread(void *arg)
+{
+	int r;
+	size_t i;
+
+	ARG_UNUSED(arg);
+
+	for (i = 0; i < num_udp_cports; ++i) {
+		pollfds[i].fd = cports[i].fd;
+		pollfds[i].events = POLLIN;
+	}
+
+	for (;;) {
+		r = poll(pollfds, num_udp_cports, -1);
+		if (-1 == r) {
+			LOG_ERR("poll failed: %d", errno);
+			break;
+		}
+
+		for (i = 0; r > 0 && i < num_udp_cports; ++i) {
+			if (pollfds[i].revents & POLLIN) {
+				handle_datagram(i);
+				--r;
+			}
+		}
+	}
+
+	LOG_WRN("Greybus is quitting");
+
+	return NULL;
+}
+
+static void gb_xport_init(void)
+{
+}
+
+static void gb_xport_exit(void)
+{
+}
+
+static int gb_xport_listen_start(unsigned int cport)
+{
+	return 0;
+}
+
+static int gb_xport_listen_stop(unsigned int cport)
+{
+	return 0;
+}
+
+static int gb_xport_send(unsigned int cport, const void *buf, size_t len)
+{
+	int r;
+	const struct gb_operation_hdr *msg = buf;
+
+	if (NULL == msg) {
+		LOG_ERR("message is NULL");
+		return -EINVAL;
+	}
+
+	if (sys_le16_to_cpu(msg->size) != len || len < sizeof(*msg)) {
+		LOG_ERR("invalid message size %u (len: %u)",
+			(unsigned)sys_le16_to_cpu(msg->size), (unsigned)len);
+		return -EINVAL;
+	}
+
+	if (cport >= num_udp_cports) {
+		LOG_ERR("invalid cport %u", cport);
+		return -EINVAL;
+	}
+
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	r = send_reliable(&cports[cport], buf, len);
+#else
+	r = send_datagram(&cports[cport], buf, len);
+#endif
+
+	return r;
+}
+
+static void *gb_xport_alloc_buf(size_t size)
+{
+	void *p = malloc(size);
+
+	if (!p) {
+		LOG_ERR("Failed to allocate %zu bytes", size);
+	}
+
+	return p;
+}
+
+static void gb_xport_free_buf(void *ptr)
+{
+	free(ptr);
+}
+
+static const struct gb_transport_backend gb_xport = {
+	.init = gb_xport_init,
+	.exit = gb_xport_exit,
+	.listen = gb_xport_listen_start,
+	.stop_listening = gb_xport_listen_stop,
+	.send = gb_xport_send,
+	.send_async = NULL,
+	.alloc_buf = gb_xport_alloc_buf,
+	.free_buf = gb_xport_free_buf,
+};
+
+static int netsetup(size_t num_cports)
+{
+	int r;
+	int fd;
+	size_t i;
+	int family;
+	uint16_t *port;
+	struct sockaddr sa;
+	socklen_t sa_len;
+
+	memset(&sa, 0, sizeof(sa));
+	if (IS_ENABLED(CONFIG_NET_IPV6)) {
+		family = AF_INET6;
+		net_sin6(&sa)->sin6_family = AF_INET6;
+		net_sin6(&sa)->sin6_addr = in6addr_any;
+		port = &net_sin6(&sa)->sin6_port;
+		sa_len = sizeof(struct sockaddr_in6);
+	} else if (IS_ENABLED(CONFIG_NET_IPV4)) {
+		family = AF_INET;
+		net_sin(&sa)->sin_family = AF_INET;
+		net_sin(&sa)->sin_addr.s_addr = INADDR_ANY;
+		port = &net_sin(&sa)->sin_port;
+		sa_len = sizeof(struct sockaddr_in);
+	} else {
+		LOG_ERR("Neither IPv6 nor IPv4 is available");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < num_cports; ++i) {
+		/* poll() ignores the negative fd of unrouted cports */
+		if (!gb_transport_cport_routed(i, GREYBUS_TRANSPORT_UDP)) {
+			continue;
+		}
+
+		fd = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+		if (fd == -1) {
+			LOG_ERR("socket: %d", errno);
+			return -errno;
+		}
+
+		cports[i].fd = fd;
+
+		*port = htons(GB_TRANSPORT_UDP_BASE_PORT + i);
+		r = bind(fd, &sa, sa_len);
+		if (-1 == r) {
+			LOG_ERR("bind: %d", errno);
+			return -errno;
+		}
+
+		LOG_INF("CPort %zu mapped to UDP port %zu",
+			i, GB_TRANSPORT_UDP_BASE_PORT + i);
+	}
+
+	return 0;
+}
+
+static void cports_clear(void)
+{
+	size_t i;
+
+	for (i = 0; i < num_udp_cports; ++i) {
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+		wd_delete(&cports[i].retransmit_wd);
+#endif
+		if (cports[i].fd >= 0) {
+			close(cports[i].fd);
+		}
+	}
+
+	free(cports);
+	cports = NULL;
+	num_udp_cports = 0;
+}
+
+struct gb_transport_backend *gb_transport_udp_init(size_t num_cports)
+{
+	int r;
+	size_t i;
+	struct gb_transport_backend *ret = NULL;
+
+	LOG_DBG("Greybus UDP Transport initializing..");
+
+	if (num_cports >= CPORT_ID_MAX) {
+		LOG_ERR("invalid number of cports %u", (unsigned)num_cports);
+		goto out;
+	}
+
+	if (num_cports > ARRAY_SIZE(pollfds)) {
+		LOG_ERR("Number of cports (%zu) exceeds number of pollfds available (%zu)",
+			num_cports, ARRAY_SIZE(pollfds));
+		goto out;
+	}
+
+	cports = calloc(num_cports, sizeof(*cports));
+	if (cports == NULL) {
+		LOG_ERR("failed to allocate cports");
+		goto out;
+	}
+
+	num_udp_cports = num_cports;
+	k_mutex_init(&cports_mutex);
+	for (i = 0; i < num_cports; ++i) {
+		cports[i].fd = -1;
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+		sys_dlist_init(&cports[i].pending);
+		k_sem_init(&cports[i].window, CONFIG_GREYBUS_XPORT_UDP_TX_WINDOW,
+			CONFIG_GREYBUS_XPORT_UDP_TX_WINDOW);
+		wd_static(&cports[i].retransmit_wd);
+#endif
+	}
+
+	r = netsetup(num_cports);
+	if (r < 0) {
+		LOG_ERR("netsetup() failed: %d", r);
+		goto cleanup;
+	}
+
+	r = pthread_create(&service_thread_id, NULL, service_thread, NULL);
+	if (r != 0) {
+		LOG_ERR("pthread_create: %d", r);
+		goto cleanup;
+	}
+
+	pthread_setname_np(service_thread_id, "greybus");
+
+	ret = (struct gb_transport_backend *)&gb_xport;
+
+	LOG_INF("Greybus UDP Transport initialized");
+
+	goto out;
+
+cleanup:
+	cports_clear();
+
+out:
+	return ret;
+}
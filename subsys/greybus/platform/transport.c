@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <devicetree.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr.h>
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(greybus_transport, CONFIG_GREYBUS_LOG_LEVEL);
+
+#include "transport.h"
+
+#if defined(CONFIG_GREYBUS_XPORT_DEFAULT_UDP)
+#define GB_TRANSPORT_DEFAULT GREYBUS_TRANSPORT_UDP
+#elif defined(CONFIG_GREYBUS_XPORT_DEFAULT_UART)
+#define GB_TRANSPORT_DEFAULT GREYBUS_TRANSPORT_UART
+#elif defined(CONFIG_GREYBUS_XPORT_DEFAULT_SHM)
+#define GB_TRANSPORT_DEFAULT GREYBUS_TRANSPORT_SHM
+#else
+#define GB_TRANSPORT_DEFAULT GREYBUS_TRANSPORT_TCPIP
+#endif
+
+struct gb_transport_entry {
+	uint8_t id;
+	const char *name;
+	struct gb_transport_backend *(*init)(size_t num_cports);
+};
+
+static const struct gb_transport_entry transports[] = {
+#ifdef CONFIG_GREYBUS_XPORT_TCPIP
+	{ GREYBUS_TRANSPORT_TCPIP, "TCP/IP", gb_transport_tcpip_init },
+#endif
+#ifdef CONFIG_GREYBUS_XPORT_UDP
+	{ GREYBUS_TRANSPORT_UDP, "UDP", gb_transport_udp_init },
+#endif
+#ifdef CONFIG_GREYBUS_XPORT_UART
+	{ GREYBUS_TRANSPORT_UART, "UART", gb_transport_uart_init },
+#endif
+#ifdef CONFIG_GREYBUS_XPORT_SHM
+	{ GREYBUS_TRANSPORT_SHM, "SHM", gb_transport_shm_init },
+#endif
+};
+
+BUILD_ASSERT(ARRAY_SIZE(transports) > 0, "no Greybus transport enabled");
+
+/* the greybus-transport property of every cport, indexed by cport id */
+#define GB_CPORT_TRANSPORT(node_id) \
+	[DT_PROP(node_id, id)] = DT_PROP(node_id, greybus_transport),
+
+static const uint8_t cport_transport[] = {
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_control, GB_CPORT_TRANSPORT)
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_gpio_controller, GB_CPORT_TRANSPORT)
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_i2c_controller, GB_CPORT_TRANSPORT)
+	DT_FOREACH_STATUS_OKAY(zephyr_greybus_spi_controller, GB_CPORT_TRANSPORT)
+};
+
+static struct gb_transport_backend *backends[GREYBUS_TRANSPORT_COUNT];
+
+uint8_t gb_transport_for_cport(unsigned int cport)
+{
+	uint8_t id = GREYBUS_TRANSPORT_DEFAULT;
+
+	if (cport < ARRAY_SIZE(cport_transport)) {
+		id = cport_transport[cport];
+	}
+
+	return (id == GREYBUS_TRANSPORT_DEFAULT) ? GB_TRANSPORT_DEFAULT : id;
+}
+
+static struct gb_transport_backend *backend_for(unsigned int cport)
+{
+	uint8_t id = gb_transport_for_cport(cport);
+
+	return (id < ARRAY_SIZE(backends)) ? backends[id] : NULL;
+}
+
+static void gb_xport_init(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(backends); ++i) {
+		if (backends[i] != NULL && backends[i]->init != NULL) {
+			backends[i]->init();
+		}
+	}
+}
+
+static void gb_xport_exit(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(backends); ++i) {
+		if (backends[i] != NULL && backends[i]->exit != NULL) {
+			backends[i]->exit();
+		}
+	}
+}
+
+static int gb_xport_listen(unsigned int cport)
+{
+	struct gb_transport_backend *xport = backend_for(cport);
+
+	if (xport == NULL || xport->listen == NULL) {
+		return -EINVAL;
+	}
+
+	return xport->listen(cport);
+}
+
+static int gb_xport_stop_listening(unsigned int cport)
+{
+	struct gb_transport_backend *xport = backend_for(cport);
+
+	if (xport == NULL || xport->stop_listening == NULL) {
+		return -EINVAL;
+	}
+
+	return xport->stop_listening(cport);
+}
+
+static int gb_xport_send(unsigned int cport, const void *buf, size_t len)
+{
+	struct gb_transport_backend *xport = backend_for(cport);
+
+	if (xport == NULL) {
+		return -EINVAL;
+	}
+
+	return xport->send(cport, buf, len);
+}
+
+static int gb_xport_send_async(unsigned int cport, const void *buf, size_t len,
+	unipro_send_completion_t callback, void *priv)
+{
+	struct gb_transport_backend *xport = backend_for(cport);
+
+	if (xport == NULL || xport->send_async == NULL) {
+		return -ENOTSUP;
+	}
+
+	return xport->send_async(cport, buf, len, callback, priv);
+}
+
+/*
+ * Buffers are not tied to a cport when they are allocated, so all
+ * transports must allocate from the same heap. They all use malloc().
+ */
+static void *gb_xport_alloc_buf(size_t size)
+{
+	return backends[GB_TRANSPORT_DEFAULT]->alloc_buf(size);
+}
+
+static void gb_xport_free_buf(void *ptr)
+{
+	backends[GB_TRANSPORT_DEFAULT]->free_buf(ptr);
+}
+
+static void gb_xport_rxbuf_free(unsigned int cport, void *ptr)
+{
+	struct gb_transport_backend *xport = backend_for(cport);
+
+	if (xport != NULL && xport->rxbuf_free != NULL) {
+		xport->rxbuf_free(cport, ptr);
+	} else {
+		unipro_rxbuf_free(cport, ptr);
+	}
+}
+
+static struct gb_transport_backend gb_xport_mux = {
+	.init = gb_xport_init,
+	.exit = gb_xport_exit,
+	.listen = gb_xport_listen,
+	.stop_listening = gb_xport_stop_listening,
+	.send = gb_xport_send,
+	.send_async = gb_xport_send_async,
+	.alloc_buf = gb_xport_alloc_buf,
+	.free_buf = gb_xport_free_buf,
+	.rxbuf_free = gb_xport_rxbuf_free,
+};
+
+static const struct gb_transport_entry *transport_entry(uint8_t id)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(transports); ++i) {
+		if (transports[i].id == id) {
+			return &transports[i];
+		}
+	}
+
+	return NULL;
+}
+
+struct gb_transport_backend *gb_transport_backend_init(size_t num_cports)
+{
+	size_t i;
+	size_t num_backends = 0;
+	uint8_t id;
+	uint8_t last = GB_TRANSPORT_DEFAULT;
+	const struct gb_transport_entry *entry;
+	bool used[GREYBUS_TRANSPORT_COUNT] = {};
+
+	for (i = 0; i < num_cports; ++i) {
+		id = gb_transport_for_cport(i);
+		if (transport_entry(id) == NULL) {
+			LOG_ERR("cport %zu: transport %u is not enabled", i, id);
+			return NULL;
+		}
+
+		used[id] = true;
+	}
+
+	/* the default transport provides buffers for the mux */
+	used[GB_TRANSPORT_DEFAULT] = true;
+
+	for (id = 0; id < ARRAY_SIZE(used); ++id) {
+		if (!used[id]) {
+			continue;
+		}
+
+		entry = transport_entry(id);
+		if (entry == NULL) {
+			LOG_ERR("default transport %u is not enabled", id);
+			return NULL;
+		}
+
+		backends[id] = entry->init(num_cports);
+		if (backends[id] == NULL) {
+			LOG_ERR("failed to initialize %s transport", entry->name);
+			return NULL;
+		}
+
+		LOG_DBG("%s transport initialized", entry->name);
+		last = id;
+		num_backends++;
+	}
+
+	/* without routing to do, the core talks to the transport directly */
+	if (num_backends == 1) {
+		return backends[last];
+	}
+
+	return &gb_xport_mux;
+}
@@ -7,9 +7,51 @@
 #ifndef GREYBUS_TRANSPORT_H_
 #define GREYBUS_TRANSPORT_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <dt-bindings/greybus/greybus.h>
 #include <greybus/greybus.h>
 
+/*
+ * Initialize every transport that carries at least one cport, and return
+ * a backend that routes each cport to its transport.
+ */
 struct gb_transport_backend *gb_transport_backend_init(size_t num_cports);
 const struct gb_transport_backend *gb_transport_get_backend(void);
 
+/* the GREYBUS_TRANSPORT_* that carries @p cport */
+uint8_t gb_transport_for_cport(unsigned int cport);
+
+static inline bool gb_transport_cport_routed(unsigned int cport,
+	uint8_t transport)
+{
+	return gb_transport_for_cport(cport) == transport;
+}
+
+/*
+ * Individual transports. Each one is passed the total number of cports,
+ * and only serves those for which gb_transport_cport_routed() is true.
+ */
+struct gb_transport_backend *gb_transport_tcpip_init(size_t num_cports);
+struct gb_transport_backend *gb_transport_udp_init(size_t num_cports);
+struct gb_transport_backend *gb_transport_uart_init(size_t num_cports);
+struct gb_transport_backend *gb_transport_shm_init(size_t num_cports);
+
+/* receive counters of the UART transport, since boot */
+struct gb_transport_uart_stats {
+	/* messages handed to the core */
+	uint32_t rx_frames;
+	/* bytes dropped because the receive ring buffer was full */
+	uint32_t rx_overruns;
+	/* frames dropped for bad delimiting, length or encoding */
+	uint32_t rx_framing_errors;
+	/* frames dropped for a bad checksum */
+	uint32_t rx_crc_errors;
+	/* frames dropped because no receive buffer was free */
+	uint32_t rx_no_buffers;
+};
+
+void gb_transport_uart_stats_get(struct gb_transport_uart_stats *stats);
+
 #endif /* GREYBUS_TRANSPORT_H_ */
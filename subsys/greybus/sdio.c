@@ -168,7 +168,7 @@ static uint8_t gb_sdio_protocol_get_capabilities(struct gb_operation *operation)
      * The host Greybus uses max_blk_count * max_blk_size to request data,
      * we must restrict the size under max protocol response package size.
      */
-    max_data_size = GB_MAX_PAYLOAD_SIZE -
+    max_data_size = GB_MAX_OPERATION_PAYLOAD_SIZE -
                     sizeof(struct gb_sdio_transfer_response);
     max_data_size = scale_max_sd_block_length(max_data_size);
     if (!max_data_size) {
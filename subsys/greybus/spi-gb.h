@@ -37,6 +37,9 @@
 #define GB_SPI_TYPE_MASTER_CONFIG   0x02    /* Get config for SPI master */
 #define GB_SPI_TYPE_DEVICE_CONFIG   0x03    /* Get config for SPI device */
 #define GB_SPI_PROTOCOL_TRANSFER    0x04    /* Transfer */
+#define GB_SPI_PROTOCOL_PERIODIC_START  0x40  /* Start periodic transfer */
+#define GB_SPI_PROTOCOL_PERIODIC_STOP   0x41  /* Stop periodic transfer */
+#define GB_SPI_PROTOCOL_PERIODIC_DATA   0x42  /* Periodic transfer samples */
 
 /*
  * SPI Protocol Mode Bit Masks
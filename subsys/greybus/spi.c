@@ -47,6 +47,8 @@ extern int usleep(useconds_t usec);
 #include <posix/unistd.h>
 #endif
 
+#include "periodic.h"
+#include "periodic-gb.h"
 #include "spi-gb.h"
 
 LOG_MODULE_REGISTER(greybus_spi, CONFIG_GREYBUS_LOG_LEVEL);
@@ -54,6 +56,86 @@ LOG_MODULE_REGISTER(greybus_spi, CONFIG_GREYBUS_LOG_LEVEL);
 #define GB_SPI_VERSION_MAJOR 0
 #define GB_SPI_VERSION_MINOR 1
 
+#define GB_SPI_DMA_ALIGN CONFIG_GREYBUS_SPI_DMA_ALIGN
+BUILD_ASSERT(IS_POWER_OF_TWO(GB_SPI_DMA_ALIGN),
+    "SPI DMA alignment must be a power of two");
+
+/* a spi_config, and the request settings that it was built from */
+struct gb_spi_cs_config {
+    bool valid;
+    uint8_t mode;
+    uint8_t bpw;
+    uint32_t freq;
+    struct spi_config config;
+};
+
+struct gb_spi_cs {
+    /* get_cs_control() has been called, and whether it succeeded */
+    bool resolved;
+    bool has_cs_control;
+    struct spi_cs_control cs_control;
+    /* the configuration used most recently */
+    uint8_t cur;
+    struct gb_spi_cs_config configs[2];
+};
+
+/* the state of a transfer request between its segments */
+struct gb_spi_xfer {
+    const struct gb_spi_transfer_request *request;
+    const uint8_t *write_data;
+    uint8_t *read_data;
+    struct spi_buf *bufs;
+    int op_count;
+    /* the first descriptor of the next segment */
+    int first;
+    /* the configuration of the current segment */
+    struct spi_config *config;
+    /* a configuration that chip select is held with */
+    struct spi_config *held;
+    struct spi_buf_set tx;
+    struct spi_buf_set rx;
+    bool has_tx;
+    bool has_rx;
+#if GB_SPI_DMA_ALIGN > 1
+    /* where read data of the current segment goes */
+    uint8_t *segment_read_data;
+#endif
+};
+
+struct gb_spi_bundle {
+    const struct device *dev;
+    const struct device *gb_spidev;
+    /* held by the transfer on the bus, which owns everything below */
+    struct k_sem bus;
+    /* the configuration passed to the controller most recently */
+    const struct spi_config *last;
+    /* buffer descriptors, two per transfer descriptor */
+    struct spi_buf *bufs;
+    size_t num_bufs;
+#if GB_SPI_DMA_ALIGN > 1
+    /* aligned room for the data of a segment, in bounce_mem */
+    void *bounce_mem;
+    uint8_t *bounce;
+    size_t bounce_size;
+#endif
+#ifdef CONFIG_GREYBUS_SPI_ASYNC
+    /* transfers waiting for the bus */
+    struct k_spinlock pending_lock;
+    struct list_head pending;
+    /* the transfer on the bus */
+    struct gb_operation *operation;
+    struct gb_spi_xfer xfer;
+    struct k_poll_signal signal;
+    struct k_poll_event event;
+    struct k_work_poll poll;
+    struct k_delayed_work delay;
+    /* whether the controller implements spi_transceive_async() */
+    bool async;
+#endif
+    size_t num_cs;
+    struct gb_spi_cs cs[0];
+};
+
 /**
  * @brief Returns the major and minor Greybus SPI protocol version number
  *        supported by the SPI master
@@ -185,18 +267,9 @@ static uint8_t gb_spi_protocol_device_config(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
-static int request_to_spi_config(const struct gb_spi_transfer_request *const request,
-	const size_t freq, const uint8_t bits_per_word, const struct device *spi_dev, struct spi_config *const spi_config, struct spi_cs_control *ctrl)
+static void request_to_spi_config(const struct gb_spi_transfer_request *const request,
+	const size_t freq, const uint8_t bits_per_word, struct spi_config *const spi_config, const struct spi_cs_control *ctrl)
 {
-    const struct device *gb_spidev = gb_spidev_from_zephyr_spidev(spi_dev);
-
-    if (gb_spidev == NULL) {
-    	return -ENODEV;
-    }
-
-    const struct gb_platform_spi_api *api = gb_spidev->api;
-    __ASSERT_NO_MSG(api != NULL);
-
     spi_config->frequency = freq;
     spi_config->slave = request->chip_select;
     spi_config->operation = SPI_OP_MODE_MASTER | SPI_WORD_SET(bits_per_word);
@@ -249,187 +322,868 @@ static int request_to_spi_config(const struct gb_spi_transfer_request *const req
 		/* LOG_DBG("GB_SPI_FLAG_{HALF_DUPLEX,NO_{RX,TX}} not handled"); */
     }
 
-    if (!api->get_cs_control(gb_spidev, request->chip_select, ctrl)) {
-        spi_config->cs = ctrl;
-    } else {
-        spi_config->cs = NULL;
-    }
-
-    return 0;
+    spi_config->cs = ctrl;
 }
 
 /**
- * @brief Performs a SPI transaction as one or more SPI transfers, defined
- *        in the supplied array.
+ * @brief Get a spi_config for a segment of a transfer request
  *
- * @param operation pointer to structure of Greybus operation message
- * @return GB_OP_SUCCESS on success, error code on failure
+ * Each chip select keeps the last two configurations it was used with.
+ * Drivers only reconfigure the controller when handed a different
+ * spi_config, so a configuration is never rebuilt in place while it is
+ * the one the controller was last configured with.
+ *
+ * @param spi SPI bundle data, locked
+ * @param request the transfer request
+ * @param desc the last transfer descriptor of the segment
+ * @param config where the configuration is stored
+ * @return 0 on success, negative errno on failure
  */
-static uint8_t gb_spi_protocol_transfer(struct gb_operation *operation)
+static int gb_spi_config_get(struct gb_spi_bundle *spi,
+	const struct gb_spi_transfer_request *request,
+	const struct gb_spi_transfer_desc *desc, struct spi_config **config)
 {
-    struct gb_spi_transfer_desc *desc;
-    struct gb_spi_transfer_request *request;
-    struct gb_spi_transfer_response *response;
-    struct spi_config spi_config;
-    struct spi_cs_control spi_cs_control;
+    const struct gb_platform_spi_api *api = spi->gb_spidev->api;
+    const uint32_t freq = sys_le32_to_cpu(desc->speed_hz);
+    struct gb_spi_cs *cs;
+    struct gb_spi_cs_config *slot;
+    size_t i;
+
+    if (request->chip_select >= spi->num_cs) {
+        return -EINVAL;
+    }
 
-    struct spi_buf_set _tx_buf_set;
-    struct spi_buf_set *const tx_buf_set = &_tx_buf_set;
-    struct spi_buf *tx_buf = NULL;
+    cs = &spi->cs[request->chip_select];
 
-    struct spi_buf_set _rx_buf_set;
-    struct spi_buf_set *rx_buf_set = &_rx_buf_set;
-    struct spi_buf *rx_buf = NULL;
+    for (i = 0; i < ARRAY_SIZE(cs->configs); ++i) {
+        slot = &cs->configs[i];
+        if (slot->valid && slot->mode == request->mode
+            && slot->freq == freq && slot->bpw == desc->bits_per_word) {
+            cs->cur = i;
+            *config = &slot->config;
+            return 0;
+        }
+    }
 
-    uint32_t read_data_size = 0;
-    uint8_t *write_data, *read_data;
-    int i, op_count;
-    uint8_t bits_per_word;
-    int ret = 0, errcode = GB_OP_SUCCESS;
-    size_t request_size;
-    size_t expected_size;
+    if (!cs->resolved) {
+        cs->has_cs_control = api->get_cs_control(spi->gb_spidev,
+            request->chip_select, &cs->cs_control) == 0;
+        cs->resolved = true;
+    }
 
-    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
-    __ASSERT_NO_MSG(bundle != NULL);
+    i = cs->cur ^ 1;
+    if (&cs->configs[i].config == spi->last) {
+        i ^= 1;
+    }
+
+    slot = &cs->configs[i];
+    request_to_spi_config(request, freq, desc->bits_per_word, &slot->config,
+        cs->has_cs_control ? &cs->cs_control : NULL);
+    slot->mode = request->mode;
+    slot->freq = freq;
+    slot->bpw = desc->bits_per_word;
+    slot->valid = true;
+
+    cs->cur = i;
+    *config = &slot->config;
+
+    return 0;
+}
+
+/**
+ * @brief Check that a transfer request is complete and supported
+ *
+ * @param request the transfer request
+ * @param request_size size of the request, in bytes
+ * @param read_size where the size of the read data is stored
+ * @return length of the request, write data included, or negative errno
+ */
+static int gb_spi_transfer_check(const struct gb_spi_transfer_request *request,
+	size_t request_size, size_t *read_size)
+{
+    const struct gb_spi_transfer_desc *desc;
+    size_t read_data_size = 0;
+    size_t write_data_size = 0;
+    size_t expected_size;
+    int i, op_count;
 
-    request_size = gb_operation_get_request_payload_size(operation);
     if (request_size < sizeof(*request)) {
         LOG_ERR("dropping short message");
-        errcode = GB_OP_INVALID;
-        goto out;
+        return -EINVAL;
     }
 
-    request = gb_operation_get_request_payload(operation);
     op_count = sys_le16_to_cpu(request->count);
 
-    if (op_count == 0) {
-		return GB_OP_SUCCESS;
+    expected_size = sizeof(*request) +
+                    op_count * sizeof(request->transfers[0]);
+    if (request_size < expected_size) {
+        LOG_ERR("dropping short message");
+        return -EINVAL;
     }
 
-    write_data = (uint8_t *)&request->transfers[op_count];
-    bits_per_word = request->transfers[0].bits_per_word;
-
-    for (i = 0, read_data_size = 0; i < op_count; ++i) {
+    for (i = 0; i < op_count; ++i) {
         desc = &request->transfers[i];
+
+        if (desc->rdwr & ~(GB_SPI_XFER_READ | GB_SPI_XFER_WRITE) ||
+            !desc->rdwr) {
+			LOG_ERR("invalid flags in rdwr %x", desc->rdwr);
+			return -EINVAL;
+        }
+
         if (desc->rdwr & GB_SPI_XFER_READ) {
 			if (sys_le32_to_cpu(desc->len) == 0) {
 				LOG_ERR("read operation of length 0 is invalid");
-				return GB_OP_INVALID;
+				return -EINVAL;
 			}
 			read_data_size += sys_le32_to_cpu(desc->len);
 		}
 
-        /* ensure 1 bpw setting */
-        if (desc->bits_per_word != bits_per_word) {
-			LOG_ERR("only 1 bpw setting supported");
-			return GB_OP_INVALID;
+        if (desc->rdwr & GB_SPI_XFER_WRITE) {
+			write_data_size += sys_le32_to_cpu(desc->len);
         }
 
-        /* ensure no cs_change */
-        if (desc->cs_change) {
-			LOG_ERR("cs_change not supported");
-			return GB_OP_INVALID;
+        if (desc->bits_per_word == 0) {
+			LOG_ERR("bits per word of 0 is invalid");
+			return -EINVAL;
         }
     }
 
-    tx_buf = malloc(op_count * 2 * sizeof(*tx_buf));
-    rx_buf = &tx_buf[op_count];
-	if (tx_buf == NULL) {
-		free(tx_buf);
-		LOG_ERR("Failed to allocate buffer descriptors");
-		errcode = GB_OP_NO_MEMORY;
-		goto out;
-	}
-
-    expected_size = sizeof(*request) +
-                    op_count * sizeof(request->transfers[0]);
-    if (request_size < expected_size) {
+    if (request_size < expected_size + write_data_size) {
         LOG_ERR("dropping short message");
-        errcode = GB_OP_INVALID;
-        goto freebufs;
+        return -EINVAL;
     }
 
-    response = gb_operation_alloc_response(operation, read_data_size);
-    if (!response) {
-		errcode = GB_OP_NO_MEMORY;
-		goto freebufs;
+    *read_size = read_data_size;
+
+    return expected_size + write_data_size;
+}
+
+/**
+ * @brief Whether a transfer descriptor ends a segment
+ *
+ * Segments are the runs of descriptors that spi_transceive() can issue
+ * at once, i.e. with the same spi_config and chip select held throughout.
+ *
+ * @param desc the transfer descriptor
+ * @param next the following transfer descriptor, or NULL for the last one
+ * @return true if @p desc is the last descriptor of its segment
+ */
+static bool gb_spi_segment_end(const struct gb_spi_transfer_desc *desc,
+	const struct gb_spi_transfer_desc *next)
+{
+    return next == NULL
+        || desc->cs_change
+        || desc->delay_usecs != 0
+        || next->bits_per_word != desc->bits_per_word
+        || next->speed_hz != desc->speed_hz;
+}
+
+static void gb_spi_xfer_init(struct gb_spi_xfer *xfer,
+	const struct gb_spi_transfer_request *request, uint8_t *read_data,
+	struct spi_buf *bufs)
+{
+    memset(xfer, 0, sizeof(*xfer));
+
+    xfer->request = request;
+    xfer->op_count = sys_le16_to_cpu(request->count);
+    xfer->write_data = (const uint8_t *)&request->transfers[xfer->op_count];
+    xfer->read_data = read_data;
+    xfer->bufs = bufs;
+}
+
+#if GB_SPI_DMA_ALIGN > 1
+static bool gb_spi_buf_aligned(const struct spi_buf *buf)
+{
+    return (((uintptr_t)buf->buf | buf->len) & (GB_SPI_DMA_ALIGN - 1)) == 0;
+}
+
+/**
+ * @brief Get room for @p size bytes of segment data, aligned for DMA
+ *
+ * @param spi SPI bundle data, locked
+ * @param size number of bytes
+ * @return the bounce buffer, or NULL
+ */
+static uint8_t *gb_spi_bounce_get(struct gb_spi_bundle *spi, size_t size)
+{
+    void *mem;
+
+    /* grown to the largest segment seen, like the buffer descriptors */
+    if (size > spi->bounce_size) {
+        mem = malloc(size + GB_SPI_DMA_ALIGN - 1);
+        if (mem == NULL) {
+            LOG_ERR("Failed to allocate bounce buffer");
+            return NULL;
+        }
+
+        free(spi->bounce_mem);
+        spi->bounce_mem = mem;
+        spi->bounce = (uint8_t *)ROUND_UP((uintptr_t)mem, GB_SPI_DMA_ALIGN);
+        spi->bounce_size = size;
     }
 
-    /* parse all transfer request from AP host side */
-    tx_buf_set->buffers = tx_buf;
-    tx_buf_set->count = 0;
+    return spi->bounce;
+}
 
-    if (read_data_size > 0) {
-        rx_buf_set->buffers = rx_buf;
-        rx_buf_set->count = 0;
-        read_data = response->data;
-    } else {
-		read_data = NULL;
-		rx_buf_set = NULL;
+/**
+ * @brief Move the misaligned data of a segment to the bounce buffer
+ *
+ * Write data is copied there now, and read data is copied out of it by
+ * gb_spi_segment_done().
+ *
+ * @param spi SPI bundle data, locked
+ * @param xfer the transfer
+ * @param last the last transfer descriptor of the segment
+ * @return 0 on success, negative errno on failure
+ */
+static int gb_spi_segment_bounce(struct gb_spi_bundle *spi,
+	struct gb_spi_xfer *xfer, int last)
+{
+    struct spi_buf *tx_buf = xfer->bufs;
+    struct spi_buf *rx_buf = &xfer->bufs[xfer->op_count];
+    size_t size = 0;
+    uint8_t *bounce;
+    int i;
+
+    for (i = xfer->first; i <= last; ++i) {
+        if (tx_buf[i].buf != NULL && !gb_spi_buf_aligned(&tx_buf[i])) {
+            size += ROUND_UP(tx_buf[i].len, GB_SPI_DMA_ALIGN);
+        }
+        if (rx_buf[i].buf != NULL && !gb_spi_buf_aligned(&rx_buf[i])) {
+            size += ROUND_UP(rx_buf[i].len, GB_SPI_DMA_ALIGN);
+        }
     }
 
-    for (i = 0; i < op_count; ++i) {
-        desc = &request->transfers[i];
+    if (size == 0) {
+        return 0;
+    }
 
-        /* setup SPI transfer */
-        switch(desc->rdwr) {
-        case GB_SPI_XFER_WRITE:
-			tx_buf[i].buf = write_data;
-			tx_buf[i].len = sys_le32_to_cpu(desc->len);
-			write_data += tx_buf[i].len;
-			++tx_buf_set->count;
-			rx_buf[i].buf = NULL;
-			rx_buf[i].len = 0;
-			break;
-        case GB_SPI_XFER_READ:
-			tx_buf[i].buf = NULL;
-			tx_buf[i].len = 0;
-			rx_buf[i].buf = read_data;
-			rx_buf[i].len = sys_le32_to_cpu(desc->len);
-			read_data += rx_buf[i].len;
-			++rx_buf_set->count;
-			break;
-        case GB_SPI_XFER_WRITE | GB_SPI_XFER_READ:
-			tx_buf[i].buf = write_data;
-			tx_buf[i].len = sys_le32_to_cpu(desc->len);
-			write_data += tx_buf[i].len;
-			++tx_buf_set->count;
-			rx_buf[i].buf = read_data;
-			rx_buf[i].len = sys_le32_to_cpu(desc->len);
-			read_data += rx_buf[i].len;
-			++rx_buf_set->count;
-			break;
-        default:
-			LOG_ERR("invalid flags in rdwr %x", desc->rdwr);
-			errcode = GB_OP_INVALID;
-			goto freebufs;
-		}
+    bounce = gb_spi_bounce_get(spi, size);
+    if (bounce == NULL) {
+        return -ENOMEM;
+    }
+
+    for (i = xfer->first; i <= last; ++i) {
+        if (tx_buf[i].buf != NULL && !gb_spi_buf_aligned(&tx_buf[i])) {
+            memcpy(bounce, tx_buf[i].buf, tx_buf[i].len);
+            tx_buf[i].buf = bounce;
+            bounce += ROUND_UP(tx_buf[i].len, GB_SPI_DMA_ALIGN);
+        }
+        if (rx_buf[i].buf != NULL && !gb_spi_buf_aligned(&rx_buf[i])) {
+            rx_buf[i].buf = bounce;
+            bounce += ROUND_UP(rx_buf[i].len, GB_SPI_DMA_ALIGN);
+        }
     }
 
+    return 0;
+}
+
+/* copy read data that went to the bounce buffer to the response */
+static void gb_spi_segment_unbounce(struct gb_spi_xfer *xfer)
+{
+    const struct spi_buf *rx_buf = xfer->rx.buffers;
+    uint8_t *read_data = xfer->segment_read_data;
+    size_t i;
+
+    for (i = 0; i < xfer->rx.count; ++i) {
+        if (rx_buf[i].buf == NULL) {
+            continue;
+        }
+
+        if (rx_buf[i].buf != read_data) {
+            memcpy(read_data, rx_buf[i].buf, rx_buf[i].len);
+        }
+        read_data += rx_buf[i].len;
+    }
+}
+#endif
+
+/**
+ * @brief Set up the next segment of a transfer
+ *
+ * Write data is sent straight from the request, and read data lands
+ * straight in the response payload. With CONFIG_GREYBUS_SPI_DMA_ALIGN,
+ * data that is not aligned to it goes through a bounce buffer instead.
+ *
+ * @param spi SPI bundle data, locked
+ * @param xfer the transfer
+ * @return 1 if a segment is ready, 0 if the transfer is complete, or
+ *         negative errno on failure
+ */
+static int gb_spi_segment_prepare(struct gb_spi_bundle *spi,
+	struct gb_spi_xfer *xfer)
+{
+    const struct gb_spi_transfer_desc *desc;
+    const struct gb_spi_transfer_desc *next;
+    struct spi_buf *tx_buf = xfer->bufs;
+    struct spi_buf *rx_buf = &xfer->bufs[xfer->op_count];
+    int ret;
+    int i;
+
+    if (xfer->first >= xfer->op_count) {
+        return 0;
+    }
+
+    xfer->has_tx = false;
+    xfer->has_rx = false;
+#if GB_SPI_DMA_ALIGN > 1
+    xfer->segment_read_data = xfer->read_data;
+#endif
+
+    for (i = xfer->first;; ++i) {
+        desc = &xfer->request->transfers[i];
+        next = (i + 1 < xfer->op_count) ? &xfer->request->transfers[i + 1]
+            : NULL;
+
+        /*
+         * Both directions clock every descriptor of a segment. Writes
+         * discard what they receive, and reads send zeros.
+         */
+        tx_buf[i].buf = NULL;
+        tx_buf[i].len = sys_le32_to_cpu(desc->len);
+        rx_buf[i].buf = NULL;
+        rx_buf[i].len = sys_le32_to_cpu(desc->len);
+
+        if (desc->rdwr & GB_SPI_XFER_WRITE) {
+            /* write buffers are only read by the driver */
+            tx_buf[i].buf = (uint8_t *)xfer->write_data;
+            xfer->write_data += tx_buf[i].len;
+            xfer->has_tx = true;
+        }
+
+        if (desc->rdwr & GB_SPI_XFER_READ) {
+            rx_buf[i].buf = xfer->read_data;
+            xfer->read_data += rx_buf[i].len;
+            xfer->has_rx = true;
+        }
+
+        if (gb_spi_segment_end(desc, next)) {
+            break;
+        }
+    }
+
+#if GB_SPI_DMA_ALIGN > 1
+    ret = gb_spi_segment_bounce(spi, xfer, i);
+    if (ret) {
+        return ret;
+    }
+#endif
+
     /* set SPI configuration */
-    ret = request_to_spi_config(request, sys_le32_to_cpu(request->transfers[0].speed_hz),
-		bits_per_word, bundle->dev, &spi_config, &spi_cs_control);
+    ret = gb_spi_config_get(spi, xfer->request, desc, &xfer->config);
     if (ret) {
-		errcode = gb_errno_to_op_result(-ret);
-		goto freebufs;
+        return ret;
+    }
+
+    /*
+     * Chip select stays asserted into the next segment unless the
+     * host asked for it to change. The bus is not locked in between,
+     * as Zephyr ties the lock to a single spi_config.
+     */
+    if (next != NULL && !desc->cs_change) {
+        xfer->config->operation |= SPI_HOLD_ON_CS;
+    } else {
+        xfer->config->operation &= ~SPI_HOLD_ON_CS;
+    }
+
+    xfer->tx.buffers = &tx_buf[xfer->first];
+    xfer->tx.count = i + 1 - xfer->first;
+    xfer->rx.buffers = &rx_buf[xfer->first];
+    xfer->rx.count = i + 1 - xfer->first;
+
+    xfer->first = i + 1;
+
+    return 1;
+}
+
+/**
+ * @brief Account for a segment that the controller is done with
+ *
+ * @param spi SPI bundle data, locked
+ * @param xfer the transfer
+ * @param ret the result of the segment
+ */
+static void gb_spi_segment_done(struct gb_spi_bundle *spi,
+	struct gb_spi_xfer *xfer, int ret)
+{
+    spi->last = xfer->config;
+    if (ret) {
+        return;
+    }
+
+#if GB_SPI_DMA_ALIGN > 1
+    gb_spi_segment_unbounce(xfer);
+#endif
+
+    xfer->held = (xfer->config->operation & SPI_HOLD_ON_CS) ? xfer->config
+        : NULL;
+}
+
+/* the delay in microseconds after the segment that was just done */
+static uint16_t gb_spi_segment_delay(const struct gb_spi_xfer *xfer)
+{
+    return sys_le16_to_cpu(xfer->request->transfers[xfer->first - 1].delay_usecs);
+}
+
+static void gb_spi_xfer_finish(struct gb_spi_bundle *spi,
+	struct gb_spi_xfer *xfer, int ret)
+{
+    struct spi_config *config = xfer->config;
+
+    /* do not leave chip select asserted after a failed segment */
+    if (ret && xfer->held != NULL) {
+        spi_release(spi->dev, xfer->held);
+    } else if (ret && config != NULL && (config->operation & SPI_HOLD_ON_CS)) {
+        spi_release(spi->dev, config);
+    }
+}
+
+/**
+ * @brief Get the bundle's buffer descriptors, for a transfer of @p op_count
+ *
+ * @param spi SPI bundle data, locked
+ * @param op_count number of transfer descriptors
+ * @return two spi_buf per transfer descriptor, or NULL
+ */
+static struct spi_buf *gb_spi_bufs_get(struct gb_spi_bundle *spi,
+	size_t op_count)
+{
+    struct spi_buf *bufs;
+
+    /* grown to the largest transfer seen, and kept for the next ones */
+    if (op_count > spi->num_bufs) {
+        bufs = realloc(spi->bufs, op_count * 2 * sizeof(*bufs));
+        if (bufs == NULL) {
+            LOG_ERR("Failed to allocate buffer descriptors");
+            return NULL;
+        }
+
+        spi->bufs = bufs;
+        spi->num_bufs = op_count;
+    }
+
+    return spi->bufs;
+}
+
+static void gb_spi_bus_lock(struct gb_spi_bundle *spi)
+{
+    k_sem_take(&spi->bus, K_FOREVER);
+}
+
+#ifdef CONFIG_GREYBUS_SPI_ASYNC
+/*
+ * Periodic samples wait for the bus on the SPI work queue. Completions,
+ * which hand the bus over and never wait for it, are handled on the
+ * system work queue, so a sample cannot hold up the transfer it waits for.
+ */
+static struct k_work_q gb_spi_queue;
+K_THREAD_STACK_DEFINE(gb_spi_stack, CONFIG_GREYBUS_SPI_ASYNC_STACK_SIZE);
+
+static void gb_spi_async_run(struct gb_spi_bundle *spi,
+	struct gb_operation *operation);
+
+/* the next transfer waiting for the bus, or NULL once the bus is free */
+static struct gb_operation *gb_spi_bus_next(struct gb_spi_bundle *spi)
+{
+    struct gb_operation *operation = NULL;
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&spi->pending_lock);
+    if (list_is_empty(&spi->pending)) {
+        k_sem_give(&spi->bus);
+    } else {
+        operation = list_entry(spi->pending.next, struct gb_operation, list);
+        list_del(&operation->list);
+    }
+    k_spin_unlock(&spi->pending_lock, key);
+
+    return operation;
+}
+
+static void gb_spi_bus_unlock(struct gb_spi_bundle *spi)
+{
+    /* pending transfers take the bus over, rather than it being freed */
+    gb_spi_async_run(spi, gb_spi_bus_next(spi));
+}
+#else
+static void gb_spi_bus_unlock(struct gb_spi_bundle *spi)
+{
+    k_sem_give(&spi->bus);
+}
+#endif
+
+/**
+ * @brief Run an already checked transfer request
+ *
+ * @param spi SPI bundle data
+ * @param request the transfer request
+ * @param read_data where read data is stored
+ * @param bufs room for two spi_buf per transfer descriptor, or NULL to
+ *        use those of the bundle
+ * @return 0 on success, negative errno on failure
+ */
+static int gb_spi_transfer_run(struct gb_spi_bundle *spi,
+	const struct gb_spi_transfer_request *request, uint8_t *read_data,
+	struct spi_buf *bufs)
+{
+    struct gb_spi_xfer xfer;
+    int ret;
+
+    gb_spi_bus_lock(spi);
+
+    if (bufs == NULL) {
+        bufs = gb_spi_bufs_get(spi, sys_le16_to_cpu(request->count));
+        if (bufs == NULL) {
+            ret = -ENOMEM;
+            goto unlock;
+        }
+    }
+
+    gb_spi_xfer_init(&xfer, request, read_data, bufs);
+
+    while ((ret = gb_spi_segment_prepare(spi, &xfer)) > 0) {
+        /* start SPI transfer */
+        ret = spi_transceive(spi->dev, xfer.config,
+            xfer.has_tx ? &xfer.tx : NULL, xfer.has_rx ? &xfer.rx : NULL);
+        gb_spi_segment_done(spi, &xfer, ret);
+        if (ret) {
+            break;
+        }
+
+        if (gb_spi_segment_delay(&xfer) != 0) {
+            k_busy_wait(gb_spi_segment_delay(&xfer));
+        }
     }
 
-    /* start SPI transfer */
-    ret = spi_transceive(bundle->dev, &spi_config, tx_buf_set, rx_buf_set);
+    gb_spi_xfer_finish(spi, &xfer, ret);
+
+unlock:
+    gb_spi_bus_unlock(spi);
+
+    return ret;
+}
+
+#ifdef CONFIG_GREYBUS_SPI_ASYNC
+/**
+ * @brief Start the next segment of the transfer that owns the bus
+ *
+ * @param spi SPI bundle data, locked
+ * @return -EINPROGRESS while a segment is in flight, otherwise the result
+ *         of the transfer
+ */
+static int gb_spi_async_segment(struct gb_spi_bundle *spi)
+{
+    struct gb_spi_xfer *xfer = &spi->xfer;
+    int ret;
+
+    ret = gb_spi_segment_prepare(spi, xfer);
+    if (ret <= 0) {
+        return ret;
+    }
+
+    k_poll_signal_reset(&spi->signal);
+    spi->event.state = K_POLL_STATE_NOT_READY;
+
+    ret = spi_transceive_async(spi->dev, xfer->config,
+        xfer->has_tx ? &xfer->tx : NULL, xfer->has_rx ? &xfer->rx : NULL,
+        &spi->signal);
     if (ret) {
-		errcode = gb_errno_to_op_result(-ret);
-		goto freebufs;
+        gb_spi_segment_done(spi, xfer, ret);
+        return ret;
+    }
+
+    ret = k_work_poll_submit(&spi->poll, &spi->event, 1, K_FOREVER);
+    __ASSERT_NO_MSG(ret == 0);
+
+    return -EINPROGRESS;
+}
+
+static int gb_spi_async_start(struct gb_spi_bundle *spi,
+	struct gb_operation *operation)
+{
+    struct gb_spi_transfer_request *request =
+        gb_operation_get_request_payload(operation);
+    struct gb_spi_transfer_response *response =
+        gb_operation_get_response_payload(operation);
+
+    spi->operation = operation;
+    gb_spi_xfer_init(&spi->xfer, request, response->data, NULL);
+
+    spi->xfer.bufs = gb_spi_bufs_get(spi, spi->xfer.op_count);
+    if (spi->xfer.bufs == NULL) {
+        return -ENOMEM;
+    }
+
+    return gb_spi_async_segment(spi);
+}
+
+/**
+ * @brief Respond to the transfer that owns the bus
+ *
+ * @param spi SPI bundle data, locked
+ * @param ret the result of the transfer
+ * @return the next transfer, which the bus is handed to, or NULL
+ */
+static struct gb_operation *gb_spi_async_complete(struct gb_spi_bundle *spi,
+	int ret)
+{
+    struct gb_operation *operation = spi->operation;
+
+    gb_spi_xfer_finish(spi, &spi->xfer, ret);
+
+    spi->operation = NULL;
+    gb_operation_send_deferred_response(operation,
+        gb_errno_to_op_result(ret));
+
+    return gb_spi_bus_next(spi);
+}
+
+/**
+ * @brief Run transfers on the bus until none is left, or one is in flight
+ *
+ * @param spi SPI bundle data, locked unless @p operation is NULL
+ * @param operation the transfer to start with
+ */
+static void gb_spi_async_run(struct gb_spi_bundle *spi,
+	struct gb_operation *operation)
+{
+    int ret;
+
+    while (operation != NULL) {
+        ret = gb_spi_async_start(spi, operation);
+        if (ret == -EINPROGRESS) {
+            break;
+        }
+
+        operation = gb_spi_async_complete(spi, ret);
+    }
+}
+
+/* start the next segment, or respond if there is none or @p ret is set */
+static void gb_spi_async_next(struct gb_spi_bundle *spi, int ret)
+{
+    if (ret == 0) {
+        ret = gb_spi_async_segment(spi);
+        if (ret == -EINPROGRESS) {
+            return;
+        }
+    }
+
+    gb_spi_async_run(spi, gb_spi_async_complete(spi, ret));
+}
+
+/* runs on the system work queue once a segment is complete */
+static void gb_spi_async_work(struct k_work *work)
+{
+    struct gb_spi_bundle *spi =
+        CONTAINER_OF(work, struct gb_spi_bundle, poll.work);
+    unsigned int signaled;
+    int ret;
+
+    k_poll_signal_check(&spi->signal, &signaled, &ret);
+    __ASSERT_NO_MSG(signaled);
+
+    gb_spi_segment_done(spi, &spi->xfer, ret);
+    if (ret == 0 && gb_spi_segment_delay(&spi->xfer) != 0) {
+        /* rather than busy waiting on the system work queue */
+        k_delayed_work_submit(&spi->delay,
+            K_USEC(gb_spi_segment_delay(&spi->xfer)));
+        return;
+    }
+
+    gb_spi_async_next(spi, ret);
+}
+
+/* runs on the system work queue once the delay after a segment is over */
+static void gb_spi_async_delay_work(struct k_work *work)
+{
+    struct gb_spi_bundle *spi =
+        CONTAINER_OF(work, struct gb_spi_bundle, delay.work);
+
+    gb_spi_async_next(spi, 0);
+}
+#endif
+
+/**
+ * @brief Performs a SPI transaction as one or more SPI transfers, defined
+ *        in the supplied array.
+ *
+ * @param operation pointer to structure of Greybus operation message
+ * @return GB_OP_SUCCESS on success, error code on failure
+ */
+static uint8_t gb_spi_protocol_transfer(struct gb_operation *operation)
+{
+    struct gb_spi_transfer_request *request;
+    struct gb_spi_transfer_response *response;
+    size_t read_data_size;
+    int ret;
+
+    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+    __ASSERT_NO_MSG(bundle != NULL);
+    struct gb_spi_bundle *spi = bundle->priv;
+
+    request = gb_operation_get_request_payload(operation);
+    ret = gb_spi_transfer_check(request,
+        gb_operation_get_request_payload_size(operation), &read_data_size);
+    if (ret < 0) {
+        return GB_OP_INVALID;
+    }
+
+    if (request->count == 0) {
+		return GB_OP_SUCCESS;
+    }
+
+    response = gb_operation_alloc_response(operation, read_data_size);
+    if (!response) {
+		return GB_OP_NO_MEMORY;
+    }
+
+#ifdef CONFIG_GREYBUS_SPI_ASYNC
+    /*
+     * Respond once the controller is done, so that the cport can take
+     * the next request meanwhile. Requests that find the bus busy wait
+     * in line, and are started from the completion of the one before.
+     */
+    if (spi->async) {
+        k_spinlock_key_t key;
+        bool owner;
+
+        gb_operation_defer_response(operation);
+
+        key = k_spin_lock(&spi->pending_lock);
+        owner = k_sem_take(&spi->bus, K_NO_WAIT) == 0;
+        if (!owner) {
+            list_add(&spi->pending, &operation->list);
+        }
+        k_spin_unlock(&spi->pending_lock, key);
+
+        if (owner) {
+            gb_spi_async_run(spi, operation);
+        }
+
+        return GB_OP_SUCCESS;
     }
+#endif
 
-    errcode = GB_OP_SUCCESS;
+    ret = gb_spi_transfer_run(spi, request, response->data, NULL);
 
-freebufs:
-	free(tx_buf);
+    return gb_errno_to_op_result(ret);
+}
+
+#ifdef CONFIG_GREYBUS_PERIODIC
+/* a copy of the transfer request, with buffer descriptors of its own */
+struct gb_spi_periodic {
+    struct gb_spi_bundle *spi;
+    struct spi_buf *bufs;
+    struct gb_spi_transfer_request *request;
+};
 
-out:
-    return errcode;
+static int gb_spi_periodic_sample(void *script, uint8_t *data)
+{
+    struct gb_spi_periodic *periodic = script;
+
+    return gb_spi_transfer_run(periodic->spi, periodic->request, data,
+        periodic->bufs);
 }
 
+/**
+ * @brief Repeat a SPI transaction on the device, and report changed samples
+ *
+ * @param operation pointer to structure of Greybus operation message
+ * @return GB_OP_SUCCESS on success, error code on failure
+ */
+static uint8_t gb_spi_protocol_periodic_start(struct gb_operation *operation)
+{
+    struct gb_periodic_start_request *request;
+    struct gb_periodic_start_response *response;
+    struct gb_spi_transfer_request *transfer;
+    struct gb_spi_periodic *periodic;
+    size_t request_size;
+    size_t read_data_size;
+    size_t len;
+    struct k_work_q *queue = NULL;
+    int op_count;
+    int ret;
+
+    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+    __ASSERT_NO_MSG(bundle != NULL);
+
+    request_size = gb_operation_get_request_payload_size(operation);
+    if (request_size < sizeof(*request)) {
+        LOG_ERR("dropping short message");
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    transfer = (struct gb_spi_transfer_request *)&request[1];
+    request_size -= sizeof(*request);
+
+    ret = gb_spi_transfer_check(transfer, request_size, &read_data_size);
+    /* the transfer is followed by its compare mask */
+    if (ret < 0 || read_data_size == 0 ||
+        request_size - ret < read_data_size) {
+        return GB_OP_INVALID;
+    }
+    len = ret;
+    op_count = sys_le16_to_cpu(transfer->count);
+
+    response = gb_operation_alloc_response(operation, sizeof(*response));
+    if (!response) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    periodic = malloc(sizeof(*periodic) +
+        op_count * 2 * sizeof(periodic->bufs[0]) + len);
+    if (periodic == NULL) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    periodic->spi = bundle->priv;
+    periodic->bufs = (struct spi_buf *)&periodic[1];
+    periodic->request =
+        (struct gb_spi_transfer_request *)&periodic->bufs[op_count * 2];
+    memcpy(periodic->request, transfer, len);
+
+#ifdef CONFIG_GREYBUS_SPI_ASYNC
+    /* samples wait for the bus there, rather than on the system work queue */
+    queue = &gb_spi_queue;
+#endif
+
+    ret = gb_periodic_start(operation->cport, GB_SPI_PROTOCOL_PERIODIC_DATA,
+        queue, gb_spi_periodic_sample, periodic, read_data_size,
+        (uint8_t *)transfer + len, sys_le16_to_cpu(request->batch),
+        sys_le32_to_cpu(request->period_us));
+    if (ret < 0) {
+        free(periodic);
+        return gb_errno_to_op_result(ret);
+    }
+
+    response->id = ret;
+
+    return GB_OP_SUCCESS;
+}
+
+/**
+ * @brief Stop a periodic SPI transaction
+ *
+ * @param operation pointer to structure of Greybus operation message
+ * @return GB_OP_SUCCESS on success, error code on failure
+ */
+static uint8_t gb_spi_protocol_periodic_stop(struct gb_operation *operation)
+{
+    struct gb_periodic_stop_request *request =
+        gb_operation_get_request_payload(operation);
+
+    if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        LOG_ERR("dropping short message");
+        return GB_OP_INVALID;
+    }
+
+    return gb_errno_to_op_result(gb_periodic_stop(operation->cport,
+        request->id));
+}
+#endif
+
 /**
  * @brief Greybus SPI protocol initialize function
  *
@@ -439,10 +1193,70 @@ out:
  */
 static int gb_spi_init(unsigned int cport, struct gb_bundle *bundle)
 {
+    const struct gb_platform_spi_api *api;
+    const struct device *gb_spidev;
+    struct gb_spi_bundle *spi;
+    int num_cs;
+
     bundle->dev = (struct device *)gb_cport_to_device(cport);
     if (!bundle->dev) {
         return -EIO;
     }
+
+    /* resolved once, rather than for every transfer */
+    gb_spidev = gb_spidev_from_zephyr_spidev(bundle->dev);
+    if (gb_spidev == NULL) {
+        return -ENODEV;
+    }
+
+    api = gb_spidev->api;
+    __ASSERT_NO_MSG(api != NULL);
+
+    num_cs = api->num_peripherals(gb_spidev);
+    if (num_cs < 0) {
+        return num_cs;
+    }
+
+    spi = calloc(1, sizeof(*spi) + num_cs * sizeof(spi->cs[0]));
+    if (spi == NULL) {
+        return -ENOMEM;
+    }
+
+    spi->dev = bundle->dev;
+    spi->gb_spidev = gb_spidev;
+    spi->num_cs = num_cs;
+    k_sem_init(&spi->bus, 1, 1);
+
+#ifdef CONFIG_GREYBUS_SPI_ASYNC
+    static bool queue_started;
+
+    if (!queue_started) {
+        k_work_q_start(&gb_spi_queue, gb_spi_stack,
+            K_THREAD_STACK_SIZEOF(gb_spi_stack),
+            CONFIG_GREYBUS_SPI_ASYNC_PRIORITY);
+        k_thread_name_set(&gb_spi_queue.thread, "greybus_spi");
+        queue_started = true;
+    }
+
+    /*
+     * SPI_ASYNC does not make every controller asynchronous. Transfers
+     * on the others are run synchronously, by the cport, as without
+     * GREYBUS_SPI_ASYNC, so that the system work queue never waits for
+     * the bus.
+     */
+    spi->async = ((const struct spi_driver_api *)spi->dev->api)
+        ->transceive_async != NULL;
+
+    list_init(&spi->pending);
+    k_poll_signal_init(&spi->signal);
+    k_poll_event_init(&spi->event, K_POLL_TYPE_SIGNAL,
+        K_POLL_MODE_NOTIFY_ONLY, &spi->signal);
+    k_work_poll_init(&spi->poll, gb_spi_async_work);
+    k_delayed_work_init(&spi->delay, gb_spi_async_delay_work);
+#endif
+
+    bundle->priv = spi;
+
     return 0;
 }
 
@@ -454,6 +1268,21 @@ static int gb_spi_init(unsigned int cport, struct gb_bundle *bundle)
  */
 static void gb_spi_exit(unsigned int cport, struct gb_bundle *bundle)
 {
+    struct gb_spi_bundle *spi = bundle->priv;
+
+#ifdef CONFIG_GREYBUS_PERIODIC
+    gb_periodic_stop(cport, -1);
+#endif
+
+    /* wait for the transfers that were already accepted */
+    gb_spi_bus_lock(spi);
+
+    free(spi->bufs);
+#if GB_SPI_DMA_ALIGN > 1
+    free(spi->bounce_mem);
+#endif
+    free(spi);
+    bundle->priv = NULL;
 }
 
 /**
@@ -464,6 +1293,10 @@ static struct gb_operation_handler gb_spi_handlers[] = {
     GB_HANDLER(GB_SPI_TYPE_MASTER_CONFIG, gb_spi_protocol_master_config),
     GB_HANDLER(GB_SPI_TYPE_DEVICE_CONFIG, gb_spi_protocol_device_config),
     GB_HANDLER(GB_SPI_PROTOCOL_TRANSFER, gb_spi_protocol_transfer),
+#ifdef CONFIG_GREYBUS_PERIODIC
+    GB_HANDLER(GB_SPI_PROTOCOL_PERIODIC_START, gb_spi_protocol_periodic_start),
+    GB_HANDLER(GB_SPI_PROTOCOL_PERIODIC_STOP, gb_spi_protocol_periodic_stop),
+#endif
 };
 
 static struct gb_driver gb_spi_driver = {
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <greybus/greybus.h>
+#include <string.h>
+#include <ztest.h>
+
+#include "../../../../subsys/greybus/platform/lz4.h"
+
+/* worst case LZ4 expansion of incompressible input */
+#define LZ4_BOUND(len) ((len) + (len) / 255 + 16)
+
+static uint16_t hash_table[GB_LZ4_HASH_SIZE];
+static uint8_t src[GB_MTU];
+static uint8_t zbuf[LZ4_BOUND(GB_MTU)];
+static uint8_t dst[GB_MTU];
+
+/* a simple generator, so that incompressible data is reproducible */
+static uint32_t prng_state;
+
+static uint8_t prng(void)
+{
+	prng_state = prng_state * 1103515245 + 12345;
+	return prng_state >> 16;
+}
+
+static void fill_text(size_t len)
+{
+	static const char words[] = "greybus cport operation response ";
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		src[i] = words[i % (sizeof(words) - 1)];
+	}
+}
+
+static void fill_random(size_t len)
+{
+	size_t i;
+
+	prng_state = len;
+	for (i = 0; i < len; ++i) {
+		src[i] = prng();
+	}
+}
+
+static size_t roundtrip(size_t len)
+{
+	size_t zlen;
+	int r;
+
+	zlen = gb_lz4_compress(src, len, zbuf, sizeof(zbuf), hash_table);
+	zassert_not_equal(zlen, 0, "len %zu: compression failed", len);
+
+	memset(dst, 0xee, sizeof(dst));
+	r = gb_lz4_decompress(zbuf, zlen, dst, len);
+	zassert_equal(r, len, "len %zu: decompressed %d bytes", len, r);
+	zassert_mem_equal(dst, src, len, "len %zu: data mismatch", len);
+
+	return zlen;
+}
+
+void test_greybus_lz4_roundtrip(void)
+{
+	/* around the minimum match and last literal limits, up to GB_MTU */
+	static const size_t lens[] = {
+		0, 1, 4, 12, 13, 14, 17, 64, 255, 270, 1000, GB_MTU,
+	};
+	size_t zlen;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(lens); ++i) {
+		fill_text(lens[i]);
+		zlen = roundtrip(lens[i]);
+		if (lens[i] >= 255) {
+			zassert_true(zlen < lens[i] / 2,
+				"len %zu: text only compressed to %zu", lens[i], zlen);
+		}
+
+		fill_random(lens[i]);
+		roundtrip(lens[i]);
+
+		memset(src, 0, lens[i]);
+		roundtrip(lens[i]);
+	}
+}
+
+void test_greybus_lz4_reference(void)
+{
+	/*
+	 * 20 times 'a', as produced by the reference implementation: one
+	 * literal, a 14 byte match at offset 1, and 5 last literals.
+	 */
+	static const uint8_t block[] = {
+		0x1a, 'a', 0x01, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a',
+	};
+	int r;
+
+	memset(src, 'a', 20);
+
+	r = gb_lz4_decompress(block, sizeof(block), dst, sizeof(dst));
+	zassert_equal(r, 20, "decompressed %d bytes", r);
+	zassert_mem_equal(dst, src, 20, "data mismatch");
+}
+
+void test_greybus_lz4_incompressible(void)
+{
+	size_t zlen;
+
+	fill_random(256);
+
+	/* callers only want output that is strictly smaller */
+	zlen = gb_lz4_compress(src, 256, zbuf, 255, hash_table);
+	zassert_equal(zlen, 0, "random data compressed to %zu", zlen);
+}
+
+void test_greybus_lz4_malformed(void)
+{
+	/* literal length runs past the input */
+	static const uint8_t truncated_literals[] = { 0x50, 'a', 'b' };
+	/* an extended length byte is missing */
+	static const uint8_t truncated_length[] = { 0xf0 };
+	/* a match without a complete offset */
+	static const uint8_t truncated_offset[] = { 0x10, 'a', 0x01 };
+	/* offset 0 is invalid */
+	static const uint8_t zero_offset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+	/* the match starts before the output */
+	static const uint8_t far_offset[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+	static const struct {
+		const uint8_t *block;
+		size_t len;
+	} cases[] = {
+		{ truncated_literals, sizeof(truncated_literals) },
+		{ truncated_length, sizeof(truncated_length) },
+		{ truncated_offset, sizeof(truncated_offset) },
+		{ zero_offset, sizeof(zero_offset) },
+		{ far_offset, sizeof(far_offset) },
+	};
+	static const uint8_t block[] = {
+		0x1a, 'a', 0x01, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a',
+	};
+	size_t i;
+	int r;
+
+	for (i = 0; i < ARRAY_SIZE(cases); ++i) {
+		r = gb_lz4_decompress(cases[i].block, cases[i].len, dst,
+			sizeof(dst));
+		zassert_equal(r, -EINVAL, "case %zu: %d", i, r);
+	}
+
+	/* a valid block must not overrun a short output buffer */
+	r = gb_lz4_decompress(block, sizeof(block), dst, 19);
+	zassert_equal(r, -EINVAL, "short output: %d", r);
+	r = gb_lz4_decompress(block, sizeof(block), dst, 10);
+	zassert_equal(r, -EINVAL, "short output: %d", r);
+}
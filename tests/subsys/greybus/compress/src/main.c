@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <ztest.h>
+
+extern void test_greybus_lz4_roundtrip(void);
+extern void test_greybus_lz4_reference(void);
+extern void test_greybus_lz4_incompressible(void);
+extern void test_greybus_lz4_malformed(void);
+
+void test_main(void) {
+
+    ztest_test_suite(greybus_compress,
+        ztest_unit_test(test_greybus_lz4_roundtrip),
+        ztest_unit_test(test_greybus_lz4_reference),
+        ztest_unit_test(test_greybus_lz4_incompressible),
+        ztest_unit_test(test_greybus_lz4_malformed)
+        );
+    ztest_run_test_suite(greybus_compress);
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <greybus/greybus.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <ztest.h>
+
+#include "../../../../subsys/greybus/fragment.h"
+
+/* large enough for three fragments, but not four */
+#define MSG_MAX (3 * GB_FRAGMENT_CHUNK_SIZE + sizeof(struct gb_operation_hdr))
+#define NFRAGS 4
+#define NBUFS 2
+
+#define MSG_ID 0x1234
+#define MSG_TYPE 0x42
+
+K_MEM_SLAB_DEFINE(test_slab, MSG_MAX, NBUFS, 4);
+
+static uint8_t msg_buf[MSG_MAX] __aligned(4);
+static uint8_t frags[NFRAGS][GB_MTU] __aligned(4);
+static size_t nfrags;
+
+static struct gb_reassembly ra = {
+	.slab = &test_slab,
+	.max_size = MSG_MAX,
+};
+
+static struct gb_operation_hdr *frag_hdr(size_t i)
+{
+	return (struct gb_operation_hdr *)frags[i];
+}
+
+static struct gb_fragment_hdr *frag_of(size_t i)
+{
+	return (struct gb_fragment_hdr *)(frag_hdr(i) + 1);
+}
+
+/* build a message of @p len bytes and split it into fragments */
+static void split(size_t len)
+{
+	struct gb_operation_hdr *msg = (struct gb_operation_hdr *)msg_buf;
+	uint8_t *payload = (uint8_t *)(msg + 1);
+	size_t payload_size = len - sizeof(*msg);
+	size_t offset;
+	size_t i;
+
+	memset(msg, 0, sizeof(*msg));
+	msg->size = sys_cpu_to_le16(len);
+	msg->id = sys_cpu_to_le16(MSG_ID);
+	msg->type = MSG_TYPE;
+	for (i = 0; i < payload_size; ++i) {
+		payload[i] = i * 7 + i / 251;
+	}
+
+	nfrags = 0;
+	for (offset = 0; offset < payload_size;) {
+		zassert_true(nfrags < NFRAGS, "too many fragments");
+		offset += gb_fragment_build(msg, offset, frag_hdr(nfrags++));
+	}
+}
+
+static int feed(size_t i, struct gb_operation_hdr **out)
+{
+	return gb_reassembly_add(&ra, frag_hdr(i),
+		sys_le16_to_cpu(frag_hdr(i)->size), out);
+}
+
+/* feed all fragments in order, and check the reassembled message */
+static void reassemble(void)
+{
+	struct gb_operation_hdr *out = NULL;
+	size_t len = sys_le16_to_cpu(((struct gb_operation_hdr *)msg_buf)->size);
+	size_t i;
+	int r;
+
+	for (i = 0; i < nfrags; ++i) {
+		r = feed(i, &out);
+		zassert_equal(r, i + 1 < nfrags ? -EAGAIN : 0,
+			"fragment %zu: unexpected result %d", i, r);
+	}
+
+	zassert_not_null(out, "no message");
+	zassert_equal(0, memcmp(out, msg_buf, len), "message differs");
+	zassert_is_null(ra.buf, "buffer still held");
+
+	k_mem_slab_free(&test_slab, (void **)&out);
+}
+
+static void check_idle(void)
+{
+	zassert_is_null(ra.buf, "buffer still held");
+	zassert_equal(NBUFS, k_mem_slab_num_free_get(&test_slab),
+		"reassembly buffer leaked");
+}
+
+void test_greybus_fragment_roundtrip(void)
+{
+	size_t len;
+	size_t i;
+
+	for (len = GB_MTU + 1; len <= MSG_MAX; len += 1021) {
+		split(len);
+		zassert_equal(nfrags, DIV_ROUND_UP(len - sizeof(struct gb_operation_hdr),
+			GB_FRAGMENT_CHUNK_SIZE), "len %zu: %zu fragments", len, nfrags);
+
+		for (i = 0; i < nfrags; ++i) {
+			zassert_true(sys_le16_to_cpu(frag_hdr(i)->size) <= GB_MTU,
+				"fragment %zu larger than GB_MTU", i);
+			zassert_equal(frag_hdr(i)->type, GB_TYPE_FRAGMENT, "");
+			zassert_equal(frag_hdr(i)->id, sys_cpu_to_le16(MSG_ID), "");
+			zassert_equal(!!(frag_of(i)->flags & GB_FRAGMENT_FLAG_LAST),
+				i + 1 == nfrags, "fragment %zu: bad LAST flag", i);
+		}
+
+		reassemble();
+		check_idle();
+	}
+
+	split(MSG_MAX);
+	reassemble();
+	check_idle();
+}
+
+void test_greybus_fragment_exact_mtu(void)
+{
+	struct gb_operation_hdr *out = NULL;
+
+	zassert_false(gb_fragment_needed(GB_MTU),
+		"GB_MTU sized messages fit in a single message");
+	zassert_true(gb_fragment_needed(GB_MTU + 1), "");
+
+	/* a single fragment carries the payload of a GB_MTU sized message */
+	split(GB_MTU + 1);
+	zassert_equal(nfrags, 2, "");
+
+	/* such a message must not arrive as fragments */
+	frag_of(0)->size = sys_cpu_to_le16(GB_MTU);
+	zassert_equal(feed(0, &out), -EMSGSIZE, "");
+	check_idle();
+}
+
+void test_greybus_fragment_out_of_order(void)
+{
+	struct gb_operation_hdr *out = NULL;
+
+	split(MSG_MAX);
+	zassert_equal(nfrags, 3, "");
+
+	/* without the first fragment, nothing is reassembled */
+	zassert_equal(feed(1, &out), -ENOENT, "");
+	zassert_equal(feed(2, &out), -ENOENT, "");
+	check_idle();
+
+	/* a skipped fragment drops the message, and the rest is ignored */
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(feed(2, &out), -EBADMSG, "");
+	check_idle();
+	zassert_equal(feed(1, &out), -ENOENT, "");
+	check_idle();
+	zassert_is_null(out, "");
+
+	/* the next message is received */
+	reassemble();
+	check_idle();
+}
+
+void test_greybus_fragment_duplicate(void)
+{
+	struct gb_operation_hdr *out = NULL;
+
+	split(MSG_MAX);
+
+	/* a repeated fragment drops the message */
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(feed(1, &out), -EAGAIN, "");
+	zassert_equal(feed(1, &out), -EBADMSG, "");
+	zassert_equal(feed(2, &out), -ENOENT, "");
+	check_idle();
+
+	/* a repeated first fragment restarts the message */
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(k_mem_slab_num_free_get(&test_slab), NBUFS - 1, "");
+	reassemble();
+	check_idle();
+
+	/* and so does a fragment of another message */
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(feed(1, &out), -EAGAIN, "");
+	frag_hdr(2)->id = sys_cpu_to_le16(MSG_ID + 1);
+	zassert_equal(feed(2, &out), -EBADMSG, "");
+	check_idle();
+	zassert_is_null(out, "");
+}
+
+void test_greybus_fragment_oversize(void)
+{
+	struct gb_operation_hdr *out = NULL;
+
+	/* a total larger than a reassembly buffer */
+	split(MSG_MAX);
+	frag_of(0)->size = sys_cpu_to_le16(MSG_MAX + 1);
+	zassert_equal(feed(0, &out), -EMSGSIZE, "");
+	zassert_equal(feed(1, &out), -ENOENT, "");
+	check_idle();
+
+	/* fragments carrying more data than the total they announce */
+	split(MSG_MAX);
+	frag_of(0)->size = sys_cpu_to_le16(GB_MTU + 1);
+	frag_of(1)->size = sys_cpu_to_le16(GB_MTU + 1);
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(feed(1, &out), -EBADMSG, "");
+	check_idle();
+
+	/* fragments of fragments */
+	split(MSG_MAX);
+	frag_of(0)->type = GB_TYPE_FRAGMENT;
+	zassert_equal(feed(0, &out), -EMSGSIZE, "");
+	check_idle();
+	zassert_is_null(out, "");
+}
+
+void test_greybus_fragment_truncated(void)
+{
+	struct gb_operation_hdr *out = NULL;
+
+	/* the last fragment arrives before all of the data */
+	split(MSG_MAX);
+	frag_of(1)->flags |= GB_FRAGMENT_FLAG_LAST;
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(feed(1, &out), -EBADMSG, "");
+	check_idle();
+
+	/* a fragment too short for its header */
+	split(MSG_MAX);
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(gb_reassembly_add(&ra, frag_hdr(1),
+		sizeof(struct gb_operation_hdr) + 1, &out), -EBADMSG, "");
+	check_idle();
+	zassert_is_null(out, "");
+}
+
+void test_greybus_fragment_abort(void)
+{
+	struct gb_operation_hdr *out = NULL;
+
+	/* the cport is torn down in the middle of a message */
+	split(MSG_MAX);
+	zassert_equal(feed(0, &out), -EAGAIN, "");
+	zassert_equal(feed(1, &out), -EAGAIN, "");
+	gb_reassembly_abort(&ra);
+	check_idle();
+
+	zassert_equal(feed(2, &out), -ENOENT, "");
+	check_idle();
+	zassert_is_null(out, "");
+
+	/* aborting an idle cport does nothing */
+	gb_reassembly_abort(&ra);
+	check_idle();
+
+	reassemble();
+	check_idle();
+}
+
+void test_greybus_fragment_no_buffer(void)
+{
+	struct gb_operation_hdr *out = NULL;
+	void *held[NBUFS];
+	size_t i;
+
+	for (i = 0; i < NBUFS; ++i) {
+		zassert_equal(0, k_mem_slab_alloc(&test_slab, &held[i], K_NO_WAIT),
+			"");
+	}
+
+	split(MSG_MAX);
+	zassert_equal(feed(0, &out), -ENOMEM, "");
+	zassert_is_null(ra.buf, "");
+	zassert_equal(feed(1, &out), -ENOENT, "");
+
+	for (i = 0; i < NBUFS; ++i) {
+		k_mem_slab_free(&test_slab, &held[i]);
+	}
+	check_idle();
+
+	reassemble();
+	check_idle();
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <ztest.h>
+
+extern void test_greybus_fragment_roundtrip(void);
+extern void test_greybus_fragment_exact_mtu(void);
+extern void test_greybus_fragment_out_of_order(void);
+extern void test_greybus_fragment_duplicate(void);
+extern void test_greybus_fragment_oversize(void);
+extern void test_greybus_fragment_truncated(void);
+extern void test_greybus_fragment_abort(void);
+extern void test_greybus_fragment_no_buffer(void);
+
+void test_main(void) {
+
+    ztest_test_suite(greybus_fragment,
+        ztest_unit_test(test_greybus_fragment_roundtrip),
+        ztest_unit_test(test_greybus_fragment_exact_mtu),
+        ztest_unit_test(test_greybus_fragment_out_of_order),
+        ztest_unit_test(test_greybus_fragment_duplicate),
+        ztest_unit_test(test_greybus_fragment_oversize),
+        ztest_unit_test(test_greybus_fragment_truncated),
+        ztest_unit_test(test_greybus_fragment_abort),
+        ztest_unit_test(test_greybus_fragment_no_buffer)
+        );
+    ztest_run_test_suite(greybus_fragment);
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <greybus/greybus.h>
+#include <string.h>
+#include <ztest.h>
+
+#include "../../../../subsys/greybus/platform/framing.h"
+
+#define MSG_MAX (GB_MTU + GB_FRAME_CRC_SIZE)
+
+static uint8_t msg[GB_MTU + 1];
+static uint8_t frame[GB_FRAME_MAX(GB_MTU + 1)];
+static uint8_t buf[MSG_MAX];
+
+static struct gb_frame_decoder dec;
+
+static void decoder_reset(void)
+{
+	memset(&dec, 0, sizeof(dec));
+	dec.buf = buf;
+	dec.size = sizeof(buf);
+}
+
+/* feed @p len bytes, and return the result for the last one */
+static int feed(const uint8_t *data, size_t len)
+{
+	size_t i;
+	int r = -EAGAIN;
+
+	for (i = 0; i < len; ++i) {
+		r = gb_frame_decode(&dec, data[i]);
+		if (i + 1 < len) {
+			zassert_equal(r, -EAGAIN, "byte %zu: unexpected result %d",
+				i, r);
+		}
+	}
+
+	return r;
+}
+
+static void fill(size_t len, unsigned int seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		/* plenty of zeros, and runs longer than a COBS block */
+		msg[i] = ((i + seed) % 7 == 0) ? 0 : (uint8_t)(i * 31 + seed);
+	}
+}
+
+static void roundtrip(size_t len)
+{
+	size_t flen;
+	size_t i;
+	int r;
+
+	flen = gb_frame_encode(msg, len, frame);
+	zassert_true(flen <= GB_FRAME_MAX(len), "len %zu: frame of %zu bytes",
+		len, flen);
+	zassert_equal(frame[flen - 1], GB_FRAME_DELIMITER, "len %zu", len);
+	for (i = 0; i < flen - 1; ++i) {
+		zassert_not_equal(frame[i], GB_FRAME_DELIMITER,
+			"len %zu: delimiter at %zu", len, i);
+	}
+
+	r = feed(frame, flen);
+	zassert_equal(r, len, "len %zu: decoded %d", len, r);
+	zassert_mem_equal(buf, msg, len, "len %zu: data mismatch", len);
+}
+
+void test_greybus_framing_roundtrip(void)
+{
+	/* around the COBS block size, with and without zeros */
+	static const size_t lens[] = {
+		1, 2, 8, 252, 253, 254, 255, 256, 508, 509, 1000,
+	};
+	size_t i;
+
+	decoder_reset();
+
+	for (i = 0; i < ARRAY_SIZE(lens); ++i) {
+		fill(lens[i], i);
+		roundtrip(lens[i]);
+
+		memset(msg, 0xa5, lens[i]);
+		roundtrip(lens[i]);
+
+		memset(msg, 0, lens[i]);
+		roundtrip(lens[i]);
+	}
+}
+
+void test_greybus_framing_empty(void)
+{
+	static const uint8_t delimiters[] = { 0, 0, 0 };
+	static const uint8_t runt[] = { 0x02, 0x11, 0 };
+	int r;
+
+	decoder_reset();
+
+	/* a zero-length message still carries its CRC */
+	roundtrip(0);
+
+	/* idle line fill between frames is not an error */
+	r = feed(delimiters, sizeof(delimiters));
+	zassert_equal(r, -EAGAIN, "empty frame: %d", r);
+
+	/* one byte, too short for a CRC */
+	r = feed(runt, sizeof(runt));
+	zassert_equal(r, -EBADMSG, "runt frame: %d", r);
+}
+
+void test_greybus_framing_max_length(void)
+{
+	size_t flen;
+	int r;
+
+	decoder_reset();
+
+	/* the largest message that fits, CRC included */
+	fill(GB_MTU, 3);
+	roundtrip(GB_MTU);
+
+	/* one byte more does not fit */
+	fill(GB_MTU + 1, 3);
+	flen = gb_frame_encode(msg, GB_MTU + 1, frame);
+	r = feed(frame, flen);
+	zassert_equal(r, -EMSGSIZE, "overlong frame: %d", r);
+
+	/* and the decoder is fine afterwards */
+	fill(GB_MTU, 5);
+	roundtrip(GB_MTU);
+}
+
+void test_greybus_framing_crc_mismatch(void)
+{
+	size_t flen;
+	int r;
+
+	decoder_reset();
+
+	fill(64, 1);
+	flen = gb_frame_encode(msg, 64, frame);
+
+	/* a non-zero data byte, so that the COBS structure is intact */
+	zassert_true(frame[10] != 0 && frame[10] != 0xff, "not a data byte");
+	frame[10] ^= 0x01;
+	r = feed(frame, flen);
+	zassert_equal(r, -EILSEQ, "corrupted frame: %d", r);
+
+	frame[10] ^= 0x01;
+	r = feed(frame, flen);
+	zassert_equal(r, 64, "intact frame: %d", r);
+}
+
+void test_greybus_framing_resync(void)
+{
+	static const uint8_t garbage[] = {
+		0x13, 0x37, 0xff, 0x01, 0x42, 0x99, 0x05, 0x06,
+	};
+	size_t flen;
+	size_t i;
+	int r;
+
+	decoder_reset();
+
+	fill(100, 2);
+	flen = gb_frame_encode(msg, 100, frame);
+
+	/* garbage before a frame is dropped with the frame it merges into */
+	for (i = 0; i < sizeof(garbage); ++i) {
+		r = gb_frame_decode(&dec, garbage[i]);
+		zassert_equal(r, -EAGAIN, "garbage byte %zu: %d", i, r);
+	}
+	r = feed(frame, flen);
+	zassert_true(r < 0, "frame after garbage: %d", r);
+
+	/* the next frame decodes again */
+	r = feed(frame, flen);
+	zassert_equal(r, 100, "frame after resync: %d", r);
+
+	/* so does a frame whose start was lost */
+	r = feed(&frame[flen / 2], flen - flen / 2);
+	zassert_true(r < 0, "tail of a frame: %d", r);
+	r = feed(frame, flen);
+	zassert_equal(r, 100, "frame after lost start: %d", r);
+	zassert_mem_equal(buf, msg, 100, "data mismatch");
+}
+
+void test_greybus_framing_no_buffer(void)
+{
+	size_t flen;
+	int r;
+
+	decoder_reset();
+	dec.buf = NULL;
+
+	fill(32, 4);
+	flen = gb_frame_encode(msg, 32, frame);
+	r = feed(frame, flen);
+	zassert_equal(r, -ENOBUFS, "frame without buffer: %d", r);
+
+	dec.buf = buf;
+	r = feed(frame, flen);
+	zassert_equal(r, 32, "frame with buffer: %d", r);
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <ztest.h>
+
+extern void test_greybus_framing_roundtrip(void);
+extern void test_greybus_framing_empty(void);
+extern void test_greybus_framing_max_length(void);
+extern void test_greybus_framing_crc_mismatch(void);
+extern void test_greybus_framing_resync(void);
+extern void test_greybus_framing_no_buffer(void);
+
+void test_main(void) {
+
+    ztest_test_suite(greybus_framing,
+        ztest_unit_test(test_greybus_framing_roundtrip),
+        ztest_unit_test(test_greybus_framing_empty),
+        ztest_unit_test(test_greybus_framing_max_length),
+        ztest_unit_test(test_greybus_framing_crc_mismatch),
+        ztest_unit_test(test_greybus_framing_resync),
+        ztest_unit_test(test_greybus_framing_no_buffer)
+        );
+    ztest_run_test_suite(greybus_framing);
+}
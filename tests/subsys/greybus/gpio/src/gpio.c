@@ -7,6 +7,7 @@
 #include <device.h>
 #include <errno.h>
 #include <greybus/greybus.h>
+#include <greybus/platform.h>
 #include <string.h>
 #include <sys/util.h>
 #include <ztest.h>
@@ -256,6 +257,54 @@ static void tx_rx(const struct gb_operation_hdr *req, struct gb_operation_hdr *r
     }
 }
 
+#define TIME_TO_READY_ITERATIONS 16
+
+static uint32_t protocol_version_rtt_us(uint16_t id)
+{
+	const struct gb_operation_hdr req = {
+		.size = sys_cpu_to_le16(sizeof(struct gb_operation_hdr)),
+		.id = sys_cpu_to_le16(id),
+		.type = GB_GPIO_TYPE_PROTOCOL_VERSION,
+	};
+	uint8_t rsp_[
+		0
+		+ sizeof(struct gb_operation_hdr)
+		+ sizeof(struct gb_gpio_proto_version_response)
+		];
+	uint32_t start = k_cycle_get_32();
+
+	tx_rx(&req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)rsp_)->result);
+
+	return k_cyc_to_us_floor64(k_cycle_get_32() - start);
+}
+
+/*
+ * Must run before any other request reaches the gpio cport, so that with
+ * CONFIG_GREYBUS_LAZY_CPORTS the first request includes bringing it up.
+ * Compare the output of the default and lazy variants of this suite.
+ */
+void test_greybus_gpio_time_to_ready(void)
+{
+	uint32_t init_us = greybus_service_init_time_us();
+	uint32_t first_us;
+	uint32_t rest_us = 0;
+
+	zassert_not_equal(0, init_us, "Greybus is not initialized");
+
+	first_us = protocol_version_rtt_us(1);
+	for (size_t i = 0; i < TIME_TO_READY_ITERATIONS; ++i) {
+		rest_us += protocol_version_rtt_us(2 + i);
+	}
+
+	TC_PRINT("control cport ready after %u us, gpio cport: first request "
+		"%u us, then %u us on average (%s)\n", init_us, first_us,
+		rest_us / TIME_TO_READY_ITERATIONS,
+		IS_ENABLED(CONFIG_GREYBUS_LAZY_CPORTS) ? "lazy" : "eager");
+}
+
 void test_greybus_gpio_protocol_version(void) {
     const struct gb_operation_hdr req = {
         .size = sys_cpu_to_le16(sizeof(struct gb_operation_hdr)),
@@ -598,6 +647,205 @@ void test_greybus_gpio_set_value(void)
     zassert_equal(1, r, "expected: 1 actual: %d", 1, r);
 }
 
+void test_greybus_gpio_bulk(void)
+{
+	uint8_t cap_req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 ] = {};
+	struct gb_operation_hdr *const cap_req = (struct gb_operation_hdr *)cap_req_;
+	uint8_t cap_rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_get_capabilities_response)
+		 ];
+	struct gb_gpio_get_capabilities_response *const cap_rsp =
+		(struct gb_gpio_get_capabilities_response *)
+		(cap_rsp_ + sizeof(struct gb_operation_hdr));
+	uint8_t cfg_req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_bulk_configure_request)
+		 ] = {};
+	struct gb_operation_hdr *const cfg_req = (struct gb_operation_hdr *)cfg_req_;
+	struct gb_gpio_bulk_configure_request *const cfg =
+		(struct gb_gpio_bulk_configure_request *)
+		(cfg_req_ + sizeof(struct gb_operation_hdr));
+	uint8_t set_req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_bulk_set_request)
+		 ] = {};
+	struct gb_operation_hdr *const set_req = (struct gb_operation_hdr *)set_req_;
+	struct gb_gpio_bulk_set_request *const set =
+		(struct gb_gpio_bulk_set_request *)
+		(set_req_ + sizeof(struct gb_operation_hdr));
+	uint8_t get_req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_bulk_get_request)
+		 ] = {};
+	struct gb_operation_hdr *const get_req = (struct gb_operation_hdr *)get_req_;
+	struct gb_gpio_bulk_get_request *const get =
+		(struct gb_gpio_bulk_get_request *)
+		(get_req_ + sizeof(struct gb_operation_hdr));
+	uint8_t get_rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_bulk_get_response)
+		 ];
+	struct gb_gpio_bulk_get_response *const get_rsp =
+		(struct gb_gpio_bulk_get_response *)
+		(get_rsp_ + sizeof(struct gb_operation_hdr));
+	uint8_t rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 ];
+	const uint32_t pins = BIT(GPIO_PIN_OUT) | BIT(GPIO_PIN_IN);
+
+	cap_req->size = sys_cpu_to_le16(sizeof(cap_req_));
+	cap_req->id = sys_cpu_to_le16(0xabcd);
+	cap_req->type = GB_GPIO_TYPE_GET_CAPABILITIES;
+
+	tx_rx(cap_req, (struct gb_operation_hdr *)cap_rsp_, sizeof(cap_rsp_));
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)cap_rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)cap_rsp_)->result);
+	zassert_true(sys_le32_to_cpu(cap_rsp->flags) & GB_GPIO_CAP_BULK,
+		"bulk operations are not supported");
+	zassert_equal(pins, sys_le32_to_cpu(cap_rsp->valid_mask) & pins,
+		"test pins are not valid: 0x%08x", sys_le32_to_cpu(cap_rsp->valid_mask));
+
+	/* PIN_OUT is an output driven high, PIN_IN an input */
+	cfg_req->size = sys_cpu_to_le16(sizeof(cfg_req_));
+	cfg_req->id = sys_cpu_to_le16(0xabce);
+	cfg_req->type = GB_GPIO_TYPE_BULK_CONFIGURE;
+	cfg->mask = sys_cpu_to_le32(pins);
+	cfg->output_mask = sys_cpu_to_le32(BIT(GPIO_PIN_OUT));
+	cfg->values = sys_cpu_to_le32(BIT(GPIO_PIN_OUT));
+
+	tx_rx(cfg_req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)rsp_)->result);
+
+	get_req->size = sys_cpu_to_le16(sizeof(get_req_));
+	get_req->id = sys_cpu_to_le16(0xabcf);
+	get_req->type = GB_GPIO_TYPE_BULK_GET;
+	get->mask = sys_cpu_to_le32(BIT(GPIO_PIN_IN));
+
+	tx_rx(get_req, (struct gb_operation_hdr *)get_rsp_, sizeof(get_rsp_));
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)get_rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)get_rsp_)->result);
+	zassert_equal(BIT(GPIO_PIN_IN), sys_le32_to_cpu(get_rsp->values),
+		"expected: 0x%08x actual: 0x%08x", BIT(GPIO_PIN_IN),
+		sys_le32_to_cpu(get_rsp->values));
+
+	set_req->size = sys_cpu_to_le16(sizeof(set_req_));
+	set_req->id = sys_cpu_to_le16(0xabd0);
+	set_req->type = GB_GPIO_TYPE_BULK_SET;
+	set->mask = sys_cpu_to_le32(BIT(GPIO_PIN_OUT));
+	set->values = 0;
+
+	tx_rx(set_req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)rsp_)->result);
+
+	get_req->id = sys_cpu_to_le16(0xabd1);
+	tx_rx(get_req, (struct gb_operation_hdr *)get_rsp_, sizeof(get_rsp_));
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)get_rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)get_rsp_)->result);
+	zassert_equal(0, sys_le32_to_cpu(get_rsp->values),
+		"expected: 0x%08x actual: 0x%08x", 0,
+		sys_le32_to_cpu(get_rsp->values));
+
+	/* lines outside of the port are rejected */
+	set->mask = sys_cpu_to_le32(~sys_le32_to_cpu(cap_rsp->valid_mask));
+	if (set->mask != 0) {
+		set_req->id = sys_cpu_to_le16(0xabd2);
+		tx_rx(set_req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+		zassert_equal(GB_OP_INVALID, ((struct gb_operation_hdr *)rsp_)->result,
+			"expected: %u actual: %u", GB_OP_INVALID,
+			((struct gb_operation_hdr *)rsp_)->result);
+	}
+}
+
+#define BENCHMARK_ITERATIONS 1000
+
+void test_greybus_gpio_benchmark(void)
+{
+	int r;
+	uint32_t start;
+	uint32_t elapsed;
+	uint8_t set_req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_set_value_request)
+		 ] = {};
+	struct gb_operation_hdr *const set_req = (struct gb_operation_hdr *)set_req_;
+	struct gb_gpio_set_value_request *const set =
+		(struct gb_gpio_set_value_request *)
+		(set_req_ + sizeof(struct gb_operation_hdr));
+	uint8_t get_req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_get_value_request)
+		 ] = {};
+	struct gb_operation_hdr *const get_req = (struct gb_operation_hdr *)get_req_;
+	struct gb_gpio_get_value_request *const get =
+		(struct gb_gpio_get_value_request *)
+		(get_req_ + sizeof(struct gb_operation_hdr));
+	uint8_t set_rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 ];
+	uint8_t get_rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_get_value_response)
+		 ];
+	struct gb_gpio_get_value_response *const get_rsp =
+		(struct gb_gpio_get_value_response *)
+		(get_rsp_ + sizeof(struct gb_operation_hdr));
+
+	r = gpio_pin_configure(gpio_dev, GPIO_PIN_OUT, GPIO_OUTPUT);
+	zassert_equal(0, r, "gpio_pin_configure() failed: %d", r);
+
+	set_req->size = sys_cpu_to_le16(sizeof(set_req_));
+	set_req->type = GB_GPIO_TYPE_SET_VALUE;
+	set->which = GPIO_PIN_OUT;
+
+	get_req->size = sys_cpu_to_le16(sizeof(get_req_));
+	get_req->type = GB_GPIO_TYPE_GET_VALUE;
+	get->which = GPIO_PIN_IN;
+
+	start = k_uptime_get_32();
+	for (size_t i = 0; i < BENCHMARK_ITERATIONS; ++i) {
+		set->value = i & 1;
+		set_req->id = sys_cpu_to_le16(2 * i + 1);
+		tx_rx(set_req, (struct gb_operation_hdr *)set_rsp_, sizeof(set_rsp_));
+		zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)set_rsp_)->result,
+			"expected: %u actual: %u", GB_OP_SUCCESS,
+			((struct gb_operation_hdr *)set_rsp_)->result);
+
+		get_req->id = sys_cpu_to_le16(2 * i + 2);
+		tx_rx(get_req, (struct gb_operation_hdr *)get_rsp_, sizeof(get_rsp_));
+		zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)get_rsp_)->result,
+			"expected: %u actual: %u", GB_OP_SUCCESS,
+			((struct gb_operation_hdr *)get_rsp_)->result);
+		zassert_equal(i & 1, get_rsp->value, "expected: %u actual: %u",
+			(unsigned)(i & 1), get_rsp->value);
+	}
+	elapsed = MAX(k_uptime_get_32() - start, 1);
+
+	TC_PRINT("%u set/get round-trips in %u ms (%u per second)\n",
+		BENCHMARK_ITERATIONS, elapsed,
+		(uint32_t)(BENCHMARK_ITERATIONS * 1000ULL / elapsed));
+}
+
 void test_greybus_gpio_set_debounce(void)
 {
 	uint8_t req_[
@@ -793,3 +1041,343 @@ void test_greybus_gpio_irq_event(void)
 		}
     }
 }
+
+static void irq_coalesce(bool enable)
+{
+	uint8_t req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_irq_coalesce_request)
+		 ] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	struct gb_gpio_irq_coalesce_request *const coalesce_req =
+		(struct gb_gpio_irq_coalesce_request *)
+		(req_ + sizeof(struct gb_operation_hdr));
+	uint8_t rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 ];
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->id = sys_cpu_to_le16(0xabcd);
+	req->type = GB_GPIO_TYPE_IRQ_COALESCE;
+	coalesce_req->enable = enable;
+
+	tx_rx(req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)rsp_)->result);
+}
+
+void test_greybus_gpio_irq_events(void)
+{
+	int r;
+	size_t size;
+	size_t i;
+	struct pollfd pollfd = {};
+	uint8_t msg_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_irq_events_request)
+		 + GPIO_MAX_PINS_PER_PORT * sizeof(struct gb_gpio_irq_event_entry)
+		 ];
+	struct gb_operation_hdr *const hdr = (struct gb_operation_hdr *)msg_;
+	struct gb_gpio_irq_events_request *const events =
+		(struct gb_gpio_irq_events_request *)
+		(msg_ + sizeof(struct gb_operation_hdr));
+
+	irq_coalesce(true);
+
+	r = gpio_pin_configure(gpio_dev, GPIO_PIN_IN, GPIO_INPUT);
+	zassert_equal(0, r, "gpio_pin_configure() failed: %d", r);
+
+	r = gpio_pin_interrupt_configure(gpio_dev, GPIO_PIN_IN, GPIO_INT_EDGE_RISING);
+	zassert_equal(0, r, "gpio_pin_interrupt_configure() failed: %d", r);
+
+	r = gpio_pin_configure(gpio_dev, GPIO_PIN_OUT, GPIO_OUTPUT);
+	zassert_equal(0, r, "gpio_pin_configure() failed: %d", r);
+
+	/* a burst of edges, reported in as few messages as possible */
+	for (i = 0; i < 4; ++i) {
+		r = gpio_pin_set(gpio_dev, GPIO_PIN_OUT, 0);
+		zassert_equal(0, r, "gpio_pin_set() failed: %d", r);
+		r = gpio_pin_set(gpio_dev, GPIO_PIN_OUT, 1);
+		zassert_equal(0, r, "gpio_pin_set() failed: %d", r);
+	}
+
+	for(;;) {
+		memset(&pollfd, 0, sizeof(pollfd));
+		pollfd.fd = fd;
+		pollfd.events = POLLIN;
+
+		r = poll(&pollfd, 1, TIMEOUT_MS);
+		zassert_not_equal(r, -1, "poll: %d", errno);
+		zassert_not_equal(r, 0, "timeout waiting for response");
+
+		r = recv(fd, hdr, sizeof(*hdr), 0);
+		zassert_equal(r, sizeof(*hdr), "expected: %u actual: %d", sizeof(*hdr), r);
+
+		size = sys_le16_to_cpu(hdr->size) - sizeof(*hdr);
+		zassert_true(size <= sizeof(msg_) - sizeof(*hdr), "message too large: %u", size);
+		if (size > 0) {
+			r = recv(fd, events, size, 0);
+			zassert_equal(r, size, "expected: %u actual: %d", size, r);
+		}
+
+		if (hdr->type != GB_GPIO_TYPE_IRQ_EVENTS) {
+			continue;
+		}
+
+		zassert_true(size >= sizeof(*events), "short message: %u", size);
+		zassert_equal(size - sizeof(*events),
+			popcount(sys_le32_to_cpu(events->pins)) * sizeof(events->events[0]),
+			"one event expected per pin");
+
+		if (sys_le32_to_cpu(events->pins) & BIT(GPIO_PIN_IN)) {
+			break;
+		}
+	}
+
+	for (i = 0; events->events[i].which != GPIO_PIN_IN; ++i) {
+	}
+	zassert_true(events->events[i].count >= 1, "no edges counted");
+
+	r = gpio_pin_interrupt_configure(gpio_dev, GPIO_PIN_IN, GPIO_INT_DISABLE);
+	zassert_equal(0, r, "gpio_pin_interrupt_configure() failed: %d", r);
+
+	irq_coalesce(false);
+}
+
+void test_greybus_gpio_sequence(void)
+{
+	int r;
+	size_t size;
+	struct pollfd pollfd = {};
+	uint8_t req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_sequence_start_request)
+		 + 3 * sizeof(struct gb_gpio_sequence_step)
+		 ] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	struct gb_gpio_sequence_start_request *const start =
+		(struct gb_gpio_sequence_start_request *)
+		(req_ + sizeof(struct gb_operation_hdr));
+	uint8_t rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 ];
+	uint8_t msg_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + 256
+		 ];
+	struct gb_operation_hdr *const hdr = (struct gb_operation_hdr *)msg_;
+	struct gb_gpio_sequence_done_request *const done =
+		(struct gb_gpio_sequence_done_request *)
+		(msg_ + sizeof(struct gb_operation_hdr));
+	const uint32_t values[] = { BIT(GPIO_PIN_OUT), 0, BIT(GPIO_PIN_OUT) };
+
+	if (!IS_ENABLED(CONFIG_GREYBUS_GPIO_SEQUENCE)) {
+		ztest_test_skip();
+		return;
+	}
+
+	r = gpio_pin_configure(gpio_dev, GPIO_PIN_IN, GPIO_INPUT);
+	zassert_equal(0, r, "gpio_pin_configure() failed: %d", r);
+
+	r = gpio_pin_configure(gpio_dev, GPIO_PIN_OUT, GPIO_OUTPUT_LOW);
+	zassert_equal(0, r, "gpio_pin_configure() failed: %d", r);
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->id = sys_cpu_to_le16(0xabcd);
+	req->type = GB_GPIO_TYPE_SEQUENCE_START;
+	start->repeat = sys_cpu_to_le16(2);
+	start->count = sys_cpu_to_le16(ARRAY_SIZE(values));
+	for (size_t i = 0; i < ARRAY_SIZE(values); ++i) {
+		start->steps[i].mask = sys_cpu_to_le32(BIT(GPIO_PIN_OUT));
+		start->steps[i].values = sys_cpu_to_le32(values[i]);
+		start->steps[i].delay_us = sys_cpu_to_le32(100);
+	}
+
+	tx_rx(req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)rsp_)->result);
+
+	for(;;) {
+		memset(&pollfd, 0, sizeof(pollfd));
+		pollfd.fd = fd;
+		pollfd.events = POLLIN;
+
+		r = poll(&pollfd, 1, TIMEOUT_MS);
+		zassert_not_equal(r, -1, "poll: %d", errno);
+		zassert_not_equal(r, 0, "timeout waiting for sequence to complete");
+
+		r = recv(fd, hdr, sizeof(*hdr), 0);
+		zassert_equal(r, sizeof(*hdr), "expected: %u actual: %d", sizeof(*hdr), r);
+
+		size = sys_le16_to_cpu(hdr->size) - sizeof(*hdr);
+		zassert_true(size <= sizeof(msg_) - sizeof(*hdr), "message too large: %u", size);
+		if (size > 0) {
+			r = recv(fd, done, size, 0);
+			zassert_equal(r, size, "expected: %u actual: %d", size, r);
+		}
+
+		if (hdr->type == GB_GPIO_TYPE_SEQUENCE_DONE) {
+			break;
+		}
+	}
+
+	zassert_equal(GB_OP_SUCCESS, done->result, "expected: %u actual: %u",
+		GB_OP_SUCCESS, done->result);
+	zassert_equal(2, sys_le16_to_cpu(done->runs), "expected: %u actual: %u",
+		2, sys_le16_to_cpu(done->runs));
+
+	/* the last step leaves PIN_OUT, and so PIN_IN, high */
+	r = gpio_pin_get(gpio_dev, GPIO_PIN_IN);
+	zassert_equal(1, r, "expected: %u actual: %d", 1, r);
+}
+
+static void capture_stop(void)
+{
+	uint8_t req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 ] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	uint8_t rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 ];
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->id = sys_cpu_to_le16(0xabcd);
+	req->type = GB_GPIO_TYPE_CAPTURE_STOP;
+
+	tx_rx(req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)rsp_)->result);
+}
+
+void test_greybus_gpio_capture(void)
+{
+	int r;
+	size_t size;
+	size_t i;
+	size_t edges = 0;
+	bool have_prev = false;
+	uint32_t prev = 0;
+	uint32_t timestamp;
+	struct pollfd pollfd = {};
+	uint8_t req_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_capture_start_request)
+		 ] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	struct gb_gpio_capture_start_request *const start =
+		(struct gb_gpio_capture_start_request *)
+		(req_ + sizeof(struct gb_operation_hdr));
+	uint8_t rsp_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + sizeof(struct gb_gpio_capture_start_response)
+		 ];
+	struct gb_gpio_capture_start_response *const started =
+		(struct gb_gpio_capture_start_response *)
+		(rsp_ + sizeof(struct gb_operation_hdr));
+	uint8_t msg_[
+		 0
+		 + sizeof(struct gb_operation_hdr)
+		 + 512
+		 ];
+	struct gb_operation_hdr *const hdr = (struct gb_operation_hdr *)msg_;
+	struct gb_gpio_capture_data_request *const data =
+		(struct gb_gpio_capture_data_request *)
+		(msg_ + sizeof(struct gb_operation_hdr));
+
+	if (!IS_ENABLED(CONFIG_GREYBUS_GPIO_CAPTURE)) {
+		ztest_test_skip();
+		return;
+	}
+
+	r = gpio_pin_configure(gpio_dev, GPIO_PIN_IN, GPIO_INPUT);
+	zassert_equal(0, r, "gpio_pin_configure() failed: %d", r);
+
+	r = gpio_pin_configure(gpio_dev, GPIO_PIN_OUT, GPIO_OUTPUT_LOW);
+	zassert_equal(0, r, "gpio_pin_configure() failed: %d", r);
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->id = sys_cpu_to_le16(0xabcd);
+	req->type = GB_GPIO_TYPE_CAPTURE_START;
+	start->pins = sys_cpu_to_le32(BIT(GPIO_PIN_IN));
+	start->type = GB_GPIO_IRQ_TYPE_EDGE_BOTH;
+	start->period_ms = sys_cpu_to_le16(10);
+
+	tx_rx(req, (struct gb_operation_hdr *)rsp_, sizeof(rsp_));
+
+	zassert_equal(GB_OP_SUCCESS, ((struct gb_operation_hdr *)rsp_)->result,
+		"expected: %u actual: %u", GB_OP_SUCCESS,
+		((struct gb_operation_hdr *)rsp_)->result);
+	zassert_not_equal(0, sys_le32_to_cpu(started->cycles_per_sec),
+		"invalid timestamp frequency");
+
+	/* the line stays armed, so every edge is captured without unmasking */
+	for (i = 0; i < 4; ++i) {
+		r = gpio_pin_set(gpio_dev, GPIO_PIN_OUT, 1);
+		zassert_equal(0, r, "gpio_pin_set() failed: %d", r);
+		r = gpio_pin_set(gpio_dev, GPIO_PIN_OUT, 0);
+		zassert_equal(0, r, "gpio_pin_set() failed: %d", r);
+	}
+
+	while (edges < 8) {
+		memset(&pollfd, 0, sizeof(pollfd));
+		pollfd.fd = fd;
+		pollfd.events = POLLIN;
+
+		r = poll(&pollfd, 1, TIMEOUT_MS);
+		zassert_not_equal(r, -1, "poll: %d", errno);
+		zassert_not_equal(r, 0, "timeout waiting for captured edges");
+
+		r = recv(fd, hdr, sizeof(*hdr), 0);
+		zassert_equal(r, sizeof(*hdr), "expected: %u actual: %d", sizeof(*hdr), r);
+
+		size = sys_le16_to_cpu(hdr->size) - sizeof(*hdr);
+		zassert_true(size <= sizeof(msg_) - sizeof(*hdr), "message too large: %u", size);
+		if (size > 0) {
+			r = recv(fd, data, size, 0);
+			zassert_equal(r, size, "expected: %u actual: %d", size, r);
+		}
+
+		if (hdr->type != GB_GPIO_TYPE_CAPTURE_DATA) {
+			continue;
+		}
+
+		zassert_true(size >= sizeof(*data), "short message: %u", size);
+		zassert_equal(size - sizeof(*data),
+			sys_le16_to_cpu(data->count) * sizeof(data->events[0]),
+			"event count does not match message size");
+		zassert_equal(0, sys_le32_to_cpu(data->dropped), "edges were dropped");
+
+		for (i = 0; i < sys_le16_to_cpu(data->count); ++i) {
+			zassert_equal(GPIO_PIN_IN, data->events[i].which,
+				"expected: %u actual: %u", GPIO_PIN_IN, data->events[i].which);
+
+			timestamp = sys_le32_to_cpu(data->events[i].timestamp);
+			zassert_true(!have_prev || (int32_t)(timestamp - prev) >= 0,
+				"timestamps out of order");
+			prev = timestamp;
+			have_prev = true;
+			edges++;
+		}
+	}
+
+	zassert_equal(8, edges, "expected: %u actual: %u", 8, edges);
+
+	capture_stop();
+}
@@ -6,6 +6,7 @@
 
 #include <ztest.h>
 
+extern void test_greybus_gpio_time_to_ready(void);
 extern void test_greybus_gpio_protocol_version(void);
 extern void test_greybus_gpio_cport_shutdown(void);
 extern void test_greybus_gpio_line_count(void);
@@ -16,11 +17,16 @@ extern void test_greybus_gpio_direction_input(void);
 extern void test_greybus_gpio_direction_output(void);
 extern void test_greybus_gpio_get_value(void);
 extern void test_greybus_gpio_set_value(void);
+extern void test_greybus_gpio_bulk(void);
+extern void test_greybus_gpio_benchmark(void);
 extern void test_greybus_gpio_set_debounce(void);
 extern void test_greybus_gpio_irq_type(void);
 extern void test_greybus_gpio_irq_mask(void);
 extern void test_greybus_gpio_irq_unmask(void);
 extern void test_greybus_gpio_irq_event(void);
+extern void test_greybus_gpio_irq_events(void);
+extern void test_greybus_gpio_sequence(void);
+extern void test_greybus_gpio_capture(void);
 
 static void board_setup(void)
 {
@@ -38,6 +44,7 @@ void test_main(void) {
 	board_setup();
 	test_greybus_setup();
     ztest_test_suite(greybus_gpio,
+        ztest_unit_test(test_greybus_gpio_time_to_ready),
         ztest_unit_test(test_greybus_gpio_protocol_version),
         ztest_unit_test(test_greybus_gpio_cport_shutdown),
         ztest_unit_test(test_greybus_gpio_line_count),
@@ -48,11 +55,16 @@ void test_main(void) {
         ztest_unit_test(test_greybus_gpio_direction_output),
         ztest_unit_test(test_greybus_gpio_get_value),
         ztest_unit_test(test_greybus_gpio_set_value),
+        ztest_unit_test(test_greybus_gpio_bulk),
+        ztest_unit_test(test_greybus_gpio_benchmark),
         ztest_unit_test(test_greybus_gpio_set_debounce),
         ztest_unit_test(test_greybus_gpio_irq_type),
         ztest_unit_test(test_greybus_gpio_irq_mask),
         ztest_unit_test(test_greybus_gpio_irq_unmask),
-        ztest_unit_test(test_greybus_gpio_irq_event)
+        ztest_unit_test(test_greybus_gpio_irq_event),
+        ztest_unit_test(test_greybus_gpio_irq_events),
+        ztest_unit_test(test_greybus_gpio_sequence),
+        ztest_unit_test(test_greybus_gpio_capture)
         );
     ztest_run_test_suite(greybus_gpio);
     test_greybus_teardown();
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <drivers/i2c.h>
+#include <drivers/i2c_emul.h>
+#include <sys/util.h>
+#include <zephyr.h>
+
+#include "test-greybus-i2c.h"
+
+/*
+ * When I2C is emulated, these targets stand in for simple register file
+ * devices. The first byte of each write selects a register, and any
+ * following bytes are written to consecutive registers. Reads return
+ * consecutive registers starting from the selected one.
+ */
+
+struct i2c_sim {
+	struct i2c_emul emul;
+	uint8_t regs[256];
+	uint8_t reg;
+	/* the last bus transaction ended with a write */
+	bool write_last;
+};
+
+/*
+ * A register address write and the read that follows it must be in the
+ * same bus transaction, since a STOP between them is not a repeated
+ * start. Count reads that started a transaction after a write ended one.
+ */
+static unsigned int split_reads;
+
+static int i2c_sim_transfer(struct i2c_emul *emul, struct i2c_msg *msgs,
+			    int num_msgs, int addr)
+{
+	size_t i;
+	struct i2c_sim *sim = CONTAINER_OF(emul, struct i2c_sim, emul);
+
+	if (addr != emul->addr) {
+		return -EIO;
+	}
+
+	if (num_msgs > 0 && (msgs[0].flags & I2C_MSG_READ) && sim->write_last) {
+		split_reads++;
+	}
+	sim->write_last = num_msgs > 0 &&
+		!(msgs[num_msgs - 1].flags & I2C_MSG_READ);
+
+	for (; num_msgs > 0; --num_msgs, ++msgs) {
+		if (msgs->flags & I2C_MSG_READ) {
+			for (i = 0; i < msgs->len; ++i) {
+				msgs->buf[i] = sim->regs[sim->reg++];
+			}
+			continue;
+		}
+
+		if (msgs->len == 0) {
+			continue;
+		}
+
+		sim->reg = msgs->buf[0];
+		for (i = 1; i < msgs->len; ++i) {
+			sim->regs[sim->reg++] = msgs->buf[i];
+		}
+	}
+
+	return 0;
+}
+
+static const struct i2c_emul_api i2c_sim_api = {
+	.transfer = i2c_sim_transfer,
+};
+
+static struct i2c_sim i2c_sim[] = {
+	{
+		.emul = {
+			.api = &i2c_sim_api,
+			.addr = I2C_SIM_ADDR,
+		},
+	},
+	{
+		.emul = {
+			.api = &i2c_sim_api,
+			.addr = I2C_SIM_ADDR2,
+		},
+	},
+};
+
+unsigned int i2c_sim_split_reads(void)
+{
+	return split_reads;
+}
+
+void i2c_sim_setup(void)
+{
+	size_t i;
+	size_t j;
+	const struct device *dev = device_get_binding(I2C_DEV_NAME);
+	__ASSERT(dev != NULL, "Device not found");
+
+	for (i = 0; i < ARRAY_SIZE(i2c_sim); ++i) {
+		/* registers initially hold their own address, xor the target index */
+		for (j = 0; j < ARRAY_SIZE(i2c_sim[i].regs); ++j) {
+			i2c_sim[i].regs[j] = j ^ i;
+		}
+
+		int rc = i2c_emul_register(dev, "i2c_sim", &i2c_sim[i].emul);
+		__ASSERT(rc == 0, "i2c_emul_register() failed: %d", rc);
+	}
+}
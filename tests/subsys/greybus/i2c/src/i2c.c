@@ -35,6 +35,7 @@
 #endif
 
 #include "../../../../subsys/greybus/i2c-gb.h"
+#include "../../../../subsys/greybus/periodic-gb.h"
 
 #include "test-greybus-i2c.h"
 
@@ -108,6 +109,15 @@ static void tx_rx(const struct gb_operation_hdr *req,
 	zassert_equal(rsp->type, GB_TYPE_RESPONSE_FLAG | req->type,
 			  "expected: %u actual: %u",
 			  GB_TYPE_RESPONSE_FLAG | req->type, rsp->type);
+
+	size = sys_le16_to_cpu(rsp->size) - hdr_size;
+	if (size > 0 && rsp->result == GB_OP_SUCCESS) {
+		zassert_true((size_t)size <= rsp_size - hdr_size,
+			     "response too large: %d", size);
+		r = recv(fd, (uint8_t *)rsp + hdr_size, size, 0);
+		zassert_equal(size, r, "recv: expected: %d actual: %d", size,
+			      r);
+	}
 }
 
 void test_greybus_i2c_protocol_version(void)
@@ -183,6 +193,520 @@ void test_greybus_i2c_functionality(void)
 		      expected_uint32, actual_uint32);
 }
 
+#define TRANSFER_MAX_SIZE 256
+#define BENCHMARK_ITERATIONS 1000
+
+/*
+ * Issue a single transfer operation of @op_count descriptors, followed by
+ * @write_size bytes of write data, and copy @read_size bytes of read data
+ * from the response into @read.
+ */
+static uint8_t transfer(uint16_t id, const struct gb_i2c_transfer_desc *desc,
+			size_t op_count, const uint8_t *write,
+			size_t write_size, uint8_t *read, size_t read_size)
+{
+	uint8_t req_[0 + sizeof(struct gb_operation_hdr) +
+		     TRANSFER_MAX_SIZE] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	struct gb_i2c_transfer_req *const xfer =
+		(struct gb_i2c_transfer_req *)(req_ +
+					       sizeof(struct gb_operation_hdr));
+	uint8_t rsp_[0 + sizeof(struct gb_operation_hdr) +
+		     TRANSFER_MAX_SIZE];
+	struct gb_operation_hdr *const rsp = (struct gb_operation_hdr *)rsp_;
+	const size_t size = sizeof(*xfer) + op_count * sizeof(*desc) +
+			    write_size;
+
+	zassert_true(size <= TRANSFER_MAX_SIZE, "request too large: %u",
+		     (unsigned)size);
+
+	req->size = sys_cpu_to_le16(sizeof(*req) + size);
+	req->id = sys_cpu_to_le16(id);
+	req->type = GB_I2C_PROTOCOL_TRANSFER;
+	xfer->op_count = sys_cpu_to_le16(op_count);
+	memcpy(xfer->desc, desc, op_count * sizeof(*desc));
+	memcpy(&xfer->desc[op_count], write, write_size);
+
+	tx_rx(req, rsp, sizeof(struct gb_operation_hdr) + read_size);
+
+	if (rsp->result == GB_OP_SUCCESS && read_size > 0) {
+		zassert_equal(sizeof(*rsp) + read_size,
+			      sys_le16_to_cpu(rsp->size),
+			      "expected: %u actual: %u",
+			      (unsigned)(sizeof(*rsp) + read_size),
+			      sys_le16_to_cpu(rsp->size));
+		memcpy(read, rsp_ + sizeof(*rsp), read_size);
+	}
+
+	return rsp->result;
+}
+
+#define DESC_ADDR(_addr, _flags, _size)                                        \
+	{                                                                      \
+		.addr = sys_cpu_to_le16(_addr),                                \
+		.flags = sys_cpu_to_le16(_flags), .size = sys_cpu_to_le16(_size), \
+	}
+
+#define DESC(_flags, _size) DESC_ADDR(I2C_SIM_ADDR, _flags, _size)
+
 void test_greybus_i2c_transfer(void)
 {
+	uint8_t result;
+	const struct gb_i2c_transfer_desc write_desc[] = {
+		DESC(0, 5),
+	};
+	const uint8_t write_data[] = { 0x10, 0xa0, 0xa1, 0xa2, 0xa3 };
+	const struct gb_i2c_transfer_desc read_desc[] = {
+		DESC(0, 1),
+		DESC(GB_I2C_M_RD, 4),
+	};
+	const uint8_t read_reg[] = { 0x10 };
+	uint8_t read_data[4] = {};
+
+	result = transfer(0xabcd, write_desc, ARRAY_SIZE(write_desc),
+			  write_data, sizeof(write_data), NULL, 0);
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+
+	result = transfer(0xabce, read_desc, ARRAY_SIZE(read_desc), read_reg,
+			  sizeof(read_reg), read_data, sizeof(read_data));
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+	zassert_mem_equal(&write_data[1], read_data, sizeof(read_data),
+			  "read data does not match written data");
+}
+
+void test_greybus_i2c_transfer_chunked(void)
+{
+	size_t i;
+	uint8_t result;
+	/* more operations than fit in one bus transaction by default */
+	struct gb_i2c_transfer_desc desc[12];
+	uint8_t regs[ARRAY_SIZE(desc) / 2];
+	uint8_t read_data[ARRAY_SIZE(desc) / 2] = {};
+
+	for (i = 0; i < ARRAY_SIZE(regs); ++i) {
+		desc[2 * i] = (struct gb_i2c_transfer_desc)DESC(0, 1);
+		desc[2 * i + 1] =
+			(struct gb_i2c_transfer_desc)DESC(GB_I2C_M_RD, 1);
+		regs[i] = 0x20 + i;
+	}
+
+	result = transfer(0xabcd, desc, ARRAY_SIZE(desc), regs, sizeof(regs),
+			  read_data, sizeof(read_data));
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+
+	/* registers initially hold their own address */
+	zassert_mem_equal(regs, read_data, sizeof(read_data),
+			  "read data does not match register addresses");
+}
+
+void test_greybus_i2c_transfer_chunked_repeated_start(void)
+{
+	size_t i;
+	uint8_t result;
+	unsigned int split_reads = 0;
+	/*
+	 * One write first, so that with the default bus size a register
+	 * address write falls at the end of a bus transaction and its read
+	 * at the start of the next one.
+	 */
+	struct gb_i2c_transfer_desc desc[13];
+	uint8_t write_data[2 + ARRAY_SIZE(desc) / 2] = { 0x60, 0xb0 };
+	uint8_t read_data[ARRAY_SIZE(desc) / 2] = {};
+	uint8_t expected[ARRAY_SIZE(read_data)];
+
+	desc[0] = (struct gb_i2c_transfer_desc)DESC(0, 2);
+	for (i = 0; i < ARRAY_SIZE(read_data); ++i) {
+		desc[1 + 2 * i] = (struct gb_i2c_transfer_desc)DESC(0, 1);
+		desc[2 + 2 * i] =
+			(struct gb_i2c_transfer_desc)DESC(GB_I2C_M_RD, 1);
+		/* read back the register written first, then the next ones */
+		write_data[2 + i] = 0x60 + i;
+		expected[i] = i == 0 ? 0xb0 : 0x60 + i;
+	}
+
+	if (IS_ENABLED(CONFIG_I2C_EMUL)) {
+		split_reads = i2c_sim_split_reads();
+	}
+
+	result = transfer(0xabcd, desc, ARRAY_SIZE(desc), write_data,
+			  sizeof(write_data), read_data, sizeof(read_data));
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+	zassert_mem_equal(expected, read_data, sizeof(read_data),
+			  "read data does not match written data");
+
+	if (IS_ENABLED(CONFIG_I2C_EMUL)) {
+		zassert_equal(split_reads, i2c_sim_split_reads(),
+			      "a read was split from its register address");
+	}
+}
+
+void test_greybus_i2c_transfer_multi_addr(void)
+{
+	uint8_t result;
+	/* read both targets, then the first one again, in one operation */
+	const struct gb_i2c_transfer_desc desc[] = {
+		DESC_ADDR(I2C_SIM_ADDR, 0, 1),
+		DESC_ADDR(I2C_SIM_ADDR, GB_I2C_M_RD, 2),
+		DESC_ADDR(I2C_SIM_ADDR2, 0, 1),
+		DESC_ADDR(I2C_SIM_ADDR2, GB_I2C_M_RD, 2),
+		DESC_ADDR(I2C_SIM_ADDR, 0, 1),
+		DESC_ADDR(I2C_SIM_ADDR, GB_I2C_M_RD, 1),
+	};
+	const uint8_t regs[] = { 0x40, 0x40, 0x48 };
+	const uint8_t expected[] = { 0x40, 0x41, 0x41, 0x40, 0x48 };
+	uint8_t read_data[sizeof(expected)] = {};
+
+	result = transfer(0xabcd, desc, ARRAY_SIZE(desc), regs, sizeof(regs),
+			  read_data, sizeof(read_data));
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+	zassert_mem_equal(expected, read_data, sizeof(read_data),
+			  "read data does not match request order");
+}
+
+void test_greybus_i2c_transfer_pipelined(void)
+{
+	int r;
+	size_t i;
+	size_t id;
+	struct pollfd pollfd;
+	uint8_t seen = 0;
+	/* write one register address, then read it back */
+	uint8_t req_[0 + sizeof(struct gb_operation_hdr) +
+		     sizeof(struct gb_i2c_transfer_req) +
+		     2 * sizeof(struct gb_i2c_transfer_desc) + 1] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	struct gb_i2c_transfer_req *const xfer =
+		(struct gb_i2c_transfer_req *)(req_ +
+					       sizeof(struct gb_operation_hdr));
+	uint8_t rsp_[0 + sizeof(struct gb_operation_hdr) + 1];
+	struct gb_operation_hdr *const rsp = (struct gb_operation_hdr *)rsp_;
+	const struct gb_i2c_transfer_desc desc[] = {
+		DESC(0, 1),
+		DESC(GB_I2C_M_RD, 1),
+	};
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->type = GB_I2C_PROTOCOL_TRANSFER;
+	xfer->op_count = sys_cpu_to_le16(ARRAY_SIZE(desc));
+	memcpy(xfer->desc, desc, sizeof(desc));
+
+	/* several requests in flight, each answered once the bus is done */
+	for (i = 1; i <= 4; ++i) {
+		req->id = sys_cpu_to_le16(i);
+		req_[sizeof(req_) - 1] = 0x50 + i;
+		r = send(fd, req, sizeof(req_), 0);
+		zassert_equal(r, sizeof(req_), "send: expected: %u actual: %d",
+			      (unsigned)sizeof(req_), r);
+	}
+
+	for (i = 0; i < 4; ++i) {
+		pollfd.fd = fd;
+		pollfd.events = POLLIN;
+
+		r = poll(&pollfd, 1, TIMEOUT_MS);
+		zassert_not_equal(r, -1, "poll: %d", errno);
+		zassert_not_equal(r, 0, "timeout waiting for response");
+
+		r = recv(fd, rsp, sizeof(rsp_), 0);
+		zassert_equal(r, sizeof(rsp_), "recv: expected: %u actual: %d",
+			      (unsigned)sizeof(rsp_), r);
+		zassert_equal(GB_OP_SUCCESS, rsp->result,
+			      "expected: %u actual: %u", GB_OP_SUCCESS,
+			      rsp->result);
+
+		id = sys_le16_to_cpu(rsp->id);
+		zassert_true(id >= 1 && id <= 4, "unexpected id %u",
+			     (unsigned)id);
+		zassert_false(seen & BIT(id), "duplicate response %u",
+			      (unsigned)id);
+		seen |= BIT(id);
+
+		zassert_equal(0x50 + id, rsp_[sizeof(*rsp)],
+			      "expected: %u actual: %u", (unsigned)(0x50 + id),
+			      rsp_[sizeof(*rsp)]);
+	}
+}
+
+/*
+ * Wait up to @timeout_ms for a periodic data request with one sample, and
+ * return its read data, or -1 if none arrived.
+ */
+static int periodic_sample(uint8_t id, int timeout_ms)
+{
+	int r;
+	int size;
+	struct pollfd pollfd;
+	uint8_t msg_[0 + sizeof(struct gb_operation_hdr) +
+		     sizeof(struct gb_periodic_data_request) +
+		     sizeof(struct gb_periodic_sample) + 1];
+	struct gb_operation_hdr *const msg = (struct gb_operation_hdr *)msg_;
+	struct gb_periodic_data_request *const data =
+		(struct gb_periodic_data_request *)(msg_ + sizeof(*msg));
+	struct gb_periodic_sample *const sample =
+		(struct gb_periodic_sample *)data->samples;
+
+	pollfd.fd = fd;
+	pollfd.events = POLLIN;
+
+	r = poll(&pollfd, 1, timeout_ms);
+	zassert_not_equal(r, -1, "poll: %d", errno);
+	if (r == 0) {
+		return -1;
+	}
+
+	r = recv(fd, msg, sizeof(*msg), 0);
+	zassert_equal(sizeof(*msg), r, "recv: expected: %u actual: %d",
+		      (unsigned)sizeof(*msg), r);
+	zassert_equal(GB_I2C_PROTOCOL_PERIODIC_DATA, msg->type,
+		      "expected: %u actual: %u", GB_I2C_PROTOCOL_PERIODIC_DATA,
+		      msg->type);
+
+	size = sys_le16_to_cpu(msg->size);
+	zassert_equal(sizeof(msg_), size, "expected: %u actual: %d",
+		      (unsigned)sizeof(msg_), size);
+	r = recv(fd, msg_ + sizeof(*msg), size - sizeof(*msg), 0);
+	zassert_equal(size - sizeof(*msg), r, "recv: expected: %u actual: %d",
+		      (unsigned)(size - sizeof(*msg)), r);
+
+	zassert_equal(id, data->id, "expected: %u actual: %u", id, data->id);
+	zassert_equal(GB_OP_SUCCESS, data->result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, data->result);
+	zassert_equal(1, sys_le16_to_cpu(data->count),
+		      "expected: 1 actual: %u", sys_le16_to_cpu(data->count));
+
+	return sample->data[0];
+}
+
+void test_greybus_i2c_periodic(void)
+{
+	int r;
+	uint8_t id;
+	uint8_t result;
+	/* sample register 0x70, reporting changes to its upper nibble */
+	uint8_t req_[0 + sizeof(struct gb_operation_hdr) +
+		     sizeof(struct gb_periodic_start_request) +
+		     sizeof(struct gb_i2c_transfer_req) +
+		     2 * sizeof(struct gb_i2c_transfer_desc) + 2] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	struct gb_periodic_start_request *const start =
+		(struct gb_periodic_start_request *)(req_ + sizeof(*req));
+	struct gb_i2c_transfer_req *const xfer =
+		(struct gb_i2c_transfer_req *)&start[1];
+	uint8_t rsp_[0 + sizeof(struct gb_operation_hdr) +
+		     sizeof(struct gb_periodic_start_response)];
+	struct gb_operation_hdr *const rsp = (struct gb_operation_hdr *)rsp_;
+	uint8_t stop_[0 + sizeof(struct gb_operation_hdr) +
+		      sizeof(struct gb_periodic_stop_request)] = {};
+	struct gb_operation_hdr *const stop = (struct gb_operation_hdr *)stop_;
+	const struct gb_i2c_transfer_desc desc[] = {
+		DESC(0, 1),
+		DESC(GB_I2C_M_RD, 1),
+	};
+	const struct gb_i2c_transfer_desc write_desc[] = {
+		DESC(0, 2),
+	};
+	const uint8_t masked[] = { 0x70, 0x7f };
+	const uint8_t changed[] = { 0x70, 0xa5 };
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->id = sys_cpu_to_le16(0xabcd);
+	req->type = GB_I2C_PROTOCOL_PERIODIC_START;
+	start->period_us = sys_cpu_to_le32(5000);
+	/*
+	 * Fewer changes than fill a batch are made, so each sample is only
+	 * reported because batch periods have passed since it was taken.
+	 */
+	start->batch = sys_cpu_to_le16(4);
+	xfer->op_count = sys_cpu_to_le16(ARRAY_SIZE(desc));
+	memcpy(xfer->desc, desc, sizeof(desc));
+	req_[sizeof(req_) - 2] = 0x70;
+	req_[sizeof(req_) - 1] = 0xf0;
+
+	tx_rx(req, rsp, sizeof(rsp_));
+	zassert_equal(GB_OP_SUCCESS, rsp->result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, rsp->result);
+	id = rsp_[sizeof(*rsp)];
+
+	/* the first sample is always reported */
+	r = periodic_sample(id, TIMEOUT_MS);
+	zassert_equal(0x70, r, "expected: %u actual: %d", 0x70, r);
+
+	/*
+	 * Samples queue up behind transfers on the bus, so the response to
+	 * each write arrives before any sample it changes.
+	 */
+	result = transfer(0xabce, write_desc, ARRAY_SIZE(write_desc), masked,
+			  sizeof(masked), NULL, 0);
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+	r = periodic_sample(id, 50);
+	zassert_equal(-1, r, "masked change reported: %d", r);
+
+	result = transfer(0xabcf, write_desc, ARRAY_SIZE(write_desc), changed,
+			  sizeof(changed), NULL, 0);
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+	r = periodic_sample(id, TIMEOUT_MS);
+	zassert_equal(0xa5, r, "expected: %u actual: %d", 0xa5, r);
+
+	stop->size = sys_cpu_to_le16(sizeof(stop_));
+	stop->id = sys_cpu_to_le16(0xabd0);
+	stop->type = GB_I2C_PROTOCOL_PERIODIC_STOP;
+	stop_[sizeof(*stop)] = id;
+
+	tx_rx(stop, rsp, sizeof(*rsp));
+	zassert_equal(GB_OP_SUCCESS, rsp->result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, rsp->result);
+
+	stop->id = sys_cpu_to_le16(0xabd1);
+	tx_rx(stop, rsp, sizeof(*rsp));
+	zassert_equal(GB_OP_NONEXISTENT, rsp->result,
+		      "expected: %u actual: %u", GB_OP_NONEXISTENT,
+		      rsp->result);
+}
+
+static uint8_t cache_stats(uint16_t addr, uint32_t *hits, uint32_t *misses)
+{
+	uint8_t req_[0 + sizeof(struct gb_operation_hdr) +
+		     sizeof(struct gb_i2c_cache_stats_req)] = {};
+	struct gb_operation_hdr *const req = (struct gb_operation_hdr *)req_;
+	struct gb_i2c_cache_stats_req *const stats =
+		(struct gb_i2c_cache_stats_req *)(req_ + sizeof(*req));
+	uint8_t rsp_[0 + sizeof(struct gb_operation_hdr) +
+		     sizeof(struct gb_i2c_cache_stats_rsp)];
+	struct gb_operation_hdr *const rsp = (struct gb_operation_hdr *)rsp_;
+	struct gb_i2c_cache_stats_rsp *const counters =
+		(struct gb_i2c_cache_stats_rsp *)(rsp_ + sizeof(*rsp));
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->id = sys_cpu_to_le16(0xabcd);
+	req->type = GB_I2C_PROTOCOL_CACHE_STATS;
+	stats->addr = sys_cpu_to_le16(addr);
+
+	tx_rx(req, rsp, sizeof(rsp_));
+
+	if (rsp->result == GB_OP_SUCCESS) {
+		*hits = sys_le32_to_cpu(counters->hits);
+		*misses = sys_le32_to_cpu(counters->misses);
+	}
+
+	return rsp->result;
+}
+
+static uint8_t cached_read(uint8_t reg)
+{
+	uint8_t result;
+	uint8_t val = 0;
+	const struct gb_i2c_transfer_desc desc[] = {
+		DESC_ADDR(I2C_SIM_ADDR2, 0, 1),
+		DESC_ADDR(I2C_SIM_ADDR2, GB_I2C_M_RD, 1),
+	};
+
+	result = transfer(0xabcd, desc, ARRAY_SIZE(desc), &reg, sizeof(reg),
+			  &val, sizeof(val));
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+
+	return val;
+}
+
+static void cached_write(uint8_t reg, uint8_t val)
+{
+	uint8_t result;
+	const uint8_t write_data[] = { reg, val };
+	const struct gb_i2c_transfer_desc desc[] = {
+		DESC_ADDR(I2C_SIM_ADDR2, 0, sizeof(write_data)),
+	};
+
+	result = transfer(0xabcd, desc, ARRAY_SIZE(desc), write_data,
+			  sizeof(write_data), NULL, 0);
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+}
+
+void test_greybus_i2c_cache(void)
+{
+	uint8_t val;
+	uint8_t result;
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t hits0;
+	uint32_t misses0;
+
+	if (!IS_ENABLED(CONFIG_GREYBUS_I2C_CACHE)) {
+		ztest_test_skip();
+	}
+
+	/* the first target has no cache */
+	result = cache_stats(I2C_SIM_ADDR, &hits, &misses);
+	zassert_equal(GB_OP_NONEXISTENT, result, "expected: %u actual: %u",
+		      GB_OP_NONEXISTENT, result);
+
+	result = cache_stats(I2C_SIM_ADDR2, &hits0, &misses0);
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+
+	/* a cacheable register is read from the target once */
+	val = cached_read(0x00);
+	zassert_equal(0x01, val, "expected: 0x01 actual: 0x%02x", val);
+	val = cached_read(0x00);
+	zassert_equal(0x01, val, "expected: 0x01 actual: 0x%02x", val);
+
+	/* writes to cacheable registers invalidate them */
+	cached_write(0x01, 0x55);
+	val = cached_read(0x01);
+	zassert_equal(0x55, val, "expected: 0x55 actual: 0x%02x", val);
+	val = cached_read(0x01);
+	zassert_equal(0x55, val, "expected: 0x55 actual: 0x%02x", val);
+
+	/* writes to write-through registers update them */
+	cached_write(0x10, 0xaa);
+	val = cached_read(0x10);
+	zassert_equal(0xaa, val, "expected: 0xaa actual: 0x%02x", val);
+
+	/* volatile registers are neither hits nor misses */
+	val = cached_read(0x20);
+	zassert_equal(0x21, val, "expected: 0x21 actual: 0x%02x", val);
+
+	result = cache_stats(I2C_SIM_ADDR2, &hits, &misses);
+	zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+		      GB_OP_SUCCESS, result);
+	zassert_equal(3, hits - hits0, "expected: 3 actual: %u",
+		      hits - hits0);
+	zassert_equal(2, misses - misses0, "expected: 2 actual: %u",
+		      misses - misses0);
+}
+
+void test_greybus_i2c_benchmark(void)
+{
+	size_t i;
+	uint8_t result;
+	uint32_t start;
+	uint32_t elapsed;
+	const struct gb_i2c_transfer_desc desc[] = {
+		DESC(0, 1),
+		DESC(GB_I2C_M_RD, 2),
+	};
+	const uint8_t reg[] = { 0x30 };
+	uint8_t read_data[2];
+
+	start = k_uptime_get_32();
+	for (i = 0; i < BENCHMARK_ITERATIONS; ++i) {
+		result = transfer(i, desc, ARRAY_SIZE(desc), reg, sizeof(reg),
+				  read_data, sizeof(read_data));
+		zassert_equal(GB_OP_SUCCESS, result, "expected: %u actual: %u",
+			      GB_OP_SUCCESS, result);
+		zassert_equal(0x30, read_data[0], "expected: %u actual: %u",
+			      0x30, read_data[0]);
+	}
+	elapsed = MAX(k_uptime_get_32() - start, 1);
+
+	TC_PRINT("%u register reads in %u ms (%u per second)\n",
+		 BENCHMARK_ITERATIONS, elapsed,
+		 (uint32_t)(BENCHMARK_ITERATIONS * 1000ULL / elapsed));
 }
@@ -10,10 +10,17 @@ extern void test_greybus_i2c_protocol_version(void);
 extern void test_greybus_i2c_cport_shutdown(void);
 extern void test_greybus_i2c_functionality(void);
 extern void test_greybus_i2c_transfer(void);
+extern void test_greybus_i2c_transfer_chunked(void);
+extern void test_greybus_i2c_transfer_chunked_repeated_start(void);
+extern void test_greybus_i2c_transfer_multi_addr(void);
+extern void test_greybus_i2c_transfer_pipelined(void);
+extern void test_greybus_i2c_periodic(void);
+extern void test_greybus_i2c_cache(void);
+extern void test_greybus_i2c_benchmark(void);
 
 static void board_setup(void)
 {
-	if (IS_ENABLED(CONFIG_I2C_SIM)) {
+	if (IS_ENABLED(CONFIG_I2C_EMUL)) {
 		extern void i2c_sim_setup(void);
 		i2c_sim_setup();
 	}
@@ -30,7 +37,14 @@ void test_main(void) {
         ztest_unit_test(test_greybus_i2c_protocol_version),
         ztest_unit_test(test_greybus_i2c_cport_shutdown),
         ztest_unit_test(test_greybus_i2c_functionality),
-        ztest_unit_test(test_greybus_i2c_transfer)
+        ztest_unit_test(test_greybus_i2c_transfer),
+        ztest_unit_test(test_greybus_i2c_transfer_chunked),
+        ztest_unit_test(test_greybus_i2c_transfer_chunked_repeated_start),
+        ztest_unit_test(test_greybus_i2c_transfer_multi_addr),
+        ztest_unit_test(test_greybus_i2c_transfer_pipelined),
+        ztest_unit_test(test_greybus_i2c_periodic),
+        ztest_unit_test(test_greybus_i2c_cache),
+        ztest_unit_test(test_greybus_i2c_benchmark)
         );
     ztest_run_test_suite(greybus_i2c);
     test_greybus_teardown();
@@ -47,6 +47,13 @@ extern "C" {
 #error Unsupported board
 #endif
 
+/* the simulated register files answer at these addresses */
+#define I2C_SIM_ADDR 0x50
+#define I2C_SIM_ADDR2 0x51
+
+/* reads that started a bus transaction right after a write ended one */
+unsigned int i2c_sim_split_reads(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,6 +11,8 @@ extern void test_greybus_spi_cport_shutdown(void);
 extern void test_greybus_spi_master_config(void);
 extern void test_greybus_spi_device_config(void);
 extern void test_greybus_spi_transfer(void);
+extern void test_greybus_spi_transfer_segmented(void);
+extern void test_greybus_spi_transfer_pipelined(void);
 
 static void board_setup(void)
 {
@@ -36,7 +38,9 @@ void test_main(void) {
         ztest_unit_test(test_greybus_spi_cport_shutdown),
         ztest_unit_test(test_greybus_spi_master_config),
         ztest_unit_test(test_greybus_spi_device_config),
-        ztest_unit_test(test_greybus_spi_transfer)
+        ztest_unit_test(test_greybus_spi_transfer),
+        ztest_unit_test(test_greybus_spi_transfer_segmented),
+        ztest_unit_test(test_greybus_spi_transfer_pipelined)
         );
     ztest_run_test_suite(greybus_spi);
     test_greybus_teardown();
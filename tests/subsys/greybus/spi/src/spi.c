@@ -446,3 +446,167 @@ void test_greybus_spi_transfer(void)
 		to_string(actual_data, sizeof(expected_data))
 	);
 }
+
+void test_greybus_spi_transfer_segmented(void)
+{
+	/*
+	 * Each AT25 instruction needs chip select to be released after it,
+	 * and the status register is read with different bus settings.
+	 *
+	 * D: spi_sim_callback(): WREN  len: 1 data: [06]
+	 * D: spi_sim_callback(): WRITE len: 8 data: [02, 00, 00, 00, a0, a1, a2, a3]
+	 * D: spi_sim_callback(): RDSR  len: 2 data: [05, 00]
+	 * D: spi_sim_callback(): READ  len: 8 data: [03, 00, 00, 00, 00, 00, 00, 00]
+	 */
+	static const struct gb_spi_transfer_desc descs[] = {
+		/* WREN  */ DESC(100000, 1, 0, 1, 8, GB_SPI_XFER_WRITE),
+		/* WRITE */ DESC(100000, 8, 0, 1, 8, GB_SPI_XFER_WRITE),
+		/* RDSR  */ DESC(50000, 2, 0, 1, 16, GB_SPI_XFER_WRITE | GB_SPI_XFER_READ),
+		/* READ  */ DESC(100000, 8, 0, 0, 8, GB_SPI_XFER_WRITE | GB_SPI_XFER_READ),
+	};
+
+	static const uint8_t write_data[] = {
+		0x06,
+		0x02, 0x00, 0x00, 0x00, 0xa0, 0xa1, 0xa2, 0xa3,
+		0x05, 0x00,
+		0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+
+	uint8_t req_[
+		0
+		+ sizeof(struct gb_operation_hdr)
+		+ sizeof(struct gb_spi_transfer_request)
+		+ sizeof(descs)
+		+ sizeof(write_data)
+		] = {};
+	struct gb_operation_hdr *const req =
+		(struct gb_operation_hdr *)req_;
+	struct gb_spi_transfer_request *const xfer_req =
+		(struct gb_spi_transfer_request *)
+		(req_ + sizeof(*req));
+
+	uint8_t rsp_[
+		0
+		+ sizeof(struct gb_operation_hdr)
+		+ (2 + 8)
+		];
+	struct gb_operation_hdr *const rsp =
+		(struct gb_operation_hdr *)rsp_;
+	uint8_t *const actual_data = rsp_ + sizeof(*rsp);
+	const uint8_t expected_data[] = { 0xa0, 0xa1, 0xa2, 0xa3 };
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->id = sys_cpu_to_le16(0xabce);
+	req->type = GB_SPI_PROTOCOL_TRANSFER;
+	xfer_req->count = sys_cpu_to_le16(ARRAY_SIZE(descs));
+	memcpy(xfer_req->transfers, descs, sizeof(descs));
+	memcpy((uint8_t *)xfer_req->transfers + sizeof(descs), write_data,
+		sizeof(write_data));
+
+	memset(actual_data, 0xff, 2 + 8);
+
+	tx_rx(req, rsp, sizeof(rsp_));
+
+	zassert_equal(rsp->result, GB_OP_SUCCESS,
+		      "expected: GB_OP_SUCCESS actual: %u", rsp->result);
+
+	/* the write enable latch is set by the first segment */
+	zassert_equal(0x02, actual_data[1] & 0x02,
+		      "status: expected: WEL actual: %02x", actual_data[1]);
+
+	zassert_equal(
+		0,
+		memcmp(expected_data, &actual_data[2 + 4], sizeof(expected_data)),
+		"data: expected: [%s] actual: [%s]",
+		to_string((uint8_t *)expected_data, sizeof(expected_data)),
+		to_string(&actual_data[2 + 4], sizeof(expected_data))
+	);
+}
+
+void test_greybus_spi_transfer_pipelined(void)
+{
+	/*
+	 * Each request writes one byte to the AT25 and reads it back.
+	 *
+	 * D: spi_sim_callback(): WRITE len: 5 data: [02, 00, 2n, 00, 5n]
+	 * D: spi_sim_callback(): READ  len: 5 data: [03, 00, 2n, 00, 00]
+	 */
+	static const struct gb_spi_transfer_desc descs[] = {
+		/* WRITE */ DESC(100000, 5, 0, 1, 8, GB_SPI_XFER_WRITE),
+		/* READ  */ DESC(100000, 5, 0, 0, 8, GB_SPI_XFER_WRITE | GB_SPI_XFER_READ),
+	};
+
+	uint8_t req_[
+		0
+		+ sizeof(struct gb_operation_hdr)
+		+ sizeof(struct gb_spi_transfer_request)
+		+ sizeof(descs)
+		+ (5 + 5)
+		] = {};
+	struct gb_operation_hdr *const req =
+		(struct gb_operation_hdr *)req_;
+	struct gb_spi_transfer_request *const xfer_req =
+		(struct gb_spi_transfer_request *)
+		(req_ + sizeof(*req));
+	uint8_t *const write_data = (uint8_t *)xfer_req->transfers + sizeof(descs);
+
+	uint8_t rsp_[
+		0
+		+ sizeof(struct gb_operation_hdr)
+		+ 5
+		];
+	struct gb_operation_hdr *const rsp =
+		(struct gb_operation_hdr *)rsp_;
+	uint8_t *const actual_data = rsp_ + sizeof(*rsp);
+
+	struct pollfd pollfd;
+	uint8_t seen = 0;
+	size_t id;
+	size_t i;
+	int r;
+
+	req->size = sys_cpu_to_le16(sizeof(req_));
+	req->type = GB_SPI_PROTOCOL_TRANSFER;
+	xfer_req->count = sys_cpu_to_le16(ARRAY_SIZE(descs));
+	memcpy(xfer_req->transfers, descs, sizeof(descs));
+	write_data[0] = 0x02;
+	write_data[5] = 0x03;
+
+	/* several requests in flight, each answered once the bus is done */
+	for (i = 1; i <= 4; ++i) {
+		req->id = sys_cpu_to_le16(i);
+		write_data[2] = 0x20 + i;
+		write_data[4] = 0x50 + i;
+		write_data[7] = 0x20 + i;
+		r = send(fd, req, sizeof(req_), 0);
+		zassert_equal(r, sizeof(req_), "send: expected: %u actual: %d",
+			      (unsigned)sizeof(req_), r);
+	}
+
+	for (i = 0; i < 4; ++i) {
+		pollfd.fd = fd;
+		pollfd.events = POLLIN;
+
+		r = poll(&pollfd, 1, TIMEOUT_MS);
+		zassert_not_equal(r, -1, "poll: %d", errno);
+		zassert_not_equal(r, 0, "timeout waiting for response");
+
+		r = recv(fd, rsp, sizeof(rsp_), 0);
+		zassert_equal(r, sizeof(rsp_), "recv: expected: %u actual: %d",
+			      (unsigned)sizeof(rsp_), r);
+		zassert_equal(GB_OP_SUCCESS, rsp->result,
+			      "expected: %u actual: %u", GB_OP_SUCCESS,
+			      rsp->result);
+
+		id = sys_le16_to_cpu(rsp->id);
+		zassert_true(id >= 1 && id <= 4, "unexpected id %u",
+			     (unsigned)id);
+		zassert_false(seen & BIT(id), "duplicate response %u",
+			      (unsigned)id);
+		seen |= BIT(id);
+
+		zassert_equal(0x50 + id, actual_data[4],
+			      "expected: %u actual: %u", (unsigned)(0x50 + id),
+			      actual_data[4]);
+	}
+}
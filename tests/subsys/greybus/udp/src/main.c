@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <ztest.h>
+
+extern void test_greybus_udp_setup(void);
+extern void test_greybus_udp_teardown(void);
+
+extern void test_greybus_udp_manifest_size(void);
+extern void test_greybus_udp_retransmit(void);
+extern void test_greybus_udp_duplicate(void);
+
+void test_main(void) {
+
+	test_greybus_udp_setup();
+	ztest_test_suite(greybus_udp,
+		ztest_unit_test(test_greybus_udp_manifest_size),
+		ztest_unit_test(test_greybus_udp_retransmit),
+		ztest_unit_test(test_greybus_udp_duplicate)
+		);
+	ztest_run_test_suite(greybus_udp);
+	test_greybus_udp_teardown();
+}
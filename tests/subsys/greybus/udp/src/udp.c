@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2020 Friedt Professional Engineering Services, Inc
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <errno.h>
+#include <greybus/greybus.h>
+#include <net/net_ip.h>
+#include <net/socket.h>
+#include <posix/unistd.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <sys/util.h>
+#include <ztest.h>
+#include <zephyr.h>
+
+/* slightly annoying */
+#include "../../../../../subsys/greybus/control-gb.h"
+
+/* the control cport */
+#define PORT 4242
+
+#define TIMEOUT_MS 1000
+
+#ifdef CONFIG_NET_CONFIG_MY_IPV4_ADDR
+#define MY_IPV4_ADDR CONFIG_NET_CONFIG_MY_IPV4_ADDR
+#else
+#define MY_IPV4_ADDR ""
+#endif
+
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+/* same layout as struct gb_udp_hdr in transport-udp.c */
+struct udp_hdr {
+	uint8_t flags;
+	uint8_t reserved;
+	uint16_t seq;
+} __packed;
+
+#define UDP_F_DATA BIT(0)
+#define UDP_F_ACK BIT(1)
+
+#define RTO_MS CONFIG_GREYBUS_XPORT_UDP_RTO_MS
+#endif
+
+struct datagram {
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	struct udp_hdr udp;
+#endif
+	struct gb_operation_hdr hdr;
+	struct gb_control_get_manifest_size_response rsp;
+} __packed;
+
+#define REQUEST_SIZE offsetof(struct datagram, rsp)
+
+static int fd = -1;
+
+void test_greybus_udp_setup(void)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons(PORT),
+	};
+	int r;
+
+	r = inet_pton(AF_INET, MY_IPV4_ADDR, &sin.sin_addr);
+	__ASSERT(r == 1, "%s is not a valid IPv4 address", MY_IPV4_ADDR);
+
+	r = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	__ASSERT(r >= 0, "socket: %d", errno);
+	fd = r;
+
+	r = connect(fd, (struct sockaddr *)&sin, sizeof(sin));
+	__ASSERT(r == 0, "connect: %d", errno);
+}
+
+void test_greybus_udp_teardown(void)
+{
+	if (fd != -1) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+static void tx_request(uint16_t id, uint16_t seq)
+{
+	struct datagram req = {
+		.hdr = {
+			.size = sys_cpu_to_le16(sizeof(struct gb_operation_hdr)),
+			.id = sys_cpu_to_le16(id),
+			.type = GB_CONTROL_TYPE_GET_MANIFEST_SIZE,
+		},
+	};
+	int r;
+
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	req.udp.flags = UDP_F_DATA;
+	req.udp.seq = sys_cpu_to_le16(seq);
+#else
+	ARG_UNUSED(seq);
+#endif
+
+	r = send(fd, &req, REQUEST_SIZE, 0);
+	zassert_equal(r, REQUEST_SIZE, "send: %d (errno %d)", r, errno);
+}
+
+/* return the size of the next datagram, or 0 after @p timeout_ms */
+static int rx(struct datagram *dg, int timeout_ms)
+{
+	struct pollfd pollfd = {
+		.fd = fd,
+		.events = POLLIN,
+	};
+	int r;
+
+	r = poll(&pollfd, 1, timeout_ms);
+	zassert_not_equal(r, -1, "poll: %d", errno);
+	if (r == 0) {
+		return 0;
+	}
+
+	memset(dg, 0, sizeof(*dg));
+	r = recv(fd, dg, sizeof(*dg), 0);
+	zassert_true(r > 0, "recv: %d (errno %d)", r, errno);
+
+	return r;
+}
+
+static void check_response(const struct datagram *dg, int size, uint16_t id)
+{
+	zassert_equal(size, sizeof(*dg), "response of %d bytes", size);
+	zassert_equal(sys_le16_to_cpu(dg->hdr.size),
+		sizeof(dg->hdr) + sizeof(dg->rsp), "invalid size");
+	zassert_equal(sys_le16_to_cpu(dg->hdr.id), id, "invalid id");
+	zassert_equal(dg->hdr.type,
+		GB_TYPE_RESPONSE_FLAG | GB_CONTROL_TYPE_GET_MANIFEST_SIZE,
+		"invalid type %x", dg->hdr.type);
+	zassert_equal(dg->hdr.result, GB_OP_SUCCESS, "result %u",
+		dg->hdr.result);
+	zassert_not_equal(sys_le16_to_cpu(dg->rsp.size), 0, "empty manifest");
+}
+
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+static void tx_ack(uint16_t seq)
+{
+	struct udp_hdr ack = {
+		.flags = UDP_F_ACK,
+		.seq = sys_cpu_to_le16(seq),
+	};
+	int r;
+
+	r = send(fd, &ack, sizeof(ack), 0);
+	zassert_equal(r, sizeof(ack), "send: %d (errno %d)", r, errno);
+}
+
+/*
+ * Receive until the line goes quiet for @p quiet_ms, counting the acks
+ * of @p seq and the responses to @p id. Responses are acked only when
+ * @p ack is true. The sequence number of the last response is returned
+ * in @p rsp_seq.
+ */
+static void rx_until_quiet(uint16_t id, uint16_t seq, bool ack, int quiet_ms,
+	int *acks, int *responses, uint16_t *rsp_seq)
+{
+	struct datagram dg;
+	int r;
+
+	*acks = 0;
+	*responses = 0;
+
+	while ((r = rx(&dg, quiet_ms)) > 0) {
+		if (dg.udp.flags & UDP_F_ACK) {
+			zassert_equal(r, sizeof(dg.udp), "ack of %d bytes", r);
+			zassert_equal(sys_le16_to_cpu(dg.udp.seq), seq,
+				"ack for seq %u", sys_le16_to_cpu(dg.udp.seq));
+			++*acks;
+			continue;
+		}
+
+		zassert_true(dg.udp.flags & UDP_F_DATA, "flags %x",
+			dg.udp.flags);
+		check_response(&dg, r, id);
+		if (*responses > 0) {
+			zassert_equal(sys_le16_to_cpu(dg.udp.seq), *rsp_seq,
+				"retransmission with a new seq");
+		}
+		*rsp_seq = sys_le16_to_cpu(dg.udp.seq);
+		++*responses;
+
+		if (ack) {
+			tx_ack(*rsp_seq);
+		}
+	}
+}
+#endif
+
+void test_greybus_udp_manifest_size(void)
+{
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	int acks;
+	int responses;
+	uint16_t rsp_seq;
+
+	tx_request(1, 0);
+	rx_until_quiet(1, 0, true, 3 * RTO_MS, &acks, &responses, &rsp_seq);
+	zassert_equal(acks, 1, "%d acks", acks);
+	zassert_equal(responses, 1, "%d responses", responses);
+#else
+	struct datagram dg;
+	int r;
+
+	tx_request(1, 0);
+	r = rx(&dg, TIMEOUT_MS);
+	zassert_not_equal(r, 0, "timeout waiting for response");
+	check_response(&dg, r, 1);
+#endif
+}
+
+void test_greybus_udp_retransmit(void)
+{
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	int acks;
+	int responses;
+	uint16_t rsp_seq;
+
+	/* an unacknowledged response is sent again, with the same seq */
+	tx_request(2, 1);
+	rx_until_quiet(2, 1, false, 2 * RTO_MS, &acks, &responses, &rsp_seq);
+	zassert_equal(acks, 1, "%d acks", acks);
+	zassert_equal(responses, 1 + CONFIG_GREYBUS_XPORT_UDP_MAX_RETRIES,
+		"%d responses", responses);
+
+	/* a response acked within the RTO is not sent again */
+	tx_request(3, 2);
+	rx_until_quiet(3, 2, true, 3 * RTO_MS, &acks, &responses, &rsp_seq);
+	zassert_equal(acks, 1, "%d acks", acks);
+	zassert_equal(responses, 1, "%d responses", responses);
+#else
+	ztest_test_skip();
+#endif
+}
+
+void test_greybus_udp_duplicate(void)
+{
+#ifdef CONFIG_GREYBUS_XPORT_UDP_RELIABLE
+	int acks;
+	int responses;
+	uint16_t rsp_seq;
+
+	/* both copies are acked, but the request is only handled once */
+	tx_request(4, 3);
+	tx_request(4, 3);
+	rx_until_quiet(4, 3, true, 3 * RTO_MS, &acks, &responses, &rsp_seq);
+	zassert_equal(acks, 2, "%d acks", acks);
+	zassert_equal(responses, 1, "%d responses", responses);
+#else
+	ztest_test_skip();
+#endif
+}